@@ -50,6 +50,7 @@
  */
 
 #include "ARGB.h"
+#include "ARGB_timing.h"
 #include "stm32_dma.h"
 #include "pwm.h"
 #include "math.h"
@@ -67,95 +68,96 @@
  * @{
 */
 
-/// Timer handler
-#if (TIM_HANDLE == PWMD2) || (TIM_HANDLE == PWMD3) || (TIM_HANDLE == PWMD4) || \
-    (TIM_HANDLE == PWMD5) || (TIM_HANDLE == PWMD5) || (TIM_HANDLE == PWMD12)
-#define APB_FREQ  STM32_TIMCLK1
+#if defined(RGBW)
+#define ARGB_BPP 4 ///< Default bytes per pixel
 #else
-#define APB_FREQ  STM32_TIMCLK2
-#endif
-
-/// DMA Size
-#if defined(DMA_SIZE_BYTE)
-typedef uint8_t dma_siz;
-#elif defined(DMA_SIZE_HWORD)
-typedef uint16_t dma_siz;
-#elif defined(DMA_SIZE_WORD)
-typedef uint32_t dma_siz;
-#endif
-
-#ifdef APB1
-#define APB_FREQ STM32_TIMCLK1
-#elif defined(APB2)
-#define APB_FREQ STM32_TIMCLK2
+#define ARGB_BPP 3
 #endif
 
-#ifdef WS2811S
-#define ARR_VAL (APB_FREQ / (400*1000)) // 400 KHz - 2.5us
+/// Default chip of the RGB / GRB part of a mixed chain
+#if defined(WS2811S)
+#define ARGB_RGB_CHIP ARGB_CHIP_WS2811S
+#define ARGB_RGB_PROFILE ARGB_WS2811S
 #else
-#define ARR_VAL (APB_FREQ / (800*1000)) // 800 KHz - 1.25us
+#define ARGB_RGB_CHIP ARGB_CHIP_WS2811F
+#define ARGB_RGB_PROFILE ARGB_WS2811F
 #endif
-
-#if defined(WS2811F) || defined(WS2811S)
-#define WS2811_PWM_HI (uint8_t) (ARR_VAL * (0.48 + LED_SIGNAL_RISE_DELAY_US)) - 1     // Log.1 - 48% - 0.60us/1.2us
-#define WS2811_PWM_LO (uint8_t) (ARR_VAL * (0.20 + LED_SIGNAL_RISE_DELAY_US)) - 1     // Log.0 - 20% - 0.25us/0.5us
-
-#if defined(MIXED_RGB_GRB)
-#define RGB_PWM_HI WS2811_PWM_HI
-#define RGB_PWM_LO WS2811_PWM_LO
+#if defined(SK6812)
+#define ARGB_GRB_CHIP ARGB_CHIP_SK6812
+#define ARGB_GRB_PROFILE ARGB_SK6812
 #else
-#define PWM_HI WS2811_PWM_HI
-#define PWM_LO WS2811_PWM_LO
-#endif
+#define ARGB_GRB_CHIP ARGB_CHIP_WS2812
+#define ARGB_GRB_PROFILE ARGB_WS2812
 #endif
 
+/// Default chip and subpixel order of a single-type chain
 #if defined(WS2812)
-#define WS2812_PWM_HI (uint8_t) (ARR_VAL * (0.56 + LED_SIGNAL_RISE_DELAY_US)) - 1     // Log.1 - 56% - 0.70us
-#define WS2812_PWM_LO (uint8_t) (ARR_VAL * (0.28 + LED_SIGNAL_RISE_DELAY_US)) - 1     // Log.0 - 28% - 0.35us
-
-#if defined(MIXED_RGB_GRB)
-#define GRB_PWM_HI WS2812_PWM_HI
-#define GRB_PWM_LO WS2812_PWM_LO
+#define ARGB_CHIP ARGB_CHIP_WS2812
+#define ARGB_PROFILE ARGB_WS2812
+#define ARGB_ORDER ARGB_ORDER_GRB
+#elif defined(SK6812)
+#define ARGB_CHIP ARGB_CHIP_SK6812
+#define ARGB_PROFILE ARGB_SK6812
+#define ARGB_ORDER ARGB_ORDER_RGB
 #else
-#define PWM_HI WS2812_PWM_HI
-#define PWM_LO WS2812_PWM_LO
+#define ARGB_CHIP ARGB_RGB_CHIP
+#define ARGB_PROFILE ARGB_RGB_PROFILE
+#define ARGB_ORDER ARGB_ORDER_RGB
 #endif
-#endif
-
-#if defined(SK6812)
-#define SK6812_PWM_HI (uint8_t) (ARR_VAL * (0.48 + LED_SIGNAL_RISE_DELAY_US)) - 1     // Log.1 - 48% - 0.60us
-#define SK6812_PWM_LO (uint8_t) (ARR_VAL * (0.24 + LED_SIGNAL_RISE_DELAY_US)) - 1     // Log.0 - 24% - 0.30us
 
-#if defined(MIXED_RGB_GRB)
-#define GRB_PWM_HI SK6812_PWM_HI
-#define GRB_PWM_LO SK6812_PWM_LO
-#else
-#define PWM_HI SK6812_PWM_HI
-#define PWM_LO SK6812_PWM_LO
+/// Pixel buffer size of a chain: LED quantity and wire bytes
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+#define ARGB_PIXEL_BYTES(leds, wire) (wire)
+#elif ARGB_PIXEL_FORMAT == ARGB_FMT_RGB565
+#define ARGB_PIXEL_BYTES(leds, wire) (2 * (leds))
+#elif ARGB_PIXEL_FORMAT == ARGB_FMT_PAL8
+#define ARGB_PIXEL_BYTES(leds, wire) (leds)
+#define ARGB_PALETTE_SIZE 256
+#elif ARGB_PIXEL_FORMAT == ARGB_FMT_PAL4
+#define ARGB_PIXEL_BYTES(leds, wire) (((leds) + 1) / 2)
+#define ARGB_PALETTE_SIZE 16
+#elif ARGB_PIXEL_FORMAT == ARGB_FMT_ATOMIC
+#define ARGB_PIXEL_BYTES(leds, wire) (4 * (leds))
 #endif
+#define NUM_BYTES ARGB_PIXEL_BYTES(NUM_PIXELS, ARGB_BPP * NUM_PIXELS) ///< Strip size in bytes
+#define ARGB_ALIGN4(x) (((x) + 3) & ~(uintptr_t) 3) ///< Round size or address up to a word
+#if ARGB_USE_ENCODE_THREAD
+#define ARGB_CHUNKS ARGB_RING_CHUNKS      ///< Chunks in PWM buffer ring
+#else
+#define ARGB_CHUNKS 2                     ///< Halves of PWM buffer
 #endif
-
-#if defined(RGBW)
-#define NUM_BYTES (4 * NUM_PIXELS) ///< Strip size in bytes
-#define PWM_BUF_LEN (4 * 8 * 2)    ///< Pack len * 8 bit * 2 LEDs
+#define PWM_HALF_LEN (ARGB_BPP * 8)       ///< Slots in one chunk (half) of PWM buffer
+#define PWM_BUF_LEN (PWM_HALF_LEN * ARGB_CHUNKS) ///< Pack len * 8 bit * chunks
+#define PWM_HALF_BYTES (PWM_HALF_LEN / 8) ///< Pixel bytes encoded per chunk
+#define PWM_DBM_LEN (PWM_HALF_LEN * ARGB_DBM_LEDS) ///< Slots in one double-buffer mode buffer
+#if ARGB_USE_DBM
+#define PWM_ARENA_BYTES 0 ///< Double-buffer mode buffers keep their own placement
 #else
-#define NUM_BYTES (3 * NUM_PIXELS) ///< Strip size in bytes
-#define PWM_BUF_LEN (3 * 8 * 2)    ///< Pack len * 8 bit * 2 LEDs
+#define PWM_ARENA_BYTES ARGB_ALIGN4(PWM_BUF_LEN * sizeof(dma_siz)) ///< PWM buffer share of an arena
 #endif
+#define ARGB_LATCH_ZEROS 2 ///< Zero slots in DMA pipeline before the line is surely idle
 
+#if ARGB_USE_DBM
+#define DMA_MODE (STM32_DMA_CR_DIR_M2P | STM32_DMA_CR_DBM | \
+                  STM32_DMA_CR_TCIE  | STM32_DMA_CR_MINC | \
+                  STM32_DMA_CR_PSIZE_WORD | STM32_DMA_CR_MSIZE_WORD | STM32_DMA_CR_CHSEL(3))
+#else
 #define DMA_MODE (STM32_DMA_CR_DIR_M2P | STM32_DMA_CR_CIRC | \
                   STM32_DMA_CR_HTIE | STM32_DMA_CR_TCIE  | STM32_DMA_CR_MINC | \
                   STM32_DMA_CR_PSIZE_WORD | STM32_DMA_CR_MSIZE_WORD | STM32_DMA_CR_CHSEL(3))
+#endif
 
 #define APPLY_DIMMING(X) (X)
 #define HSV_SECTION_6 (0x20)
 #define HSV_SECTION_3 (0x40)
 
+static void argb_latch_cb(PWMDriver *pwmp); // RET code end
+
 static const PWMConfig pwm2_conf = 
 {
     APB_FREQ,
-    ARR_VAL - 1,
-    NULL,
+    ARR_VAL,
+    argb_latch_cb,
     {
         {PWM_OUTPUT_DISABLED,   NULL},
         {PWM_OUTPUT_DISABLED,   NULL},
@@ -166,27 +168,247 @@ static const PWMConfig pwm2_conf =
     0  
 };
 
-/// Static LED buffer
-volatile uint8_t rgb_buf[NUM_BYTES] = {0,};
-
+#if ARGB_DYNAMIC_BUFFERS
+/// LED buffer carved from arena or heap, word aligned for ARGB_FMT_ATOMIC
+volatile uint8_t *rgb_buf = NULL;
+static size_t argb_buf_cap = 0;  ///< Pixel buffer capacity, bytes
+#if CH_CFG_USE_HEAP
+static void *argb_heap_block = NULL; ///< Buffers allocated by #argb_init_heap
+#endif
+#else
+/// Static LED buffer, word aligned for ARGB_FMT_ATOMIC
+volatile uint8_t rgb_buf[NUM_BYTES] __attribute__((aligned(4))) = {0,};
+#endif
+static uint16_t argb_buf_bytes = 0; ///< Pixel buffer bytes in use
+static uint16_t argb_num_leds = 0;  ///< LEDs in the chain
+
+#if ARGB_USE_DBM
+/// Timer PWM value buffers, DMA reads one while the other is filled
+ARGB_DBM_BUF0_ATTR volatile dma_siz pwm_buf0[PWM_DBM_LEN];
+ARGB_DBM_BUF1_ATTR volatile dma_siz pwm_buf1[PWM_DBM_LEN];
+#elif ARGB_DYNAMIC_BUFFERS
+/// Timer PWM value buffer, placed in front of #rgb_buf
+volatile dma_siz *pwm_buf = NULL;
+#else
 /// Timer PWM value buffer
 volatile dma_siz pwm_buf[PWM_BUF_LEN] = {0,};
-/// PWM buffer iterator
+#endif
+/// Halves filled since the transfer start, 0 - no transfer. The encode
+/// thread counts chunks in its ring instead and keeps it at 1 while running
 volatile uint16_t buf_counter = 0;
 
 volatile uint8_t argb_brightness = 255;     ///< LED Global brightness
 volatile argb_state argb_lock_state; ///< Buffer send status
 
-// get around -Werror=type-limits
-#if defined(MIXED_RGB_GRB)
-static const uint16_t rgb_start = RGB_START;
-static const uint16_t rgb_end = RGB_END;
-static const uint16_t grb_start = GRB_START;
-static const uint16_t grb_end = GRB_END;
+/// Resolved segment: position in #rgb_buf and PWM values of one LED type
+typedef struct argb_seg {
+    uint16_t start;  ///< First LED
+    uint16_t end;    ///< LED after the last one
+    uint16_t offset; ///< First byte in #rgb_buf
+    uint16_t limit;  ///< Byte after the last one in #rgb_buf
+    uint8_t bpp;     ///< Bytes per pixel
+    uint8_t map[3];  ///< Wire position of R, G, B inside pixel
+    dma_siz hi;      ///< PWM value of log.1
+    dma_siz lo;      ///< PWM value of log.0
+#if ARGB_USE_POWER_LIMIT
+    uint32_t sum[4]; ///< Sums of R, G, B, W values in the segment
+    uint16_t ua[4];  ///< Current of one R, G, B, W step, uA
+    uint16_t idle;   ///< Idle current of one LED, mA
+#endif
+} argb_seg;
+
+/// Wire position of R, G, B for every #argb_order
+static const uint8_t argb_order_map[][3] = {
+    [ARGB_ORDER_RGB] = {0, 1, 2},
+    [ARGB_ORDER_RBG] = {0, 2, 1},
+    [ARGB_ORDER_GRB] = {1, 0, 2},
+    [ARGB_ORDER_GBR] = {2, 0, 1},
+    [ARGB_ORDER_BRG] = {1, 2, 0},
+    [ARGB_ORDER_BGR] = {2, 1, 0},
+};
+
+/// Log.1 / Log.0 PWM values for every #argb_chip
+static const dma_siz argb_chip_pwm[][2] = {
+    [ARGB_CHIP_WS2811S] = {ARGB_PWM_HI(ARGB_WS2811S), ARGB_PWM_LO(ARGB_WS2811S)},
+    [ARGB_CHIP_WS2811F] = {ARGB_PWM_HI(ARGB_WS2811F), ARGB_PWM_LO(ARGB_WS2811F)},
+    [ARGB_CHIP_WS2812]  = {ARGB_PWM_HI(ARGB_WS2812),  ARGB_PWM_LO(ARGB_WS2812)},
+    [ARGB_CHIP_SK6812]  = {ARGB_PWM_HI(ARGB_SK6812),  ARGB_PWM_LO(ARGB_SK6812)},
+};
+
+/// Chip tolerances are met at #ARGB_BIT_RATE_HZ
+static const bool argb_chip_ok[] = {
+    [ARGB_CHIP_WS2811S] = ARGB_TIMING_OK(ARGB_WS2811S),
+    [ARGB_CHIP_WS2811F] = ARGB_TIMING_OK(ARGB_WS2811F),
+    [ARGB_CHIP_WS2812]  = ARGB_TIMING_OK(ARGB_WS2812),
+    [ARGB_CHIP_SK6812]  = ARGB_TIMING_OK(ARGB_SK6812),
+};
+
+/// Shortest RET code of every chip, us
+static const uint16_t argb_chip_res[] = {
+    [ARGB_CHIP_WS2811S] = ARGB_WS2811S_RES_MIN_US,
+    [ARGB_CHIP_WS2811F] = ARGB_WS2811F_RES_MIN_US,
+    [ARGB_CHIP_WS2812]  = ARGB_WS2812_RES_MIN_US,
+    [ARGB_CHIP_SK6812]  = ARGB_SK6812_RES_MIN_US,
+};
+
+#if ARGB_USE_POWER_LIMIT
+#define ARGB_UA_STEP(ma) ((uint16_t) (((ma) * 1000 + 127) / 255)) ///< Current of one value step, uA
+
+/// Current model for every #argb_chip: R, G, B, W steps in uA and idle LED in mA
+static const uint16_t argb_chip_current[][5] = {
+    [ARGB_CHIP_WS2811S] = {ARGB_UA_STEP(ARGB_WS2811_MA_RGB), ARGB_UA_STEP(ARGB_WS2811_MA_RGB),
+                           ARGB_UA_STEP(ARGB_WS2811_MA_RGB), 0, ARGB_WS2811_MA_IDLE},
+    [ARGB_CHIP_WS2811F] = {ARGB_UA_STEP(ARGB_WS2811_MA_RGB), ARGB_UA_STEP(ARGB_WS2811_MA_RGB),
+                           ARGB_UA_STEP(ARGB_WS2811_MA_RGB), 0, ARGB_WS2811_MA_IDLE},
+    [ARGB_CHIP_WS2812]  = {ARGB_UA_STEP(ARGB_WS2812_MA_RGB), ARGB_UA_STEP(ARGB_WS2812_MA_RGB),
+                           ARGB_UA_STEP(ARGB_WS2812_MA_RGB), 0, ARGB_WS2812_MA_IDLE},
+    [ARGB_CHIP_SK6812]  = {ARGB_UA_STEP(ARGB_SK6812_MA_RGB), ARGB_UA_STEP(ARGB_SK6812_MA_RGB),
+                           ARGB_UA_STEP(ARGB_SK6812_MA_RGB), ARGB_UA_STEP(ARGB_SK6812_MA_W),
+                           ARGB_SK6812_MA_IDLE},
+};
+
+#if defined(ARGB_PALETTE_SIZE)
+#error Power limit needs ARGB_FMT_RAW, ARGB_FMT_RGB565 or ARGB_FMT_ATOMIC pixel format
+#endif
+
+static uint32_t argb_power_limit = 0; ///< Current limit, mA, 0 - none
+static uint16_t argb_power_k = 256;   ///< Encode-time scale of the frame being sent, 256 - none
+#endif
+
+/// Segment table built from compile-time settings, used by argb_init()
+static const argb_segment argb_default_segs[] = {
+#if defined(MIXED_RGB_GRB) && (RGB_START < GRB_START)
+    {RGB_START, RGB_END - RGB_START + 1, ARGB_ORDER_RGB, ARGB_BPP, ARGB_RGB_CHIP},
+    {GRB_START, GRB_END - GRB_START + 1, ARGB_ORDER_GRB, ARGB_BPP, ARGB_GRB_CHIP},
+#elif defined(MIXED_RGB_GRB)
+    {GRB_START, GRB_END - GRB_START + 1, ARGB_ORDER_GRB, ARGB_BPP, ARGB_GRB_CHIP},
+    {RGB_START, RGB_END - RGB_START + 1, ARGB_ORDER_RGB, ARGB_BPP, ARGB_RGB_CHIP},
+#else
+    {0, NUM_PIXELS, ARGB_ORDER, ARGB_BPP, ARGB_CHIP},
+#endif
+};
+
+static argb_seg argb_segs[ARGB_MAX_SEGMENTS];        ///< Active segment table
+static uint8_t argb_seg_count = 0;                   ///< Segments in use
+static argb_seg *argb_seg_hint = &argb_segs[0];      ///< Segment of the last set LED
+static uint16_t argb_total_bytes = 0;                ///< Bytes of the whole chain
+static uint32_t argb_reset_ticks = 0;               ///< RET code length in timer ticks
+
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_ATOMIC
+typedef uint32_t argb_packed; ///< R, G, B, W from low to high byte
+typedef uint32_t __attribute__((may_alias)) argb_word; ///< LED slot in #rgb_buf
+#define ARGB_WORD(i) ((argb_word *) &rgb_buf[4 * (i)])
+#define ARGB_SUM_ADD(seg, k, d) __atomic_fetch_add(&(seg)->sum[k], (uint32_t) (d), __ATOMIC_RELAXED)
+// any writer may move the hint, a stale one is only slower
+#define ARGB_HINT_GET() __atomic_load_n(&argb_seg_hint, __ATOMIC_RELAXED)
+#define ARGB_HINT_SET(seg) __atomic_store_n(&argb_seg_hint, (seg), __ATOMIC_RELAXED)
+#elif ARGB_PIXEL_FORMAT != ARGB_FMT_RAW
+typedef uint16_t argb_packed; ///< Compact pixel: RGB565 word or palette index
+#endif
+#if !defined(ARGB_SUM_ADD)
+#define ARGB_SUM_ADD(seg, k, d) ((seg)->sum[k] += (d))
+#define ARGB_HINT_GET() (argb_seg_hint)
+#define ARGB_HINT_SET(seg) (argb_seg_hint = (seg))
+#endif
+#if defined(ARGB_PALETTE_SIZE)
+static uint8_t argb_palette[ARGB_PALETTE_SIZE][4]; ///< Palette: R, G, B, W with brightness & gamma
+#if ARGB_PALETTE_SIZE == 256
+#define ARGB_PAL_OK(idx) 1 ///< Any uint8_t is a valid entry
+#else
+#define ARGB_PAL_OK(idx) ((idx) < ARGB_PALETTE_SIZE)
+#endif
+#endif
+
+#if ARGB_SKIP_UNCHANGED
+static uint32_t argb_gen = 0;             ///< Frame generation, bumped by every write
+static uint32_t argb_sent_gen = ~0u;      ///< Generation of the last sent frame
+static systime_t argb_sent_time = 0;      ///< Start of the last sent frame
+static uint32_t argb_skipped = 0;         ///< Frames skipped as unchanged
+#if ARGB_FRAME_HASH
+static uint32_t argb_sent_hash = 0;       ///< Hash of the last sent frame
+#endif
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_ATOMIC
+#define ARGB_TOUCH() __atomic_fetch_add(&argb_gen, 1, __ATOMIC_RELAXED)
+#else
+#define ARGB_TOUCH() (argb_gen++)
+#endif
+#else
+#define ARGB_TOUCH() ((void) 0)
 #endif
 
+static const argb_seg *enc_seg = &argb_segs[0]; ///< Segment being encoded
+static uint16_t enc_byte = 0;                   ///< Wire bytes encoded so far
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+static const volatile uint8_t *enc_src = NULL;  ///< Frame being encoded
+static const uint8_t *enc_fade_b = NULL;        ///< Frame blended in, NULL - none
+static argb_encoder enc_hook = NULL;            ///< Encoder of the current layout, NULL - segment table
+static uint16_t enc_fade_amt = 0;               ///< Share of #enc_fade_b, 0..256
+#else
+static uint16_t enc_led = 0;                    ///< Next LED to expand
+static uint8_t enc_px[4];                       ///< Expanded pixel in wire order
+static uint8_t enc_px_pos = 4;                  ///< Next byte of #enc_px
+#endif
+static uint16_t enc_zeros = 0;                  ///< Zero slots read by DMA after data
+static uint16_t enc_half_zeros[ARGB_CHUNKS];    ///< Trailing zero slots in each chunk
+#if ARGB_USE_ENCODE_THREAD
+static THD_WORKING_AREA(argb_enc_wa, ARGB_ENCODE_THREAD_STACK); ///< Encode worker stack
+static semaphore_t enc_sem;                     ///< Chunks released by DMA, not encoded yet
+static uint8_t enc_ring_head = 0;               ///< Next chunk for the worker
+static volatile uint8_t enc_ring_ready = 0;     ///< Encoded chunks DMA hasn't finished
+static volatile bool enc_working = false;       ///< Worker is inside a chunk
+static argb_encode_stats enc_stats = {0, 0, ARGB_CHUNKS}; ///< Queue depth & stalls
+#endif
+static uint16_t argb_latch_left = 0;            ///< Timer periods left till latch end
+static bool argb_started = false;               ///< Timer & DMA are set up
 
 static inline uint8_t scale8(uint8_t x, uint8_t scale); // Gamma correction
+static inline uint8_t argb_dim(uint8_t x); // Global brightness
+static inline argb_seg *argb_find_seg(uint16_t i);
+static inline volatile uint8_t *argb_pixel(const argb_seg *seg, uint16_t i);
+static inline void argb_put_rgb(argb_seg *seg, uint16_t i, uint8_t r, uint8_t g, uint8_t b);
+#if ARGB_PIXEL_FORMAT != ARGB_FMT_RAW
+static inline argb_packed argb_pack(uint8_t r, uint8_t g, uint8_t b);
+static inline void argb_unpack(argb_packed v, uint8_t *c);
+static inline argb_packed argb_load(uint16_t i);
+static inline void argb_store(argb_seg *seg, uint16_t i, argb_packed v);
+#endif
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_ATOMIC
+static inline void argb_store_white(argb_seg *seg, uint16_t i, uint8_t w);
+static inline void argb_store_word(argb_seg *seg, uint16_t i, argb_packed v);
+#endif
+static inline void argb_read_px(const argb_seg *seg, uint16_t i, uint8_t *c);
+#if ARGB_WHITE_EXTRACT
+static inline uint8_t argb_white_split(uint8_t *c);
+#endif
+#if ARGB_USE_POWER_LIMIT && (ARGB_PIXEL_FORMAT != ARGB_FMT_ATOMIC)
+static void argb_power_span(uint16_t start, uint16_t count, int8_t sign);
+#endif
+#if ARGB_SKIP_UNCHANGED
+static bool argb_frame_unchanged(void);
+#endif
+#if ARGB_USE_TRACE
+static argb_trace_rec argb_trace_buf[ARGB_TRACE_LEN]; ///< Trace ring
+static uint32_t argb_trace_head = 0;                   ///< Records written, ever
+static volatile bool argb_trace_on = true;             ///< Recording enabled
+static inline void argb_trace(argb_trace_ev ev, uint8_t arg8, uint16_t arg16);
+#define ARGB_TRACE(ev, a8, a16) argb_trace(ev, a8, a16)
+#else
+#define ARGB_TRACE(ev, a8, a16)
+#endif
+
+static bool argb_check_segments(const argb_segment *segs, uint8_t count,
+                                uint32_t *leds, uint32_t *bytes, uint32_t *reset_us);
+static void argb_apply_segments(const argb_segment *segs, uint8_t count,
+                                uint32_t leds, uint32_t wire, uint32_t reset_us);
+static bool argb_busy(void);
+static void argb_start(void);
+static void argb_enc_rewind(void);
+static void argb_fill_chunk(uint8_t c);
+static inline void argb_fill_half(uint8_t h);
+#if ARGB_USE_ENCODE_THREAD
+static void argb_enc_step(void);
+static THD_FUNCTION(argb_enc_thread, arg);
+#endif
 
 static void argb_tim_dma_delay_pulse(void *param, uint32_t flags);
 /// @} //Private
@@ -194,9 +416,237 @@ static void argb_tim_dma_delay_pulse(void *param, uint32_t flags);
 /**
  * @brief Init timer & prescalers
  * @param none
+ * @return #argb_state enum
+ * @note LED layout comes from compile-time settings,
+ *       ARGB_DYNAMIC_BUFFERS: buffers come from the system heap,
+ *       without CH_CFG_USE_HEAP use #argb_init_arena instead
+ */
+argb_state argb_init(void) 
+{
+#if ARGB_DYNAMIC_BUFFERS && CH_CFG_USE_HEAP
+    return argb_init_heap(argb_default_segs, sizeof(argb_default_segs) / sizeof(argb_default_segs[0]), NULL);
+#elif ARGB_DYNAMIC_BUFFERS
+    return ARGB_PARAM_ERR; // no heap to take buffers from
+#else
+    return argb_init_segments(argb_default_segs, sizeof(argb_default_segs) / sizeof(argb_default_segs[0]));
+#endif
+}
+
+/**
+ * @brief Init timer & prescalers with LED segment table
+ * @param[in] segs Segment table, one entry per LED type in chain order
+ * @param[in] count Segment quantity [1..ARGB_MAX_SEGMENTS]
+ * @return #argb_state enum
+ * @note Can be called again to change the layout while strip is idle
+ * @note ARGB_DYNAMIC_BUFFERS: layout must fit buffers already given
+ */
+argb_state argb_init_segments(const argb_segment *segs, uint8_t count)
+{
+    uint32_t leds, bytes, reset_us;
+
+    if (!argb_check_segments(segs, count, &leds, &bytes, &reset_us))
+        return ARGB_PARAM_ERR;
+#if ARGB_DYNAMIC_BUFFERS
+    if ((size_t) ARGB_PIXEL_BYTES(leds, bytes) > argb_buf_cap)
+        return ARGB_PARAM_ERR;
+#else
+    if (leds > NUM_PIXELS)
+        return ARGB_PARAM_ERR;
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+    if (bytes > NUM_BYTES)
+        return ARGB_PARAM_ERR;
+#endif
+#endif
+
+    if (argb_started && (argb_lock_state != ARGB_READY))
+        return ARGB_BUSY;
+
+    argb_apply_segments(segs, count, leds, bytes, reset_us);
+    return ARGB_OK;
+}
+
+#if ARGB_DYNAMIC_BUFFERS
+/**
+ * @brief Get memory needed by a layout
+ * @param[in] segs Segment table
+ * @param[in] count Segment quantity
+ * @return Arena size in bytes, 0 if table is wrong
+ */
+size_t argb_buf_size(const argb_segment *segs, uint8_t count)
+{
+    uint32_t leds, bytes, reset_us;
+
+    if (!argb_check_segments(segs, count, &leds, &bytes, &reset_us))
+        return 0;
+    return PWM_ARENA_BYTES + ARGB_ALIGN4(ARGB_PIXEL_BYTES(leds, bytes));
+}
+
+/**
+ * @brief Init driver with buffers carved from caller's memory
+ * @param[in] segs Segment table, one entry per LED type in chain order
+ * @param[in] count Segment quantity [1..ARGB_MAX_SEGMENTS]
+ * @param[in] arena Memory DMA can reach, #argb_buf_size bytes
+ * @param[in] size Arena size
+ * @return #argb_state enum
+ * @note Can be called again with another arena while strip is idle,
+ *       the old one is free after that
+ */
+argb_state argb_init_arena(const argb_segment *segs, uint8_t count, void *arena, size_t size)
+{
+    uint32_t leds, bytes, reset_us;
+    uintptr_t p = ARGB_ALIGN4((uintptr_t) arena);
+
+    if ((arena == NULL) || !argb_check_segments(segs, count, &leds, &bytes, &reset_us))
+        return ARGB_PARAM_ERR;
+    if (p - (uintptr_t) arena + argb_buf_size(segs, count) > size)
+        return ARGB_PARAM_ERR;
+    if (argb_started && (argb_lock_state != ARGB_READY))
+        return ARGB_BUSY;
+
+    // PWM values first, pixels after them, both word aligned
+#if !ARGB_USE_DBM
+    pwm_buf = (volatile dma_siz *) p;
+#endif
+    rgb_buf = (volatile uint8_t *) (p + PWM_ARENA_BYTES);
+    argb_buf_cap = ARGB_ALIGN4(ARGB_PIXEL_BYTES(leds, bytes));
+    argb_apply_segments(segs, count, leds, bytes, reset_us);
+    return ARGB_OK;
+}
+
+#if CH_CFG_USE_HEAP
+/**
+ * @brief Init driver with buffers allocated from a heap
+ * @param[in] segs Segment table, one entry per LED type in chain order
+ * @param[in] count Segment quantity [1..ARGB_MAX_SEGMENTS]
+ * @param[in] heap Heap shared with other users, NULL - system heap
+ * @return #argb_state enum
+ * @note Can be called again to resize the strip while it is idle, the
+ *       old buffers go back to the heap once new ones are in place
+ */
+argb_state argb_init_heap(const argb_segment *segs, uint8_t count, memory_heap_t *heap)
+{
+    size_t need = argb_buf_size(segs, count);
+    void *old = argb_heap_block;
+
+    if (need == 0)
+        return ARGB_PARAM_ERR;
+    if (argb_started && (argb_lock_state != ARGB_READY))
+        return ARGB_BUSY;
+
+    void *block = chHeapAllocAligned(heap, need, 4);
+    if (block == NULL)
+        return ARGB_PARAM_ERR;
+
+    argb_state st = argb_init_arena(segs, count, block, need);
+    if (st != ARGB_OK)
+    {
+        chHeapFree(block);
+        return st;
+    }
+    argb_heap_block = block;
+    if (old != NULL)
+        chHeapFree(old);
+    return ARGB_OK;
+}
+#endif
+#endif
+
+/**
+ * @addtogroup Private_entities
+ * @{ */
+
+/**
+ * @brief Private method to check segment table
+ * @param[in] segs Segment table
+ * @param[in] count Segment quantity
+ * @param[out] leds LEDs in the chain
+ * @param[out] bytes Wire bytes of the chain
+ * @param[out] reset_us RET code length: #ARGB_RESET_US if set, else longest of chips in the chain
+ * @return true if table is valid
+ */
+static bool argb_check_segments(const argb_segment *segs, uint8_t count,
+                                uint32_t *leds, uint32_t *bytes, uint32_t *reset_us)
+{
+    uint32_t led = 0;
+
+    *bytes = 0;
+    *reset_us = 0;
+    if ((segs == NULL) || (count == 0) || (count > ARGB_MAX_SEGMENTS))
+        return false;
+
+    // check the whole table before touching anything
+    for (uint8_t s = 0; s < count; s++)
+    {
+        if ((segs[s].start != led) || (segs[s].length == 0) ||
+            ((segs[s].bpp != 3) && (segs[s].bpp != 4)) ||
+            (segs[s].order > ARGB_ORDER_BGR) || (segs[s].chip > ARGB_CHIP_SK6812) ||
+            !argb_chip_ok[segs[s].chip])
+            return false;
+        if (*reset_us < argb_chip_res[segs[s].chip])
+            *reset_us = argb_chip_res[segs[s].chip];
+        led += segs[s].length;
+        *bytes += (uint32_t) segs[s].length * segs[s].bpp;
+    }
+    *leds = led;
+    if (ARGB_RESET_US != 0)
+        *reset_us = ARGB_RESET_US; // user's choice, may be shorter than datasheet
+
+    // 16-bit LED positions and byte offsets
+    return (led <= 0xFFFF) && (*bytes <= 0xFFFF);
+}
+
+/**
+ * @brief Private method to switch to a checked segment table
+ * @param[in] segs Segment table
+ * @param[in] count Segment quantity
+ * @param[in] leds LEDs in the chain
+ * @param[in] wire Wire bytes of the chain
+ * @param[in] reset_us RET code length
+ * @note Strip is idle, buffers are big enough
  */
-void argb_init(void) 
+static void argb_apply_segments(const argb_segment *segs, uint8_t count,
+                                uint32_t leds, uint32_t wire, uint32_t reset_us)
 {
+    uint32_t bytes = 0;
+#if ARGB_PIXEL_FORMAT != ARGB_FMT_RAW
+    (void) wire; // compact buffers are sized by LED count
+#endif
+
+    // resolve segments into buffer positions and PWM values
+    for (uint8_t s = 0; s < count; s++)
+    {
+        argb_seg *seg = &argb_segs[s];
+        seg->start = segs[s].start;
+        seg->end = segs[s].start + segs[s].length;
+        seg->offset = bytes;
+        bytes += (uint32_t) segs[s].length * segs[s].bpp;
+        seg->limit = bytes;
+        seg->bpp = segs[s].bpp;
+        memcpy(seg->map, argb_order_map[segs[s].order], sizeof(seg->map));
+        seg->hi = argb_chip_pwm[segs[s].chip][0];
+        seg->lo = argb_chip_pwm[segs[s].chip][1];
+#if ARGB_USE_POWER_LIMIT
+        memset(seg->sum, 0, sizeof(seg->sum));
+        memcpy(seg->ua, argb_chip_current[segs[s].chip], sizeof(seg->ua));
+        seg->idle = argb_chip_current[segs[s].chip][4];
+#endif
+    }
+    argb_seg_count = count;
+    argb_seg_hint = &argb_segs[0];
+    argb_total_bytes = bytes;
+    argb_num_leds = leds;
+    argb_buf_bytes = ARGB_PIXEL_BYTES(leds, wire);
+    argb_reset_ticks = ARGB_NS2TICKS(reset_us * 1000);
+    memset((uint8_t *) rgb_buf, 0, argb_buf_bytes);
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+    enc_src = rgb_buf;
+    enc_hook = NULL; // made for the old layout
+#endif
+    ARGB_TOUCH();
+
+    if (argb_started)
+        return;
+
     // initialize PWM with config
     pwmStart(&TIM_HANDLE, &pwm2_conf);
 
@@ -207,10 +657,24 @@ void argb_init(void)
 
     // set up DMA properties
     dmaStreamSetPeripheral(DMA_HANDLE, &TIM_HANDLE.tim->CCR[TIM_CH]);
+#if ARGB_USE_DBM
+    dmaStreamSetMemory0(DMA_HANDLE, &pwm_buf0[0]);
+    dmaStreamSetMemory1(DMA_HANDLE, &pwm_buf1[0]);
+    dmaStreamSetTransactionSize(DMA_HANDLE, PWM_DBM_LEN);
+#else
     dmaStreamSetMemory0(DMA_HANDLE, &pwm_buf[0]);
     dmaStreamSetTransactionSize(DMA_HANDLE, PWM_BUF_LEN);
+#endif
     dmaStreamSetMode(DMA_HANDLE, DMA_MODE);
+
+#if ARGB_USE_ENCODE_THREAD
+    chSemObjectInit(&enc_sem, 0);
+    chThdCreateStatic(argb_enc_wa, sizeof(argb_enc_wa), ARGB_ENCODE_THREAD_PRIO, argb_enc_thread, NULL);
+#endif
+
+    argb_started = true;
 }
+/// @} //Private
 
 /**
  * @brief Fill ALL LEDs with (0,0,0)
@@ -243,71 +707,13 @@ void argb_set_brightness(uint8_t br)
  */
 void argb_set_rgb(uint16_t i, uint8_t r, uint8_t g, uint8_t b) 
 {
+    ARGB_TOUCH();
+    argb_seg *seg = argb_find_seg(i);
+
     // overflow protection
-    if (i >= NUM_PIXELS) {
-        // uint16_t _i = i / NUM_PIXELS;
-        // i -= _i * NUM_PIXELS;
+    if (seg == NULL)
         return;
-    }
-    // set brightness
-    r /= 256 / ((uint16_t) argb_brightness + 1);
-    g /= 256 / ((uint16_t) argb_brightness + 1);
-    b /= 256 / ((uint16_t) argb_brightness + 1);
-#if USE_GAMMA_CORRECTION
-    g = scale8(g, 0xB0);
-    b = scale8(b, 0xF0);
-#endif
-
-// support multiple different strips with white channel
-#if defined(MIXED_RGB_GRB) && defined(RGBW)
-    // Subpixel chain order
-    // RGBW or GRBW
-    if ((i >= rgb_start) && (i <= rgb_end))
-    {
-        rgb_buf[4 * i] = r;
-        rgb_buf[4 * i + 1] = g;
-        rgb_buf[4 * i + 2] = b;
-    }
-    else if ((i >= grb_start) && (i <= grb_end))
-    {
-        rgb_buf[4 * i] = g;
-        rgb_buf[4 * i + 1] = r;
-        rgb_buf[4 * i + 2] = b;
-    }
-#elif defined(MIXED_RGB_GRB) && !defined(RGBW)
-    // Subpixel chain order
-    // RGBW or GRBW
-    if ((i >= rgb_start) && (i <= rgb_end))
-    {
-        rgb_buf[3 * i] = r;
-        rgb_buf[3 * i + 1] = g;
-        rgb_buf[3 * i + 2] = b;
-    }
-    else if ((i >= grb_start) && (i <= grb_end))
-    {
-        rgb_buf[3 * i] = g;
-        rgb_buf[3 * i + 1] = r;
-        rgb_buf[3 * i + 2] = b;
-    }
-// one type of strip
-// RGBW, GRB, or RGB
-#elif defined(SK6812) && defined(RGBW)
-    rgb_buf[4 * i] = r;
-    rgb_buf[4 * i + 1] = g;
-    rgb_buf[4 * i + 2] = b;
-#elif defined(WS2812) && defined(RGBW)
-    rgb_buf[4 * i] = g;
-    rgb_buf[4 * i + 1] = r;
-    rgb_buf[4 * i + 2] = b;
-#elif defined(WS2812)
-    rgb_buf[3 * i] = g;
-    rgb_buf[3 * i + 1] = r;
-    rgb_buf[3 * i + 2] = b;
-#else
-    rgb_buf[3 * i] = r;
-    rgb_buf[3 * i + 1] = g;
-    rgb_buf[3 * i + 2] = b;
-#endif
+    argb_put_rgb(seg, i, r, g, b);
 }
 
 /**
@@ -329,20 +735,120 @@ void argb_set_hsv(uint16_t i, uint8_t hue, uint8_t sat, uint8_t val)
  * @brief Set White component in strip by index
  * @param[in] i LED position
  * @param[in] w White component [0..255]
+ * @note Compact formats: no-op, white comes from the palette entry
+ * @note With ARGB_WHITE_EXTRACT next RGB write of the LED replaces it
  */
 void argb_set_white(uint16_t i, uint8_t w) 
 {
-#if !defined(RGBW)
-    return;
+    ARGB_TOUCH();
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_ATOMIC
+    argb_seg *seg = argb_find_seg(i);
+
+    if ((seg != NULL) && (seg->bpp == 4))
+        argb_store_white(seg, i, argb_dim(w));
+#elif ARGB_PIXEL_FORMAT != ARGB_FMT_RAW
+    (void) i;
+    (void) w;
+#else
+    argb_seg *seg = argb_find_seg(i);
+
+    // no white part in RGB segments
+    if ((seg == NULL) || (seg->bpp != 4))
+        return;
+
+    volatile uint8_t *px = argb_pixel(seg, i);
+    w = argb_dim(w); // set brightness
+#if ARGB_USE_POWER_LIMIT
+    seg->sum[3] += w - px[3];
+#endif
+    px[3] = w; // set white part
 #endif
-    w /= 256 / ((uint16_t) argb_brightness + 1); // set brightness
-    rgb_buf[4 * i + 3] = w;                // set white part
 }
 
+/**
+ * @brief Fill LEDs range with RGB color
+ * @param[in] start First LED position
+ * @param[in] end Last LED position (inclusive)
+ * @param[in] r Red component   [0..255]
+ * @param[in] g Green component [0..255]
+ * @param[in] b Blue component  [0..255]
+ */
 void argb_fill_rgb_range(uint16_t start, uint16_t end, uint8_t r, uint8_t g, uint8_t b) 
 {
-    for (volatile uint16_t i = start; i <= end; i++)
-        argb_set_rgb(i, r, g, b);
+    ARGB_TOUCH();
+    argb_seg *seg = argb_find_seg(start);
+    const argb_seg *last = &argb_segs[argb_seg_count];
+
+    // brightness & gamma once for the whole range
+    r = argb_dim(r);
+    g = argb_dim(g);
+    b = argb_dim(b);
+#if USE_GAMMA_CORRECTION
+    g = scale8(g, 0xB0);
+    b = scale8(b, 0xF0);
+#endif
+
+#if ARGB_PIXEL_FORMAT != ARGB_FMT_RAW
+    // pack once, store many
+    argb_packed v = argb_pack(r, g, b);
+    for (; (seg != NULL) && (seg < last) && (start <= end); seg++)
+    {
+        uint16_t stop = (end < seg->end) ? end + 1 : seg->end;
+        for (; start < stop; start++)
+            argb_store(seg, start, v);
+    }
+#else
+#if ARGB_WHITE_EXTRACT
+    // split once, used by RGBW segments
+    uint8_t c4[3] = {r, g, b};
+    const uint8_t w4 = argb_white_split(c4);
+#endif
+
+    // walk segments, plain strided stores inside each one
+    for (; (seg != NULL) && (seg < last) && (start <= end); seg++)
+    {
+        uint16_t stop = (end < seg->end) ? end + 1 : seg->end;
+        volatile uint8_t *px = argb_pixel(seg, start);
+        const uint8_t ri = seg->map[0], gi = seg->map[1], bi = seg->map[2];
+        const uint8_t bpp = seg->bpp;
+#if ARGB_WHITE_EXTRACT
+        const bool white = (bpp == 4);
+        const uint8_t sr = white ? c4[0] : r, sg = white ? c4[1] : g, sb = white ? c4[2] : b;
+#else
+        const uint8_t sr = r, sg = g, sb = b;
+#endif
+#if ARGB_USE_POWER_LIMIT
+        uint32_t dr = 0, dg = 0, db = 0, dw = 0;
+#endif
+
+        for (; start < stop; start++, px += bpp)
+        {
+#if ARGB_USE_POWER_LIMIT
+            dr += sr - px[ri];
+            dg += sg - px[gi];
+            db += sb - px[bi];
+#endif
+            px[ri] = sr;
+            px[gi] = sg;
+            px[bi] = sb;
+#if ARGB_WHITE_EXTRACT
+            if (white)
+            {
+#if ARGB_USE_POWER_LIMIT
+                dw += w4 - px[3];
+#endif
+                px[3] = w4;
+            }
+#endif
+        }
+#if ARGB_USE_POWER_LIMIT
+        seg->sum[0] += dr;
+        seg->sum[1] += dg;
+        seg->sum[2] += db;
+        seg->sum[3] += dw;
+#endif
+    }
+#endif
 }
 
 /**
@@ -353,7 +859,7 @@ void argb_fill_rgb_range(uint16_t start, uint16_t end, uint8_t r, uint8_t g, uin
  */
 void argb_fill_rgb(uint8_t r, uint8_t g, uint8_t b) 
 {
-    argb_fill_rgb_range(0, NUM_LEDS-1, r, g, b);
+    argb_fill_rgb_range(0, argb_num_leds - 1, r, g, b);
 }
 
 void argb_fill_hsv_range(uint16_t start, uint16_t end, uint8_t hue, uint8_t sat, uint8_t val) 
@@ -372,114 +878,688 @@ void argb_fill_hsv_range(uint16_t start, uint16_t end, uint8_t hue, uint8_t sat,
  */
 void argb_fill_hsv(uint8_t hue, uint8_t sat, uint8_t val) 
 {
-    argb_fill_hsv_range(0, NUM_LEDS-1, hue, sat, val);
+    argb_fill_hsv_range(0, argb_num_leds - 1, hue, sat, val);
 }
 
-void argb_fill_white_range(uint16_t start, uint16_t end, uint8_t w) 
+/**
+ * @brief Fill LEDs range with noise mapped to HSV colors
+ * @param[in] start First LED position
+ * @param[in] end Last LED position (inclusive)
+ * @param[in] nz Noise field, LED k takes the sample at x + k * dx
+ * @param[in] lo Color of noise 0
+ * @param[in] hi Color of noise 255, hue goes up from lo's and wraps
+ * @note Lattice corners are shared by all LEDs of a cell,
+ *       a sample costs about as much as the HSV conversion
+ */
+void argb_fill_noise_hsv(uint16_t start, uint16_t end, const argb_noise *nz, hsv_t lo, hsv_t hi)
 {
-    for (volatile uint16_t i = start; i <= end; i++)
-        argb_set_white(i, w);
+    ARGB_TOUCH();
+    argb_seg *seg = argb_find_seg(start);
+    const argb_seg *last = &argb_segs[argb_seg_count];
+    const uint8_t dh = hi.h - lo.h;
+    const int16_t ds = hi.s - lo.s, dv = hi.v - lo.v;
+    noise8_row w;
+
+    noise8_row_init(&w, nz->kind == ARGB_NOISE_GRADIENT, nz->dims, nz->x, nz->dx, nz->y, nz->z);
+    for (; (seg != NULL) && (seg < last) && (start <= end); seg++)
+    {
+        uint16_t stop = (end < seg->end) ? end + 1 : seg->end;
+        for (; start < stop; start++)
+        {
+            uint8_t n = noise8_row_next(&w);
+            uint16_t u = n + (n >> 7); // [0..256], so 255 reaches hi
+            hsv_t hsv = {.h = lo.h + ((dh * u) >> 8), .s = lo.s + ((ds * u) >> 8), .v = lo.v + ((dv * u) >> 8)};
+            rgb_t rgb;
+
+            hsv2rgb_spectrum(hsv, &rgb);
+            argb_put_rgb(seg, start, rgb.r, rgb.g, rgb.b);
+        }
+    }
 }
 
 /**
- * @brief Set ALL White components in strip
+ * @brief Fill White components in LEDs range
+ * @param[in] start First LED position
+ * @param[in] end Last LED position (inclusive)
  * @param[in] w White component [0..255]
  */
-void argb_fill_white(uint8_t w) 
+void argb_fill_white_range(uint16_t start, uint16_t end, uint8_t w) 
 {
-    argb_fill_white_range(0, NUM_LEDS-1, w);
+    ARGB_TOUCH();
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_ATOMIC
+    argb_seg *seg = argb_find_seg(start);
+    const argb_seg *last = &argb_segs[argb_seg_count];
+
+    w = argb_dim(w);
+    for (; (seg != NULL) && (seg < last) && (start <= end); seg++)
+    {
+        uint16_t stop = (end < seg->end) ? end + 1 : seg->end;
+        for (; (seg->bpp == 4) && (start < stop); start++)
+            argb_store_white(seg, start, w);
+        start = stop;
+    }
+#elif ARGB_PIXEL_FORMAT != ARGB_FMT_RAW
+    (void) start;
+    (void) end;
+    (void) w;
+#else
+    argb_seg *seg = argb_find_seg(start);
+    const argb_seg *last = &argb_segs[argb_seg_count];
+
+    w = argb_dim(w);
+    for (; (seg != NULL) && (seg < last) && (start <= end); seg++)
+    {
+        uint16_t stop = (end < seg->end) ? end + 1 : seg->end;
+
+        if (seg->bpp != 4) // no white part in RGB segments
+        {
+            start = stop;
+            continue;
+        }
+        for (volatile uint8_t *px = argb_pixel(seg, start); start < stop; start++, px += 4)
+        {
+#if ARGB_USE_POWER_LIMIT
+            seg->sum[3] += w - px[3];
+#endif
+            px[3] = w;
+        }
+    }
+#endif
 }
 
 /**
- * @brief Get current DMA status
- * @param none
- * @return #argb_state enum
+ * @brief Set ALL White components in strip
+ * @param[in] w White component [0..255]
  */
-argb_state argb_ready(void) 
+void argb_fill_white(uint8_t w) 
 {
-    return argb_lock_state;
+    argb_fill_white_range(0, argb_num_leds - 1, w);
 }
 
 /**
- * @brief Update strip
- * @param none
- * @return #argb_state enum
+ * @brief Move LEDs span to another position
+ * @param[in] dst First LED of destination
+ * @param[in] src First LED of source
+ * @param[in] count LED quantity, cut at the chain end
+ * @note Stored colors are copied as is, spans may overlap.
+ *       Spans inside one segment (or of same layout) are moved
+ *       as bytes, other ones LED by LED.
  */
-argb_state argb_show(void) 
+void argb_move(uint16_t dst, uint16_t src, uint16_t count)
 {
-    argb_lock_state = ARGB_BUSY;
+    ARGB_TOUCH();
+    const uint16_t leds = argb_num_leds; // 0 before a layout is set
 
-    // if nothing to do or DMA busy
-    if ((buf_counter != 0) || (DMA_HANDLE->stream->CR & STM32_DMA_CR_EN))
+    if ((src == dst) || (src >= leds) || (dst >= leds))
+        return;
+    if (count > leds - src)
+        count = leds - src;
+    if (count > leds - dst)
+        count = leds - dst;
+    if (count == 0)
+        return;
+
+#if ARGB_USE_POWER_LIMIT && (ARGB_PIXEL_FORMAT != ARGB_FMT_ATOMIC)
+    argb_power_span(dst, count, -1);
+#endif
+
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+    argb_seg *sseg = argb_find_seg(src);
+    argb_seg *dseg = argb_find_seg(dst);
+
+    if ((src + count <= sseg->end) && (dst + count <= dseg->end) &&
+        (sseg->bpp == dseg->bpp) && (memcmp(sseg->map, dseg->map, 3) == 0))
     {
-        return ARGB_BUSY;
-    } 
-    else 
+        memmove((uint8_t *) argb_pixel(dseg, dst), (const uint8_t *) argb_pixel(sseg, src),
+                count * sseg->bpp);
+    }
+    else
     {
-        for (volatile uint8_t i = 0; i < 8; i++) 
+        // walk away from the overlap
+        uint16_t k = (dst < src) ? 0 : count - 1;
+        const int8_t step = (dst < src) ? 1 : -1;
+
+        for (uint16_t n = count; n != 0; n--, k += step)
         {
-#if defined(MIXED_RGB_GRB)
-            // if the first LEDs are SK6812
-            if (grb_start == 0)
-            {
-                // set first transfer from first values
-                pwm_buf[i] = (((rgb_buf[0] << i) & 0x80) > 0) ?      GRB_PWM_HI : GRB_PWM_LO;
-                pwm_buf[i + 8] = (((rgb_buf[1] << i) & 0x80) > 0) ?  GRB_PWM_HI : GRB_PWM_LO;
-                pwm_buf[i + 16] = (((rgb_buf[2] << i) & 0x80) > 0) ? GRB_PWM_HI : GRB_PWM_LO;
-                pwm_buf[i + 24] = (((rgb_buf[3] << i) & 0x80) > 0) ? GRB_PWM_HI : GRB_PWM_LO;
-                pwm_buf[i + 32] = (((rgb_buf[4] << i) & 0x80) > 0) ? GRB_PWM_HI : GRB_PWM_LO;
-                pwm_buf[i + 40] = (((rgb_buf[5] << i) & 0x80) > 0) ? GRB_PWM_HI : GRB_PWM_LO;
-#if defined(RGBW)
-                pwm_buf[i + 48] = (((rgb_buf[6] << i) & 0x80) > 0) ? GRB_PWM_HI : GRB_PWM_LO;
-                pwm_buf[i + 56] = (((rgb_buf[7] << i) & 0x80) > 0) ? GRB_PWM_HI : GRB_PWM_LO;
+            uint8_t c[4];
+            argb_read_px(argb_find_seg(src + k), src + k, c);
+
+            argb_seg *seg = argb_find_seg(dst + k);
+            volatile uint8_t *px = argb_pixel(seg, dst + k);
+            px[seg->map[0]] = c[0];
+            px[seg->map[1]] = c[1];
+            px[seg->map[2]] = c[2];
+            if (seg->bpp == 4)
+                px[3] = c[3];
+        }
+    }
+#elif ARGB_PIXEL_FORMAT == ARGB_FMT_PAL4
+    uint16_t k = (dst < src) ? 0 : count - 1;
+    const int8_t step = (dst < src) ? 1 : -1;
+
+    for (uint16_t n = count; n != 0; n--, k += step)
+        argb_store(NULL, dst + k, argb_load(src + k));
+#elif ARGB_PIXEL_FORMAT == ARGB_FMT_ATOMIC
+    // whole words swapped with their sums, other writers never see
+    // half of a LED and their writes are either moved over or kept
+    uint16_t k = (dst < src) ? 0 : count - 1;
+    const int8_t step = (dst < src) ? 1 : -1;
+
+    for (uint16_t n = count; n != 0; n--, k += step)
+        argb_store_word(argb_find_seg(dst + k), dst + k, argb_load(src + k));
+#else
+    // LED-indexed buffer, segments don't matter
+    const uint8_t size = ARGB_PIXEL_BYTES(1, 0);
+    memmove((uint8_t *) &rgb_buf[dst * size], (const uint8_t *) &rgb_buf[src * size], count * size);
 #endif
-            }
-            else if (rgb_start == 0)
+
+#if ARGB_USE_POWER_LIMIT && (ARGB_PIXEL_FORMAT != ARGB_FMT_ATOMIC)
+    argb_power_span(dst, count, 1);
+#endif
+}
+
+/**
+ * @brief Write LEDs span from packed R, G, B bytes
+ * @param[in] start First LED position
+ * @param[in] rgb Colors, 3 bytes per LED
+ * @param[in] count LED quantity
+ * @return LEDs written, less than count if span leaves the chain
+ * @note Values are stored as is, without brightness & gamma:
+ *       meant for frames prepared by a host. White extraction
+ *       still applies to RGBW LEDs
+ */
+uint16_t argb_write_rgb(uint16_t start, const uint8_t *rgb, uint16_t count)
+{
+    ARGB_TOUCH();
+    argb_seg *seg = argb_find_seg(start);
+    const argb_seg *last = &argb_segs[argb_seg_count];
+    uint16_t done = 0;
+
+    for (; (seg != NULL) && (seg < last) && (done < count); seg++)
+    {
+        uint16_t n = seg->end - start;
+        if (n > count - done)
+            n = count - done;
+
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+        // swizzle straight into the wire order
+        volatile uint8_t *px = argb_pixel(seg, start);
+        const uint8_t ri = seg->map[0], gi = seg->map[1], bi = seg->map[2];
+        const uint8_t bpp = seg->bpp;
+#if ARGB_USE_POWER_LIMIT
+        uint32_t dr = 0, dg = 0, db = 0;
+#endif
+
+#if ARGB_WHITE_EXTRACT
+        if (bpp == 4)
+        {
+            // split per LED, W goes along
+            for (uint16_t k = 0; k < n; k++, px += 4, rgb += 3)
             {
-                pwm_buf[i] = (((rgb_buf[0] << i) & 0x80) > 0) ?      RGB_PWM_HI : RGB_PWM_LO;
-                pwm_buf[i + 8] = (((rgb_buf[1] << i) & 0x80) > 0) ?  RGB_PWM_HI : RGB_PWM_LO;
-                pwm_buf[i + 16] = (((rgb_buf[2] << i) & 0x80) > 0) ? RGB_PWM_HI : RGB_PWM_LO;
-                pwm_buf[i + 24] = (((rgb_buf[3] << i) & 0x80) > 0) ? RGB_PWM_HI : RGB_PWM_LO;
-                pwm_buf[i + 32] = (((rgb_buf[4] << i) & 0x80) > 0) ? RGB_PWM_HI : RGB_PWM_LO;
-                pwm_buf[i + 40] = (((rgb_buf[5] << i) & 0x80) > 0) ? RGB_PWM_HI : RGB_PWM_LO;
-#if defined(RGBW)
-                pwm_buf[i + 48] = (((rgb_buf[6] << i) & 0x80) > 0) ? RGB_PWM_HI : RGB_PWM_LO;
-                pwm_buf[i + 56] = (((rgb_buf[7] << i) & 0x80) > 0) ? RGB_PWM_HI : RGB_PWM_LO;
+                uint8_t c[3] = {rgb[0], rgb[1], rgb[2]};
+                uint8_t w = argb_white_split(c);
+#if ARGB_USE_POWER_LIMIT
+                dr += c[0] - px[ri];
+                dg += c[1] - px[gi];
+                db += c[2] - px[bi];
+                seg->sum[3] += w - px[3];
 #endif
+                px[ri] = c[0];
+                px[gi] = c[1];
+                px[bi] = c[2];
+                px[3] = w;
             }
-#else
-            // set first transfer from first values
-            pwm_buf[i] = (((rgb_buf[0] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            pwm_buf[i + 8] = (((rgb_buf[1] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            pwm_buf[i + 16] = (((rgb_buf[2] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            pwm_buf[i + 24] = (((rgb_buf[3] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            pwm_buf[i + 32] = (((rgb_buf[4] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            pwm_buf[i + 40] = (((rgb_buf[5] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-#ifdef RGBW
-            pwm_buf[i + 48] = (((rgb_buf[6] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-            pwm_buf[i + 56] = (((rgb_buf[7] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
+        }
+        else
 #endif
+        for (uint16_t k = 0; k < n; k++, px += bpp, rgb += 3)
+        {
+#if ARGB_USE_POWER_LIMIT
+            dr += rgb[0] - px[ri];
+            dg += rgb[1] - px[gi];
+            db += rgb[2] - px[bi];
 #endif
+            px[ri] = rgb[0];
+            px[gi] = rgb[1];
+            px[bi] = rgb[2];
         }
+#if ARGB_USE_POWER_LIMIT
+        seg->sum[0] += dr;
+        seg->sum[1] += dg;
+        seg->sum[2] += db;
+#endif
+#else
+        for (uint16_t k = 0; k < n; k++, rgb += 3)
+            argb_store(seg, start + k, argb_pack(rgb[0], rgb[1], rgb[2]));
+#endif
+        start += n;
+        done += n;
+    }
+    return done;
+}
+
+#if ARGB_WHITE_EXTRACT
+/**
+ * @brief Split R, G, B span into R, G, B, W like RGBW LEDs get it
+ * @param[in] rgb Colors, 3 bytes per LED
+ * @param[out] rgbw Colors, 4 bytes per LED, may not overlap rgb
+ * @param[in] count LED quantity
+ */
+void argb_rgb_to_rgbw(const uint8_t *rgb, uint8_t *rgbw, uint16_t count)
+{
+    for (; count != 0; count--, rgb += 3, rgbw += 4)
+    {
+        rgbw[0] = rgb[0];
+        rgbw[1] = rgb[1];
+        rgbw[2] = rgb[2];
+        rgbw[3] = argb_white_split(rgbw);
+    }
+}
+#endif
+
+#if defined(ARGB_PALETTE_SIZE)
+/**
+ * @brief Set palette entry
+ * @param[in] idx Entry index [0..255] or [0..15]
+ * @param[in] r Red component   [0..255]
+ * @param[in] g Green component [0..255]
+ * @param[in] b Blue component  [0..255]
+ * @param[in] w White component [0..255], used by RGBW segments only
+ * @note Brightness & gamma are applied here, LEDs pointing
+ *       at the entry change on next #argb_show
+ */
+void argb_set_palette(uint8_t idx, uint8_t r, uint8_t g, uint8_t b, uint8_t w)
+{
+    ARGB_TOUCH();
+    if (!ARGB_PAL_OK(idx))
+        return;
+
+    g = argb_dim(g);
+    b = argb_dim(b);
+#if USE_GAMMA_CORRECTION
+    g = scale8(g, 0xB0);
+    b = scale8(b, 0xF0);
+#endif
+    argb_palette[idx][0] = argb_dim(r);
+    argb_palette[idx][1] = g;
+    argb_palette[idx][2] = b;
+    argb_palette[idx][3] = argb_dim(w);
+}
+
+/**
+ * @brief Set LED by palette index
+ * @param[in] i LED position
+ * @param[in] idx Palette entry
+ */
+void argb_set_index(uint16_t i, uint8_t idx)
+{
+    ARGB_TOUCH();
+    argb_seg *seg = argb_find_seg(i);
+
+    if ((seg == NULL) || (!ARGB_PAL_OK(idx)))
+        return;
+    argb_store(seg, i, idx);
+}
+
+/**
+ * @brief Fill LEDs range by palette index
+ * @param[in] start First LED position
+ * @param[in] end Last LED position
+ * @param[in] idx Palette entry
+ */
+void argb_fill_index_range(uint16_t start, uint16_t end, uint8_t idx)
+{
+    ARGB_TOUCH();
+    uint16_t leds = argb_num_leds;
+
+    if (!ARGB_PAL_OK(idx) || (start >= leds))
+        return;
+    if (end >= leds)
+        end = leds - 1;
+
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_PAL8
+    if (start <= end)
+        memset((uint8_t *) &rgb_buf[start], idx, end - start + 1);
+#else
+    for (; start <= end; start++)
+        argb_store(NULL, start, idx);
+#endif
+}
+
+/**
+ * @brief Fill LEDs range with noise as palette index
+ * @param[in] start First LED position
+ * @param[in] end Last LED position
+ * @param[in] nz Noise field, LED k takes the sample at x + k * dx
+ * @note Noise is scaled to the palette size, a 16-entry palette
+ *       gets the top 4 bits
+ */
+void argb_fill_noise_index(uint16_t start, uint16_t end, const argb_noise *nz)
+{
+    ARGB_TOUCH();
+    uint16_t leds = argb_num_leds;
+    noise8_row w;
+
+    if (start >= leds)
+        return;
+    if (end >= leds)
+        end = leds - 1;
+
+    noise8_row_init(&w, nz->kind == ARGB_NOISE_GRADIENT, nz->dims, nz->x, nz->dx, nz->y, nz->z);
+    for (; start <= end; start++)
+    {
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_PAL8
+        rgb_buf[start] = noise8_row_next(&w);
+#else
+        argb_store(NULL, start, (noise8_row_next(&w) * ARGB_PALETTE_SIZE) >> 8);
+#endif
+    }
+}
+
+/**
+ * @brief Get LED's palette index
+ * @param[in] i LED position
+ * @return Palette entry, zero if out of chain
+ */
+uint8_t argb_get_index(uint16_t i)
+{
+    if (argb_find_seg(i) == NULL)
+        return 0;
+    return argb_load(i);
+}
+#endif
+
+#if ARGB_USE_POWER_LIMIT
+/**
+ * @brief Limit strip current
+ * @param[in] ma Current limit in mA, 0 - no limit
+ * @note Frame is scaled down at encode time, #rgb_buf keeps original values
+ */
+void argb_set_power_limit(uint32_t ma)
+{
+    ARGB_TOUCH();
+    argb_power_limit = ma;
+}
+
+/**
+ * @brief Private method to estimate frame current from channel sums
+ * @param[out] idle Idle current of all LEDs, uA
+ * @return Current of lit channels, uA
+ */
+static uint32_t argb_power_ua(uint32_t *idle)
+{
+    uint64_t ua = 0;
+
+    *idle = 0;
+    for (const argb_seg *seg = &argb_segs[0]; seg < &argb_segs[argb_seg_count]; seg++)
+    {
+        for (uint8_t c = 0; c < 4; c++)
+            ua += (uint64_t) seg->sum[c] * seg->ua[c];
+        *idle += (uint32_t) (seg->end - seg->start) * seg->idle * 1000;
+    }
+    return (ua > UINT32_MAX) ? UINT32_MAX : (uint32_t) ua;
+}
+
+/**
+ * @brief Get estimated strip current
+ * @param none
+ * @return Current of the frame in #rgb_buf before limiting, mA
+ */
+uint32_t argb_get_power(void)
+{
+    uint32_t idle;
+    uint32_t ua = argb_power_ua(&idle);
+    return (ua + idle) / 1000;
+}
+#endif
+
+/**
+ * @brief Get LED quantity of the chain
+ * @return LEDs in the segment table
+ */
+uint16_t argb_get_num_leds(void)
+{
+    return argb_num_leds;
+}
+
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+/**
+ * @brief Set encoder made for the layout just set
+ * @param[in] enc Encoder, NULL - segment table one
+ * @note Every layout change drops it. Cross-fades and frames scaled by
+ *       the power limit still go through the segment table encoder
+ */
+void argb_set_encoder(argb_encoder enc)
+{
+    enc_hook = enc;
+}
+#endif
+
+/**
+ * @brief Get current DMA status
+ * @param none
+ * @return #argb_state enum
+ */
+argb_state argb_ready(void) 
+{
+    return argb_lock_state;
+}
 
-        // wait for PWM to be ready
-        while (pwmIsChannelEnabledI(&TIM_HANDLE, (TIM_CH)));  
+#if ARGB_SKIP_UNCHANGED
+/**
+ * @brief Mark frame as changed
+ * @param none
+ * @note Needed only after writing #rgb_buf directly
+ */
+void argb_touch(void)
+{
+    ARGB_TOUCH();
+}
+
+/**
+ * @brief Get count of frames skipped as unchanged
+ * @param none
+ * @return #argb_show calls that sent nothing
+ */
+uint32_t argb_get_skipped(void)
+{
+    return argb_skipped;
+}
+#endif
 
-        // enable half and full transfer interrupt along with stream
-        DMA_HANDLE->stream->CR |= STM32_DMA_CR_TCIE | STM32_DMA_CR_HTIE;
-        dmaStreamEnable(DMA_HANDLE);
+/**
+ * @brief Update strip
+ * @param none
+ * @return #argb_state enum
+ */
+argb_state argb_show(void) 
+{
+    if (argb_seg_count == 0)
+        return ARGB_PARAM_ERR; // no layout, driver isn't started
+    argb_lock_state = ARGB_BUSY;
 
-        // enable TIM DMA requests
-        TIM_HANDLE.tim->DIER |= STM32_TIM_DIER_CC4DE;
-        TIM_HANDLE.tim->CNT = 0;
-        TIM_HANDLE.tim->CR1 |= STM32_TIM_CR1_CEN;
-        pwmEnableChannel(&TIM_HANDLE, TIM_CH, 0);
+    // if nothing to do or DMA busy
+    if (argb_busy())
+    {
+        ARGB_TRACE(ARGB_TR_SHOW, 0, 1);
+        return ARGB_BUSY;
+    } 
+    else 
+    {
+        ARGB_TRACE(ARGB_TR_SHOW, 0, 0);
+#if ARGB_SKIP_UNCHANGED
+        if (argb_frame_unchanged())
+        {
+            ARGB_TRACE(ARGB_TR_SKIP, 0, 0);
+            argb_skipped++;
+            argb_lock_state = ARGB_READY;
+            return ARGB_OK;
+        }
+#endif
 
-        buf_counter = 2;
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+        enc_src = rgb_buf;
+        enc_fade_b = NULL;
+#endif
+        argb_start();
         return ARGB_OK;
     }
 }
 
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+/**
+ * @brief Update strip with a blend of two frames
+ * @param[in] a First frame, #rgb_buf layout
+ * @param[in] b Second frame, #rgb_buf layout
+ * @param[in] amount Share of the second frame: 0 - a, 255 - b
+ * @return #argb_state enum
+ * @note Frames are blended LED by LED while encoding, no frame pass
+ *       is made. Both must stay untouched till #argb_ready
+ * @note Power limit scale is estimated from #rgb_buf
+ */
+argb_state argb_show_crossfade(const uint8_t *a, const uint8_t *b, uint8_t amount)
+{
+    if (argb_seg_count == 0)
+        return ARGB_PARAM_ERR;
+    argb_lock_state = ARGB_BUSY;
+
+    if (argb_busy())
+    {
+        ARGB_TRACE(ARGB_TR_SHOW, 1, 1);
+        return ARGB_BUSY;
+    }
+    ARGB_TRACE(ARGB_TR_SHOW, 1, 0);
+
+#if ARGB_SKIP_UNCHANGED
+    argb_sent_gen = ~0u; // strip won't show #rgb_buf
+#endif
+    enc_src = a;
+    enc_fade_b = b;
+    enc_fade_amt = amount + (amount >> 7); // 255 gives 256, all of b
+    argb_start();
+    return ARGB_OK;
+}
+
+/**
+ * @brief Get frame size of current layout
+ * @return Bytes of #argb_frame_save frames, #ARGB_FRAME_BYTES at most
+ *         with static buffers
+ */
+uint16_t argb_get_frame_bytes(void)
+{
+    return argb_buf_bytes;
+}
+
+/**
+ * @brief Copy pixel buffer into a frame
+ * @param[out] frame #ARGB_FRAME_BYTES bytes
+ */
+void argb_frame_save(uint8_t *frame)
+{
+    memcpy(frame, (const uint8_t *) rgb_buf, argb_buf_bytes);
+}
+
+/**
+ * @brief Fade from one frame to another
+ * @param[in] a Frame to start from
+ * @param[in] b Frame to end with
+ * @param[in] frames Steps of the fade
+ * @param[in] ms Fade duration
+ * @note Blocks the calling thread till the last step is sent
+ */
+void argb_fade(const uint8_t *a, const uint8_t *b, uint16_t frames, uint32_t ms)
+{
+    const sysinterval_t period = TIME_MS2I(ms) / (frames ? frames : 1);
+    systime_t next = chVTGetSystemTimeX();
+
+    for (uint16_t f = 1; f <= frames; f++)
+    {
+        while (argb_show_crossfade(a, b, (uint32_t) f * 255 / frames) == ARGB_BUSY)
+            chThdSleep(1);
+        next = chThdSleepUntilWindowed(next, chTimeAddX(next, period));
+    }
+}
+#endif
+
+/**
+ * @brief Private method to check if a frame is still being sent
+ * @return true if DMA, latch or encode worker are busy
+ */
+static bool argb_busy(void)
+{
+    if ((buf_counter != 0) || (DMA_HANDLE->stream->CR & STM32_DMA_CR_EN))
+        return true;
+#if ARGB_USE_ENCODE_THREAD
+    // worker may still pad chunks released by the last half
+    chSysLock();
+    bool pending = enc_working || (chSemGetCounterI(&enc_sem) > 0);
+    chSysUnlock();
+    return pending;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Private method to start sending the frame
+ * @note Strip is idle, encoder source is set
+ */
+static void argb_start(void)
+{
+#if ARGB_USE_POWER_LIMIT
+    // scale the whole frame down to fit current limit
+    uint32_t idle;
+    uint32_t ua = argb_power_ua(&idle);
+    uint32_t limit = argb_power_limit * 1000;
+    if ((argb_power_limit == 0) || (ua + idle <= limit))
+        argb_power_k = 256;
+    else if (limit <= idle)
+        argb_power_k = 0;
+    else
+        argb_power_k = ((uint64_t) (limit - idle) << 8) / ua;
+#endif
+
+    // rewind encoder and set first transfer from first values
+    argb_enc_rewind();
+#if ARGB_USE_ENCODE_THREAD
+    for (uint8_t c = 0; c < ARGB_CHUNKS; c++)
+        argb_fill_chunk(c);
+    enc_ring_head = 0;
+    enc_ring_ready = ARGB_CHUNKS;
+    buf_counter = 1; // only marks the transfer as running
+#else
+    argb_fill_half(0);
+    argb_fill_half(1);
+#endif
+
+    // wait for PWM to be ready
+    while (pwmIsChannelEnabledI(&TIM_HANDLE, (TIM_CH)));  
+
+    // latch may have stopped DMA part way through the buffer and NDTR
+    // keeps what was left, so the stream is set up from scratch
+#if ARGB_USE_DBM
+    // start from buffer 0, each buffer end is a transfer complete
+    dmaStreamSetMemory0(DMA_HANDLE, &pwm_buf0[0]);
+    dmaStreamSetMemory1(DMA_HANDLE, &pwm_buf1[0]);
+    dmaStreamSetTransactionSize(DMA_HANDLE, PWM_DBM_LEN);
+    DMA_HANDLE->stream->CR &= ~STM32_DMA_CR_CT;
+    DMA_HANDLE->stream->CR |= STM32_DMA_CR_TCIE;
+#else
+    dmaStreamSetMemory0(DMA_HANDLE, &pwm_buf[0]);
+    dmaStreamSetTransactionSize(DMA_HANDLE, PWM_BUF_LEN);
+    // enable half and full transfer interrupt along with stream
+    DMA_HANDLE->stream->CR |= STM32_DMA_CR_TCIE | STM32_DMA_CR_HTIE;
+#endif
+    dmaStreamEnable(DMA_HANDLE);
+
+    // enable TIM DMA requests
+    TIM_HANDLE.tim->DIER |= STM32_TIM_DIER_CC4DE;
+    TIM_HANDLE.tim->CNT = 0;
+    TIM_HANDLE.tim->CR1 |= STM32_TIM_CR1_CEN;
+    pwmEnableChannel(&TIM_HANDLE, TIM_CH, 0);
+    ARGB_TRACE(ARGB_TR_DMA_START, 0, 0);
+}
+
 /**
  * @addtogroup Private_entities
  * @{ */
@@ -495,38 +1575,297 @@ static inline uint8_t scale8(uint8_t x, uint8_t scale)
     return ((uint16_t) x * scale) >> 8;
 }
 
-void hsv2rgb_raw(const hsv_t hsv, rgb_t * rgb)
+/**
+ * @brief Private method for global brightness
+ * @param[in] x Component value
+ * @return Dimmed value
+ */
+static inline uint8_t argb_dim(uint8_t x)
 {
-    // Convert hue, saturation and brightness ( HSV/HSB ) to RGB
-    // "Dimming" is used on saturation and brightness to make
-    // the output more visually linear.
-
-    // Apply dimming curves
-    uint8_t value = APPLY_DIMMING( hsv.val);
-    uint8_t saturation = hsv.sat;
+    return x / (256 / ((uint16_t) argb_brightness + 1));
+}
 
-    // The brightness floor is minimum number that all of
-    // R, G, and B will be set to.
-    uint8_t invsat = APPLY_DIMMING( 255 - saturation);
-    uint8_t brightness_floor = (value * invsat) / 256;
+/**
+ * @brief Private method to find LED's segment
+ * @param[in] i LED position
+ * @return Segment or NULL if LED is out of chain
+ */
+static inline argb_seg *argb_find_seg(uint16_t i)
+{
+    argb_seg *seg = ARGB_HINT_GET();
 
-    // The color amplitude is the maximum amount of R, G, and B
-    // that will be added on top of the brightness_floor to
-    // create the specific hue desired.
-    uint8_t color_amplitude = value - brightness_floor;
+    // neighbour LEDs mostly share a segment
+    if ((uint16_t) (i - seg->start) < (uint16_t) (seg->end - seg->start))
+        return seg;
 
-    // Figure out which section of the hue wheel we're in,
-    // and how far offset we are withing that section
-    uint8_t section = hsv.hue / HSV_SECTION_3; // 0..2
-    uint8_t offset = hsv.hue % HSV_SECTION_3;  // 0..63
+    // table is sorted and starts from 0
+    for (seg = &argb_segs[0]; seg < &argb_segs[argb_seg_count]; seg++)
+    {
+        if (i < seg->end)
+        {
+            ARGB_HINT_SET(seg);
+            return seg;
+        }
+    }
+    return NULL;
+}
 
-    uint8_t rampup = offset; // 0..63
-    uint8_t rampdown = (HSV_SECTION_3 - 1) - offset; // 63..0
+/**
+ * @brief Private method to get first byte of LED in #rgb_buf
+ * @param[in] seg LED's segment
+ * @param[in] i LED position
+ * @return Pointer to the pixel
+ */
+static inline volatile uint8_t *argb_pixel(const argb_seg *seg, uint16_t i)
+{
+    return &rgb_buf[seg->offset + (uint16_t) (i - seg->start) * seg->bpp];
+}
 
-    // We now scale rampup and rampdown to a 0-255 range -- at least
-    // in theory, but here's where architecture-specific decsions
-    // come in to play:
-    // To scale them up to 0-255, we'd want to multiply by 4.
+/**
+ * @brief Private method to write LED with brightness & gamma applied
+ * @param[in] seg LED's segment
+ * @param[in] i LED position
+ * @param[in] r Red component   [0..255]
+ * @param[in] g Green component [0..255]
+ * @param[in] b Blue component  [0..255]
+ */
+static inline void argb_put_rgb(argb_seg *seg, uint16_t i, uint8_t r, uint8_t g, uint8_t b)
+{
+    // set brightness
+    r = argb_dim(r);
+    g = argb_dim(g);
+    b = argb_dim(b);
+#if USE_GAMMA_CORRECTION
+    g = scale8(g, 0xB0);
+    b = scale8(b, 0xF0);
+#endif
+
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+    // subpixel order comes from the segment: RGB, GRB, ...
+    volatile uint8_t *px = argb_pixel(seg, i);
+#if ARGB_WHITE_EXTRACT
+    if (seg->bpp == 4)
+    {
+        uint8_t c[3] = {r, g, b};
+        uint8_t w = argb_white_split(c);
+        r = c[0];
+        g = c[1];
+        b = c[2];
+#if ARGB_USE_POWER_LIMIT
+        seg->sum[3] += w - px[3];
+#endif
+        px[3] = w;
+    }
+#endif
+#if ARGB_USE_POWER_LIMIT
+    // keep sums in step with the buffer
+    seg->sum[0] += r - px[seg->map[0]];
+    seg->sum[1] += g - px[seg->map[1]];
+    seg->sum[2] += b - px[seg->map[2]];
+#endif
+    px[seg->map[0]] = r;
+    px[seg->map[1]] = g;
+    px[seg->map[2]] = b;
+#else
+    argb_store(seg, i, argb_pack(r, g, b));
+#endif
+}
+
+#if ARGB_PIXEL_FORMAT != ARGB_FMT_RAW
+/**
+ * @brief Private method to pack color into buffer format
+ * @param[in] r Red component   [0..255]
+ * @param[in] g Green component [0..255]
+ * @param[in] b Blue component  [0..255]
+ * @return RGB565 word or closest palette entry
+ */
+static inline argb_packed argb_pack(uint8_t r, uint8_t g, uint8_t b)
+{
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RGB565
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+#elif ARGB_PIXEL_FORMAT == ARGB_FMT_ATOMIC
+    return r | (g << 8) | ((argb_packed) b << 16);
+#else
+    // plain search, palette formats are meant for argb_set_index
+    uint32_t best = ~0u;
+    argb_packed idx = 0;
+    for (uint16_t k = 0; k < ARGB_PALETTE_SIZE; k++)
+    {
+        int16_t dr = r - argb_palette[k][0];
+        int16_t dg = g - argb_palette[k][1];
+        int16_t db = b - argb_palette[k][2];
+        uint32_t d = dr * dr + dg * dg + db * db;
+        if (d < best)
+        {
+            best = d;
+            idx = k;
+        }
+    }
+    return idx;
+#endif
+}
+
+/**
+ * @brief Private method to unpack buffer value
+ * @param[in] v RGB565 word or palette entry
+ * @param[out] c R, G, B, W components
+ */
+static inline void argb_unpack(argb_packed v, uint8_t *c)
+{
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RGB565
+    // replicate top bits so 0x1F/0x3F expand to 0xFF
+    uint8_t r = (v >> 11) & 0x1F, g = (v >> 5) & 0x3F, b = v & 0x1F;
+    c[0] = (r << 3) | (r >> 2);
+    c[1] = (g << 2) | (g >> 4);
+    c[2] = (b << 3) | (b >> 2);
+    c[3] = 0;
+#elif ARGB_PIXEL_FORMAT == ARGB_FMT_ATOMIC
+    c[0] = v;
+    c[1] = v >> 8;
+    c[2] = v >> 16;
+    c[3] = v >> 24;
+#else
+    const uint8_t *p = argb_palette[v];
+    c[0] = p[0];
+    c[1] = p[1];
+    c[2] = p[2];
+    c[3] = p[3];
+#endif
+}
+
+/**
+ * @brief Private method to read LED's buffer value
+ * @param[in] i LED position
+ * @return RGB565 word or palette entry
+ */
+static inline argb_packed argb_load(uint16_t i)
+{
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RGB565
+    return rgb_buf[2 * i] | (rgb_buf[2 * i + 1] << 8);
+#elif ARGB_PIXEL_FORMAT == ARGB_FMT_PAL8
+    return rgb_buf[i];
+#elif ARGB_PIXEL_FORMAT == ARGB_FMT_ATOMIC
+    return __atomic_load_n(ARGB_WORD(i), __ATOMIC_RELAXED);
+#else
+    return (i & 1) ? rgb_buf[i >> 1] >> 4 : rgb_buf[i >> 1] & 0x0F;
+#endif
+}
+
+/**
+ * @brief Private method to write LED's buffer value
+ * @param[in] seg LED's segment, used by power tracking
+ * @param[in] i LED position
+ * @param[in] v RGB565 word or palette entry
+ */
+static inline void argb_store(argb_seg *seg, uint16_t i, argb_packed v)
+{
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RGB565
+#if ARGB_USE_POWER_LIMIT
+    uint8_t o[4], n[4];
+    argb_unpack(argb_load(i), o);
+    argb_unpack(v, n);
+    seg->sum[0] += n[0] - o[0];
+    seg->sum[1] += n[1] - o[1];
+    seg->sum[2] += n[2] - o[2];
+#else
+    (void) seg;
+#endif
+    rgb_buf[2 * i] = v;
+    rgb_buf[2 * i + 1] = v >> 8;
+#elif ARGB_PIXEL_FORMAT == ARGB_FMT_PAL8
+    (void) seg;
+    rgb_buf[i] = v;
+#elif ARGB_PIXEL_FORMAT == ARGB_FMT_ATOMIC
+    // swap R, G, B, keep W set by another thread
+    argb_packed old = __atomic_load_n(ARGB_WORD(i), __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(ARGB_WORD(i), &old, (old & 0xFF000000) | v,
+                                        true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+#if ARGB_USE_POWER_LIMIT
+    ARGB_SUM_ADD(seg, 0, (int32_t) (v & 0xFF) - (int32_t) (old & 0xFF));
+    ARGB_SUM_ADD(seg, 1, (int32_t) ((v >> 8) & 0xFF) - (int32_t) ((old >> 8) & 0xFF));
+    ARGB_SUM_ADD(seg, 2, (int32_t) ((v >> 16) & 0xFF) - (int32_t) ((old >> 16) & 0xFF));
+#else
+    (void) seg;
+#endif
+#else
+    (void) seg;
+    uint8_t b = rgb_buf[i >> 1];
+    rgb_buf[i >> 1] = (i & 1) ? (b & 0x0F) | (v << 4) : (b & 0xF0) | v;
+#endif
+}
+
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_ATOMIC
+/**
+ * @brief Private method to write LED's white part
+ * @param[in] seg LED's segment, used by power tracking
+ * @param[in] i LED position
+ * @param[in] w White component, brightness applied
+ */
+static inline void argb_store_white(argb_seg *seg, uint16_t i, uint8_t w)
+{
+    argb_packed old = __atomic_load_n(ARGB_WORD(i), __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(ARGB_WORD(i), &old, (old & 0x00FFFFFF) | ((argb_packed) w << 24),
+                                        true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+#if ARGB_USE_POWER_LIMIT
+    ARGB_SUM_ADD(seg, 3, (int32_t) w - (int32_t) (old >> 24));
+#else
+    (void) seg;
+#endif
+}
+
+/**
+ * @brief Private method to replace LED's whole word
+ * @param[in] seg LED's segment, used by power tracking
+ * @param[in] i LED position
+ * @param[in] v Packed color, white in the top byte
+ * @note Sums take the difference to the word actually replaced
+ */
+static inline void argb_store_word(argb_seg *seg, uint16_t i, argb_packed v)
+{
+    argb_packed old = __atomic_exchange_n(ARGB_WORD(i), v, __ATOMIC_RELAXED);
+#if ARGB_USE_POWER_LIMIT
+    for (uint8_t k = 0; k < 4; k++)
+        ARGB_SUM_ADD(seg, k, (int32_t) ((v >> (8 * k)) & 0xFF) - (int32_t) ((old >> (8 * k)) & 0xFF));
+#else
+    (void) seg;
+    (void) old;
+#endif
+}
+#endif
+#endif
+
+void hsv2rgb_raw(const hsv_t hsv, rgb_t * rgb)
+{
+    // Convert hue, saturation and brightness ( HSV/HSB ) to RGB
+    // "Dimming" is used on saturation and brightness to make
+    // the output more visually linear.
+
+    // Apply dimming curves
+    uint8_t value = APPLY_DIMMING( hsv.val);
+    uint8_t saturation = hsv.sat;
+
+    // The brightness floor is minimum number that all of
+    // R, G, and B will be set to.
+    uint8_t invsat = APPLY_DIMMING( 255 - saturation);
+    uint8_t brightness_floor = (value * invsat) / 256;
+
+    // The color amplitude is the maximum amount of R, G, and B
+    // that will be added on top of the brightness_floor to
+    // create the specific hue desired.
+    uint8_t color_amplitude = value - brightness_floor;
+
+    // Figure out which section of the hue wheel we're in,
+    // and how far offset we are withing that section
+    uint8_t section = hsv.hue / HSV_SECTION_3; // 0..2
+    uint8_t offset = hsv.hue % HSV_SECTION_3;  // 0..63
+
+    uint8_t rampup = offset; // 0..63
+    uint8_t rampdown = (HSV_SECTION_3 - 1) - offset; // 63..0
+
+    // We now scale rampup and rampdown to a 0-255 range -- at least
+    // in theory, but here's where architecture-specific decsions
+    // come in to play:
+    // To scale them up to 0-255, we'd want to multiply by 4.
     // But in the very next step, we multiply the ramps by other
     // values and then divide the resulting product by 256.
     // So which is faster?
@@ -543,212 +1882,846 @@ void hsv2rgb_raw(const hsv_t hsv, rgb_t * rgb)
     // divide the resulting product by 64 (instead of 256).
     // Moral of the story: trust your profiler, not your insticts.
 
-    // Since there's an AVR assembly version elsewhere, we'll
-    // assume what we're on an architecture where any number of
-    // bit shifts has roughly the same cost, and we'll remove the
-    // redundant math at the source level:
+    // Since there's an AVR assembly version elsewhere, we'll
+    // assume what we're on an architecture where any number of
+    // bit shifts has roughly the same cost, and we'll remove the
+    // redundant math at the source level:
+
+    //  // scale up to 255 range
+    //  //rampup *= 4; // 0..252
+    //  //rampdown *= 4; // 0..252
+
+    // compute color-amplitude-scaled-down versions of rampup and rampdown
+    uint8_t rampup_amp_adj   = (rampup   * color_amplitude) / (256 / 4);
+    uint8_t rampdown_amp_adj = (rampdown * color_amplitude) / (256 / 4);
+
+    // add brightness_floor offset to everything
+    uint8_t rampup_adj_with_floor   = rampup_amp_adj   + brightness_floor;
+    uint8_t rampdown_adj_with_floor = rampdown_amp_adj + brightness_floor;
+
+
+    if( section ) {
+        if( section == 1) {
+            // section 1: 0x40..0x7F
+            rgb->r = brightness_floor;
+            rgb->g = rampdown_adj_with_floor;
+            rgb->b = rampup_adj_with_floor;
+        } else {
+            // section 2; 0x80..0xBF
+            rgb->r = rampup_adj_with_floor;
+            rgb->g = brightness_floor;
+            rgb->b = rampdown_adj_with_floor;
+        }
+    } else {
+        // section 0: 0x00..0x3F
+        rgb->r = rampdown_adj_with_floor;
+        rgb->g = rampup_adj_with_floor;
+        rgb->b = brightness_floor;
+    }
+}
+
+void hsv2rgb_spectrum( const hsv_t hsv, rgb_t * rgb)
+{
+    hsv_t hsv2 = hsv;
+    hsv2.hue = scale8( hsv2.hue, 191);
+    hsv2rgb_raw(hsv2, rgb);
+}
+
+// This function is only an approximation, and it is not
+// nearly as fast as the normal HSV-to-RGB conversion.
+// See extended notes in the .h file.
+hsv_t rgb2hsv_approximate(const rgb_t rgb)
+{
+    uint8_t r = rgb.r;
+    uint8_t g = rgb.g;
+    uint8_t b = rgb.b;
+    uint8_t h, s, v;
+    
+    // find desaturation
+    uint8_t desat = 255;
+    if( r < desat) desat = r;
+    if( g < desat) desat = g;
+    if( b < desat) desat = b;
+    
+    // remove saturation from all channels
+    r -= desat;
+    g -= desat;
+    b -= desat;
+    
+    //uint8_t orig_desat = sqrt16( desat * 256);
+    
+    // saturation is opposite of desaturation
+    s = 255 - desat;
+    
+    if( s != 255 ) {
+        // undo 'dimming' of saturation
+        s = 255 - sqrt16_x256(255 - s);
+    }
+    // without lib8tion: float ... ew ... sqrt... double ew, or rather, ew ^ 0.5
+    // if( s != 255 ) s = (255 - (256.0 * sqrt( (float)(255-s) / 256.0)));
+    
+    
+    // at least one channel is now zero
+    // if all three channels are zero, we had a
+    // shade of gray.
+    if( (r + g + b) == 0) {
+        // we pick hue zero for no special reason
+        hsv_t hsv = {.h=0, .s=0, .v=255-s};
+        return hsv;
+    }
+    
+    // scale all channels up to compensate for desaturation
+    if( s < 255) {
+        uint32_t scaleup = recip16(s); // 65535 / s, s = 0 taken as 1
+        r = ((uint32_t)(r) * scaleup) / 256;
+        g = ((uint32_t)(g) * scaleup) / 256;
+        b = ((uint32_t)(b) * scaleup) / 256;
+    }
+
+    uint16_t total = r + g + b;
+    
+    // scale all channels up to compensate for low values
+    if( total < 255) {
+        if( total == 0) total = 1; // value below is taken from it too
+        uint32_t scaleup = recip16(total); // 65535 / total
+        r = ((uint32_t)(r) * scaleup) / 256;
+        g = ((uint32_t)(g) * scaleup) / 256;
+        b = ((uint32_t)(b) * scaleup) / 256;
+    }
+    
+    if( total > 255 ) {
+        v = 255;
+    } else {
+        v = qadd8(desat,total);
+        // undo 'dimming' of brightness
+        if( v != 255) v = sqrt16_x256(v);
+        // without lib8tion: float ... ew ... sqrt... double ew, or rather, ew ^ 0.5
+        // if( v != 255) v = (256.0 * sqrt( (float)(v) / 256.0));
+        
+    }
+    
+    // since this wasn't a pure shade of gray,
+    // the interesting question is what hue is it    
+    
+    // start with which channel is highest
+    // (ties don't matter)
+    uint8_t highest = r;
+    if( g > highest) highest = g;
+    if( b > highest) highest = b;
+    
+    if( highest == r ) {
+        // Red is highest.
+        // Hue could be Purple/Pink-Red,Red-Orange,Orange-Yellow
+        if( g == 0 ) {
+            // if green is zero, we're in Purple/Pink-Red
+            h = (HUE_PURPLE + HUE_PURPLE) / 2;
+            h += scale8( qsub8(r, 128), FIXFRAC8(48,128));
+        } else if ( (r - g) > g) {
+            // if R-G > G then we're in Red-Orange
+            h = HUE_RED;
+            h += scale8( g, FIXFRAC8(32,85));
+        } else {
+            // R-G < G, we're in Orange-Yellow
+            h = HUE_YELLOW;
+            h += scale8( qsub8((g - 85) + (171 - r), 4), FIXFRAC8(32,85)); //221
+        }
+        
+    } else if ( highest == g) {
+        // Green is highest
+        // Hue could be Yellow-Green, Green-Aqua
+        if( b == 0) {
+            // if Blue is zero, we're in Yellow-Green
+            //   G = 171..255
+            //   R = 171..  0
+            h = HUE_YELLOW;
+            uint8_t radj = scale8( qsub8(171,r),   47); //171..0 -> 0..171 -> 0..31
+            uint8_t gadj = scale8( qsub8(g,171),   96); //171..255 -> 0..84 -> 0..31;
+            uint8_t rgadj = radj + gadj;
+            uint8_t hueadv = rgadj / 2;
+            h += hueadv;
+            //h += scale8( qadd8( 4, qadd8((g - 128), (128 - r))),
+            //             FIXFRAC8(32,255)); //
+        } else {
+            // if Blue is nonzero we're in Green-Aqua
+            if( (g-b) > b) {
+                h = HUE_GREEN;
+                h += scale8( b, FIXFRAC8(32,85));
+            } else {
+                h = HUE_AQUA;
+                h += scale8( qsub8(b, 85), FIXFRAC8(8,42));
+            }
+        }
+        
+    } else /* highest == b */ {
+        // Blue is highest
+        // Hue could be Aqua/Blue-Blue, Blue-Purple, Purple-Pink
+        if( r == 0) {
+            // if red is zero, we're in Aqua/Blue-Blue
+            h = HUE_AQUA + ((HUE_BLUE - HUE_AQUA) / 4);
+            h += scale8( qsub8(b, 128), FIXFRAC8(24,128));
+        } else if ( (b-r) > r) {
+            // B-R > R, we're in Blue-Purple
+            h = HUE_BLUE;
+            h += scale8( r, FIXFRAC8(32,85));
+        } else {
+            // B-R < R, we're in Purple-Pink
+            h = HUE_PURPLE;
+            h += scale8( qsub8(r, 85), FIXFRAC8(32,85));
+        }
+    }
+    
+    h += 1;
+    hsv_t hsv = {.h=h, .s=s, .v=v};
+    return hsv;
+}
+
+/**
+ * @brief Get LED color as HSV
+ * @param[in] i LED position
+ * @return Approximate HSV of stored color, zero if out of chain
+ */
+hsv_t argb_get_hue(uint16_t i)
+{
+    return rgb2hsv_approximate(argb_get_rgb(i));
+}
+
+/**
+ * @brief Get LED color as RGB
+ * @param[in] i LED position
+ * @return Stored color (with brightness & gamma), zero if out of chain
+ */
+rgb_t argb_get_rgb(uint16_t i)
+{
+    rgb_t rgb = {.r=0, .g=0, .b=0};
+    const argb_seg *seg = argb_find_seg(i);
+
+    if (seg != NULL)
+    {
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+        volatile uint8_t *px = argb_pixel(seg, i);
+        rgb.r = px[seg->map[0]];
+        rgb.g = px[seg->map[1]];
+        rgb.b = px[seg->map[2]];
+#else
+        uint8_t c[4];
+        argb_unpack(argb_load(i), c);
+        rgb.r = c[0];
+        rgb.g = c[1];
+        rgb.b = c[2];
+#endif
+    }
+    return rgb;
+}
+
+/**
+ * @brief Get White component of LED
+ * @param[in] i LED position
+ * @return Stored white value, zero for RGB LEDs
+ */
+uint8_t argb_get_white(uint16_t i)
+{
+    const argb_seg *seg = argb_find_seg(i);
+
+    if ((seg == NULL) || (seg->bpp != 4))
+        return 0;
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+    return argb_pixel(seg, i)[3];
+#else
+    uint8_t c[4];
+    argb_unpack(argb_load(i), c);
+    return c[3];
+#endif
+}
+
+/**
+ * @brief Get colors of LEDs range as RGB
+ * @param[in] start First LED position
+ * @param[in] count LED quantity
+ * @param[out] out Colors, count entries
+ * @return LEDs read, less than count if range leaves the chain
+ */
+uint16_t argb_get_rgb_range(uint16_t start, uint16_t count, rgb_t *out)
+{
+    const argb_seg *seg = argb_find_seg(start);
+    const argb_seg *last = &argb_segs[argb_seg_count];
+    uint16_t done = 0;
+
+    // walk segments, de-swizzle with segment's order and stride
+    for (; (seg != NULL) && (seg < last) && (done < count); seg++)
+    {
+        uint16_t n = seg->end - start;
+        if (n > count - done)
+            n = count - done;
+
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+        volatile uint8_t *px = argb_pixel(seg, start);
+        const uint8_t ri = seg->map[0], gi = seg->map[1], bi = seg->map[2];
+        const uint8_t bpp = seg->bpp;
+
+        for (uint16_t k = 0; k < n; k++, px += bpp, out++)
+        {
+            out->r = px[ri];
+            out->g = px[gi];
+            out->b = px[bi];
+        }
+#else
+        for (uint16_t k = 0; k < n; k++, out++)
+        {
+            uint8_t c[4];
+            argb_unpack(argb_load(start + k), c);
+            out->r = c[0];
+            out->g = c[1];
+            out->b = c[2];
+        }
+#endif
+        start += n;
+        done += n;
+    }
+    return done;
+}
+
+/**
+ * @brief Get colors of LEDs range as HSV
+ * @param[in] start First LED position
+ * @param[in] count LED quantity
+ * @param[out] out Colors, count entries
+ * @return LEDs read, less than count if range leaves the chain
+ */
+uint16_t argb_get_hsv_range(uint16_t start, uint16_t count, hsv_t *out)
+{
+    rgb_t rgb[8];
+    uint16_t done = 0;
+
+    // small chunks keep stack usage flat
+    while (done < count)
+    {
+        uint16_t n = count - done;
+        if (n > 8)
+            n = 8;
+        n = argb_get_rgb_range(start + done, n, rgb);
+        for (uint16_t k = 0; k < n; k++)
+            out[done + k] = rgb2hsv_approximate(rgb[k]);
+        done += n;
+        if (n < 8)
+            break;
+    }
+    return done;
+}
+
+#if ARGB_WHITE_EXTRACT
+/// 8.8 reciprocal of W tint channel: how much W one unit of the channel allows
+#define ARGB_WHITE_RECIP(t) ((255u * 256u + (t) / 2) / (t))
+
+/**
+ * @brief Private method to move common part of R, G, B to W
+ * @param[in,out] c R, G, B components, white part taken out
+ * @return White component
+ */
+static inline uint8_t argb_white_split(uint8_t *c)
+{
+    // W is limited by the channel that runs out first
+    uint16_t w = (c[0] * ARGB_WHITE_RECIP(ARGB_WHITE_R)) >> 8;
+    uint16_t t = (c[1] * ARGB_WHITE_RECIP(ARGB_WHITE_G)) >> 8;
+    if (t < w)
+        w = t;
+    t = (c[2] * ARGB_WHITE_RECIP(ARGB_WHITE_B)) >> 8;
+    if (t < w)
+        w = t;
+    if (w > 255)
+        w = 255;
+
+    // (w + 1) * tint >> 8 gives exactly w for tint 255
+    c[0] = qsub8(c[0], ((w + 1) * ARGB_WHITE_R) >> 8);
+    c[1] = qsub8(c[1], ((w + 1) * ARGB_WHITE_G) >> 8);
+    c[2] = qsub8(c[2], ((w + 1) * ARGB_WHITE_B) >> 8);
+    return w;
+}
+#endif
+
+/**
+ * @brief Private method to read stored LED components
+ * @param[in] seg LED's segment
+ * @param[in] i LED position
+ * @param[out] c R, G, B, W components, W is 0 for RGB LEDs
+ */
+static inline void argb_read_px(const argb_seg *seg, uint16_t i, uint8_t *c)
+{
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+    volatile uint8_t *px = argb_pixel(seg, i);
+    c[0] = px[seg->map[0]];
+    c[1] = px[seg->map[1]];
+    c[2] = px[seg->map[2]];
+    c[3] = (seg->bpp == 4) ? px[3] : 0;
+#else
+    (void) seg;
+    argb_unpack(argb_load(i), c);
+#endif
+}
+
+#if ARGB_USE_POWER_LIMIT && (ARGB_PIXEL_FORMAT != ARGB_FMT_ATOMIC)
+/**
+ * @brief Private method to add or remove LEDs span from power sums
+ * @param[in] start First LED position
+ * @param[in] count LED quantity
+ * @param[in] sign 1 - add, -1 - remove
+ */
+static void argb_power_span(uint16_t start, uint16_t count, int8_t sign)
+{
+    for (; count != 0; count--, start++)
+    {
+        argb_seg *seg = argb_find_seg(start);
+        uint8_t c[4];
+
+        argb_read_px(seg, start, c);
+        for (uint8_t k = 0; k < 4; k++)
+            ARGB_SUM_ADD(seg, k, (int32_t) sign * c[k]);
+    }
+}
+#endif
+
+#if ARGB_SKIP_UNCHANGED
+/**
+ * @brief Private method to decide if frame can be skipped
+ * @return true if the strip already shows this frame
+ * @note Remembers the frame as sent otherwise
+ */
+static bool argb_frame_unchanged(void)
+{
+    const uint32_t gen = argb_gen;
+    bool due = false;
+#if ARGB_KEEPALIVE_MS
+    due = chVTTimeElapsedSinceX(argb_sent_time) >= TIME_MS2I(ARGB_KEEPALIVE_MS);
+#endif
+
+    if ((gen == argb_sent_gen) && !due)
+        return true;
+
+#if ARGB_FRAME_HASH
+    // FNV-1a, catches writes of the values already there
+    uint32_t h = 2166136261u;
+    for (size_t k = 0; k < argb_buf_bytes; k++)
+        h = (h ^ rgb_buf[k]) * 16777619u;
+#if defined(ARGB_PALETTE_SIZE)
+    for (size_t k = 0; k < sizeof(argb_palette); k++)
+        h = (h ^ ((const uint8_t *) argb_palette)[k]) * 16777619u;
+#endif
+#if ARGB_USE_POWER_LIMIT
+    h = (h ^ argb_power_limit) * 16777619u;
+#endif
+    if ((h == argb_sent_hash) && (argb_sent_gen != ~0u) && !due)
+    {
+        argb_sent_gen = gen;
+        return true;
+    }
+    argb_sent_hash = h;
+#endif
+
+    argb_sent_gen = gen;
+    argb_sent_time = chVTGetSystemTimeX();
+    return false;
+}
+#endif
+
+/**
+ * @brief Rewind encoder to the chain start
+ */
+static void argb_enc_rewind(void)
+{
+    enc_seg = &argb_segs[0];
+    enc_byte = 0;
+    enc_zeros = 0;
+#if ARGB_PIXEL_FORMAT != ARGB_FMT_RAW
+    enc_led = 0;
+    enc_px_pos = 4;
+#endif
+}
+
+#if ARGB_PIXEL_FORMAT != ARGB_FMT_RAW
+/**
+ * @brief Expand compact LED value into wire bytes
+ * @param[in] seg LED's segment
+ * @param[in] i LED position
+ * @param[out] px Wire bytes, seg->bpp entries
+ */
+static inline void argb_expand(const argb_seg *seg, uint16_t i, uint8_t *px)
+{
+    uint8_t c[4];
+
+    argb_unpack(argb_load(i), c);
+#if ARGB_WHITE_EXTRACT
+    // compact buffers keep plain RGB, split on the way out
+    if (seg->bpp == 4)
+        c[3] = qadd8(c[3], argb_white_split(c));
+#endif
+    px[seg->map[0]] = c[0];
+    px[seg->map[1]] = c[1];
+    px[seg->map[2]] = c[2];
+    px[3] = c[3];
+}
+#endif
+
+/**
+ * @brief Encode next chain bytes into half of PWM buffer
+ * @param[out] half First slot of the half
+ * @return Zero slots padded after the chain end
+ */
+static uint16_t argb_encode_half(volatile dma_siz *half)
+{
+    uint16_t bytes = PWM_HALF_BYTES;
+
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+    // layout's own encoder, unless the frame needs blending or scaling
+    bool own = (enc_hook != NULL) && (enc_fade_b == NULL);
+#if ARGB_USE_POWER_LIMIT
+    own = own && (argb_power_k == 256);
+#endif
+    if (own)
+    {
+        uint16_t n = enc_hook(half, enc_src, enc_byte, bytes);
+        enc_byte += n;
+        bytes -= n;
+        memset((dma_siz *) half + n * 8, 0, bytes * 8 * sizeof(dma_siz));
+        return bytes * 8;
+    }
+#endif
+
+    while (bytes != 0)
+    {
+        if (enc_byte == enc_seg->limit)
+        {
+            // chain exhausted - pad with RET code
+            if (enc_seg == &argb_segs[argb_seg_count - 1])
+            {
+                memset((dma_siz *) half, 0, bytes * 8 * sizeof(dma_siz));
+                return bytes * 8;
+            }
+            enc_seg++;
+#if ARGB_PIXEL_FORMAT != ARGB_FMT_RAW
+            // LED sizes differ between segments, start on a fresh LED
+            enc_px_pos = 4;
+#endif
+        }
+
+        // no per-LED checks inside a segment
+        const dma_siz hi = enc_seg->hi;
+        const dma_siz lo = enc_seg->lo;
+#if ARGB_USE_POWER_LIMIT
+        const uint16_t k = argb_power_k;
+#endif
+        uint16_t run = enc_seg->limit - enc_byte;
+        if (run > bytes)
+            run = bytes;
+        bytes -= run;
+
+        for (; run != 0; run--)
+        {
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+            uint8_t v = enc_src[enc_byte];
+            if (enc_fade_b != NULL)
+                v = (v * (256 - enc_fade_amt) + enc_fade_b[enc_byte] * enc_fade_amt) >> 8;
+            enc_byte++;
+#else
+            // expand next LED, segments end on LED boundary
+            if (enc_px_pos >= enc_seg->bpp)
+            {
+                argb_expand(enc_seg, enc_led++, enc_px);
+                enc_px_pos = 0;
+            }
+            uint8_t v = enc_px[enc_px_pos++];
+            enc_byte++;
+#endif
+#if ARGB_USE_POWER_LIMIT
+            v = (v * k) >> 8;
+#endif
+            for (uint8_t i = 0; i < 8; i++, v <<= 1)
+                *half++ = (v & 0x80) ? hi : lo;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Fill half of PWM buffer with data or RET code
+ * @param[in] h Half index: 0 - first, 1 - second (buffer in double-buffer mode)
+ * @note Marks transfer as running
+ */
+static inline void argb_fill_half(uint8_t h)
+{
+    argb_fill_chunk(h);
+    buf_counter++;
+}
+
+/**
+ * @brief Fill one LED worth of PWM slots with data or RET code
+ * @param[out] slots PWM_HALF_LEN slots
+ * @return Trailing zero slots
+ */
+static uint16_t argb_fill_slots(volatile dma_siz *slots)
+{
+    if (enc_byte < argb_total_bytes)
+        return argb_encode_half(slots);
+
+    memset((dma_siz *) slots, 0, PWM_HALF_LEN * sizeof(dma_siz));
+    return PWM_HALF_LEN;
+}
+
+/**
+ * @brief Fill chunk of PWM buffer with data or RET code
+ * @param[in] c Chunk index, double-buffer mode: buffer index
+ */
+static void argb_fill_chunk(uint8_t c)
+{
+#if ARGB_USE_DBM
+    volatile dma_siz *buf = (c == 0) ? pwm_buf0 : pwm_buf1;
+    uint16_t zeros = 0;
+
+    // data ends in one LED only, zeros after it add up to the buffer tail
+    for (uint16_t k = 0; k < ARGB_DBM_LEDS; k++)
+        zeros += argb_fill_slots(&buf[k * PWM_HALF_LEN]);
+    enc_half_zeros[c] = zeros;
+#else
+    enc_half_zeros[c] = argb_fill_slots(&pwm_buf[c * PWM_HALF_LEN]);
+#endif
+}
+
+#if ARGB_USE_BENCH
+/**
+ * @brief Encode whole chain into PWM buffer without DMA
+ * @param none
+ * @return Encoded bytes, 0 if strip is busy
+ * @note Benchmark hook, runs the same encoder as DMA interrupt
+ */
+uint16_t argb_bench_encode(void)
+{
+    if ((argb_lock_state != ARGB_READY) || (buf_counter != 0))
+        return 0;
+
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+    enc_src = rgb_buf;
+    enc_fade_b = NULL;
+#endif
+    argb_enc_rewind();
+    for (uint8_t h = 0; enc_byte < argb_total_bytes; h ^= 1)
+        argb_fill_half(h);
+    buf_counter = 0;
+    return argb_total_bytes;
+}
+#endif
+
+/**
+ * @brief Stop DMA and time the rest of RET code with the timer
+ * @note Line is already low: CCR preload and active values are 0
+ */
+static void argb_start_latch(void)
+{
+    // first zero slots are already on the wire
+    uint32_t sent = (uint32_t) (enc_zeros - ARGB_LATCH_ZEROS) * ARR_VAL;
+    uint32_t ticks = (sent < argb_reset_ticks) ? argb_reset_ticks - sent : 1;
+
+    ARGB_TRACE(ARGB_TR_RESET, 0, enc_zeros);
+    dmaStreamDisable(DMA_HANDLE);
+    TIM_HANDLE.tim->DIER &= ~STM32_TIM_DIER_CC4DE;
+
+    // 16-bit timers: split long latch into equal periods
+    argb_latch_left = ticks / 0x10000 + 1;
+
+    chSysLockFromISR();
+    pwmChangePeriodI(&TIM_HANDLE, ticks / argb_latch_left + 1);
+    TIM_HANDLE.tim->EGR = STM32_TIM_EGR_UG; // restart period now, URS keeps it silent
+    pwmEnablePeriodicNotificationI(&TIM_HANDLE);
+    chSysUnlockFromISR();
+}
+
+/**
+ * @brief Timer period callback, ends RET code
+ * @param pwmp PWM driver, unused
+ */
+static void argb_latch_cb(PWMDriver *pwmp)
+{
+    (void) pwmp;
+
+    if ((argb_latch_left == 0) || (--argb_latch_left != 0))
+        return;
 
-    //  // scale up to 255 range
-    //  //rampup *= 4; // 0..252
-    //  //rampdown *= 4; // 0..252
+    chSysLockFromISR();
+    pwmDisablePeriodicNotificationI(&TIM_HANDLE);
+    pwmDisableChannelI(&TIM_HANDLE, TIM_CH);
+    TIM_HANDLE.tim->CR1 &= ~STM32_TIM_CR1_CEN;
+    pwmChangePeriodI(&TIM_HANDLE, ARR_VAL);
+    TIM_HANDLE.tim->EGR = STM32_TIM_EGR_UG; // bit period back to shadow register
+    chSysUnlockFromISR();
+
+    buf_counter = 0;
+    argb_lock_state = ARGB_READY;
+    ARGB_TRACE(ARGB_TR_READY, 0, 0);
+}
 
-    // compute color-amplitude-scaled-down versions of rampup and rampdown
-    uint8_t rampup_amp_adj   = (rampup   * color_amplitude) / (256 / 4);
-    uint8_t rampdown_amp_adj = (rampdown * color_amplitude) / (256 / 4);
+/**
+ * @brief Service the half DMA has just read
+ * @param[in] h Half index: 0 - first, 1 - second (buffer in double-buffer mode)
+ * @return true if data is over and latch has started
+ */
+static bool argb_half_sent(uint8_t h)
+{
+#if ARGB_USE_ENCODE_THREAD
+    ARGB_TRACE(ARGB_TR_HALF, h, enc_ring_ready);
 
-    // add brightness_floor offset to everything
-    uint8_t rampup_adj_with_floor   = rampup_amp_adj   + brightness_floor;
-    uint8_t rampdown_adj_with_floor = rampdown_amp_adj + brightness_floor;
+    const uint8_t first = h * (ARGB_CHUNKS / 2);
 
+    // DMA is on the other half, so zeros of this one are in CCR already
+    for (uint8_t c = first; c < first + ARGB_CHUNKS / 2; c++)
+        enc_zeros += enc_half_zeros[c];
+    if (enc_zeros >= ARGB_LATCH_ZEROS)
+    {
+        argb_start_latch();
+        return true;
+    }
 
-    if( section ) {
-        if( section == 1) {
-            // section 1: 0x40..0x7F
-            rgb->r = brightness_floor;
-            rgb->g = rampdown_adj_with_floor;
-            rgb->b = rampup_adj_with_floor;
-        } else {
-            // section 2; 0x80..0xBF
-            rgb->r = rampup_adj_with_floor;
-            rgb->g = brightness_floor;
-            rgb->b = rampdown_adj_with_floor;
-        }
-    } else {
-        // section 0: 0x00..0x3F
-        rgb->r = rampdown_adj_with_floor;
-        rgb->g = rampup_adj_with_floor;
-        rgb->b = brightness_floor;
+    // hand the half back to the worker, no encoding here. Chunks of it
+    // the worker hadn't reached are still queued from the lap before
+    chSysLockFromISR();
+    uint8_t done = (enc_ring_ready < ARGB_CHUNKS / 2) ? enc_ring_ready : ARGB_CHUNKS / 2;
+    enc_ring_ready -= done;
+    if (enc_ring_ready < ARGB_CHUNKS / 2)
+        enc_stats.stalls++; // DMA goes on into chunks not encoded yet
+    if (enc_ring_ready < enc_stats.min_depth)
+        enc_stats.min_depth = enc_ring_ready;
+    if (done != 0)
+        chSemAddCounterI(&enc_sem, done);
+    chSysUnlockFromISR();
+#else
+    ARGB_TRACE(ARGB_TR_HALF, h, buf_counter);
+
+    // DMA is on the other half, so zeros of this one are in CCR already
+    enc_zeros += enc_half_zeros[h];
+    if (enc_zeros >= ARGB_LATCH_ZEROS)
+    {
+        argb_start_latch();
+        return true;
     }
+    argb_fill_half(h);
+#endif
+    return false;
 }
 
-void hsv2rgb_spectrum( const hsv_t hsv, rgb_t * rgb)
+#if ARGB_USE_ENCODE_THREAD
+/**
+ * @brief Wait for a chunk released by DMA and refill it
+ * @note Encode worker loop body
+ */
+static void argb_enc_step(void)
 {
-    hsv_t hsv2 = hsv;
-    hsv2.hue = scale8( hsv2.hue, 191);
-    hsv2rgb_raw(hsv2, rgb);
+    // taking a chunk and marking it in one lock, so argb_busy()
+    // always sees either the count or the flag
+    chSysLock();
+    chSemWaitS(&enc_sem);
+    enc_working = true;
+    chSysUnlock();
+
+    argb_fill_chunk(enc_ring_head);
+    enc_ring_head = (enc_ring_head + 1) % ARGB_CHUNKS;
+
+    chSysLock();
+    enc_ring_ready++;
+    enc_working = false;
+    chSysUnlock();
 }
 
-// This function is only an approximation, and it is not
-// nearly as fast as the normal HSV-to-RGB conversion.
-// See extended notes in the .h file.
-hsv_t rgb2hsv_approximate(const rgb_t rgb)
+/**
+ * @brief Encode worker, refills chunks released by DMA
+ * @param arg Unused
+ */
+static THD_FUNCTION(argb_enc_thread, arg)
 {
-    uint8_t r = rgb.r;
-    uint8_t g = rgb.g;
-    uint8_t b = rgb.b;
-    uint8_t h, s, v;
-    
-    // find desaturation
-    uint8_t desat = 255;
-    if( r < desat) desat = r;
-    if( g < desat) desat = g;
-    if( b < desat) desat = b;
-    
-    // remove saturation from all channels
-    r -= desat;
-    g -= desat;
-    b -= desat;
-    
-    //uint8_t orig_desat = sqrt16( desat * 256);
-    
-    // saturation is opposite of desaturation
-    s = 255 - desat;
-    
-    if( s != 255 ) {
-        // undo 'dimming' of saturation
-        s = 255 - sqrt16( (255-s) * 256);
-    }
-    // without lib8tion: float ... ew ... sqrt... double ew, or rather, ew ^ 0.5
-    // if( s != 255 ) s = (255 - (256.0 * sqrt( (float)(255-s) / 256.0)));
-    
-    
-    // at least one channel is now zero
-    // if all three channels are zero, we had a
-    // shade of gray.
-    if( (r + g + b) == 0) {
-        // we pick hue zero for no special reason
-        hsv_t hsv = {.h=0, .s=0, .v=255-s};
-        return hsv;
-    }
-    
-    // scale all channels up to compensate for desaturation
-    if( s < 255) {
-        if( s == 0) s = 1;
-        uint32_t scaleup = 65535 / (s);
-        r = ((uint32_t)(r) * scaleup) / 256;
-        g = ((uint32_t)(g) * scaleup) / 256;
-        b = ((uint32_t)(b) * scaleup) / 256;
-    }
+    (void) arg;
+    chRegSetThreadName("argb_enc");
 
-    uint16_t total = r + g + b;
-    
-    // scale all channels up to compensate for low values
-    if( total < 255) {
-        if( total == 0) total = 1;
-        uint32_t scaleup = 65535 / (total);
-        r = ((uint32_t)(r) * scaleup) / 256;
-        g = ((uint32_t)(g) * scaleup) / 256;
-        b = ((uint32_t)(b) * scaleup) / 256;
-    }
-    
-    if( total > 255 ) {
-        v = 255;
-    } else {
-        v = qadd8(desat,total);
-        // undo 'dimming' of brightness
-        if( v != 255) v = sqrt16( v * 256);
-        // without lib8tion: float ... ew ... sqrt... double ew, or rather, ew ^ 0.5
-        // if( v != 255) v = (256.0 * sqrt( (float)(v) / 256.0));
-        
-    }
-    
-    // since this wasn't a pure shade of gray,
-    // the interesting question is what hue is it    
-    
-    // start with which channel is highest
-    // (ties don't matter)
-    uint8_t highest = r;
-    if( g > highest) highest = g;
-    if( b > highest) highest = b;
-    
-    if( highest == r ) {
-        // Red is highest.
-        // Hue could be Purple/Pink-Red,Red-Orange,Orange-Yellow
-        if( g == 0 ) {
-            // if green is zero, we're in Purple/Pink-Red
-            h = (HUE_PURPLE + HUE_PURPLE) / 2;
-            h += scale8( qsub8(r, 128), FIXFRAC8(48,128));
-        } else if ( (r - g) > g) {
-            // if R-G > G then we're in Red-Orange
-            h = HUE_RED;
-            h += scale8( g, FIXFRAC8(32,85));
-        } else {
-            // R-G < G, we're in Orange-Yellow
-            h = HUE_YELLOW;
-            h += scale8( qsub8((g - 85) + (171 - r), 4), FIXFRAC8(32,85)); //221
-        }
-        
-    } else if ( highest == g) {
-        // Green is highest
-        // Hue could be Yellow-Green, Green-Aqua
-        if( b == 0) {
-            // if Blue is zero, we're in Yellow-Green
-            //   G = 171..255
-            //   R = 171..  0
-            h = HUE_YELLOW;
-            uint8_t radj = scale8( qsub8(171,r),   47); //171..0 -> 0..171 -> 0..31
-            uint8_t gadj = scale8( qsub8(g,171),   96); //171..255 -> 0..84 -> 0..31;
-            uint8_t rgadj = radj + gadj;
-            uint8_t hueadv = rgadj / 2;
-            h += hueadv;
-            //h += scale8( qadd8( 4, qadd8((g - 128), (128 - r))),
-            //             FIXFRAC8(32,255)); //
-        } else {
-            // if Blue is nonzero we're in Green-Aqua
-            if( (g-b) > b) {
-                h = HUE_GREEN;
-                h += scale8( b, FIXFRAC8(32,85));
-            } else {
-                h = HUE_AQUA;
-                h += scale8( qsub8(b, 85), FIXFRAC8(8,42));
-            }
-        }
-        
-    } else /* highest == b */ {
-        // Blue is highest
-        // Hue could be Aqua/Blue-Blue, Blue-Purple, Purple-Pink
-        if( r == 0) {
-            // if red is zero, we're in Aqua/Blue-Blue
-            h = HUE_AQUA + ((HUE_BLUE - HUE_AQUA) / 4);
-            h += scale8( qsub8(b, 128), FIXFRAC8(24,128));
-        } else if ( (b-r) > r) {
-            // B-R > R, we're in Blue-Purple
-            h = HUE_BLUE;
-            h += scale8( r, FIXFRAC8(32,85));
-        } else {
-            // B-R < R, we're in Purple-Pink
-            h = HUE_PURPLE;
-            h += scale8( qsub8(r, 85), FIXFRAC8(32,85));
-        }
-    }
-    
-    h += 1;
-    hsv_t hsv = {.h=h, .s=s, .v=v};
-    return hsv;
+    while (true)
+        argb_enc_step();
 }
 
-hsv_t argb_get_hue(uint16_t i)
+/**
+ * @brief Get encode worker counters
+ * @param[out] stats Queue depth and stalls, lowest depth is reset
+ */
+void argb_get_encode_stats(argb_encode_stats *stats)
+{
+    chSysLock();
+    enc_stats.depth = enc_ring_ready;
+    *stats = enc_stats;
+    enc_stats.min_depth = ARGB_CHUNKS;
+    chSysUnlock();
+}
+#endif
+
+#if ARGB_USE_TRACE
+/**
+ * @brief Append trace record
+ * @param[in] ev Event
+ * @param[in] arg8 Event argument
+ * @param[in] arg16 Event argument
+ * @note Any context, interrupts are held for a few stores
+ */
+static inline void argb_trace(argb_trace_ev ev, uint8_t arg8, uint16_t arg16)
 {
-    rgb_t rgb = {.r=rgb_buf[(3*i)], .g=rgb_buf[(3*i)+1], .b=rgb_buf[(3*i)+2]};
-    return rgb2hsv_approximate(rgb);
+    if (!argb_trace_on)
+        return;
+
+    syssts_t sts = chSysGetStatusAndLockX();
+    argb_trace_rec *rec = &argb_trace_buf[argb_trace_head++ & (ARGB_TRACE_LEN - 1)];
+    rec->t = chSysGetRealtimeCounterX();
+    rec->ev = ev;
+    rec->arg8 = arg8;
+    rec->arg16 = arg16;
+    chSysRestoreStatusX(sts);
 }
 
-rgb_t argb_get_rgb(uint16_t i)
+/**
+ * @brief Start or stop recording
+ * @param[in] on true - record events
+ * @note Stop it while reading records out
+ */
+void argb_trace_enable(bool on)
 {
-    rgb_t rgb = {.r=rgb_buf[(3*i)], .g=rgb_buf[(3*i)+1], .b=rgb_buf[(3*i)+2]};
-    return rgb;
+    argb_trace_on = on;
+}
+
+/**
+ * @brief Drop all records
+ */
+void argb_trace_clear(void)
+{
+    syssts_t sts = chSysGetStatusAndLockX();
+    argb_trace_head = 0;
+    chSysRestoreStatusX(sts);
 }
 
+/**
+ * @brief Get number of records kept
+ * @return Records, up to #ARGB_TRACE_LEN
+ */
+uint16_t argb_trace_count(void)
+{
+    return (argb_trace_head < ARGB_TRACE_LEN) ? argb_trace_head : ARGB_TRACE_LEN;
+}
+
+/**
+ * @brief Get trace record
+ * @param[in] k Record number, 0 - oldest
+ * @param[out] rec Record
+ * @return false if there's no such record
+ */
+bool argb_trace_get(uint16_t k, argb_trace_rec *rec)
+{
+    syssts_t sts = chSysGetStatusAndLockX();
+    uint16_t n = argb_trace_count();
+    if (k < n)
+        *rec = argb_trace_buf[(argb_trace_head - n + k) & (ARGB_TRACE_LEN - 1)];
+    chSysRestoreStatusX(sts);
+    return k < n;
+}
+#endif
+
 /**
   * @brief  TIM DMA Delay Pulse callback.
   * @param  dummy param, null ptr
@@ -759,7 +2732,14 @@ void argb_tim_dma_delay_pulse(void *param, uint32_t flags)
     (void) param;
 
     if (buf_counter == 0) return; // if no data to transmit - return
-    
+
+#if ARGB_USE_DBM
+    if (flags & STM32_DMA_ISR_TCIF)
+    {
+        // CT already points at the buffer DMA went on with, fill the other one
+        argb_half_sent((DMA_HANDLE->stream->CR & STM32_DMA_CR_CT) ? 0 : 1);
+    }
+#else
     if (flags & STM32_DMA_ISR_HTIF)
     {
         if (!(flags & STM32_DMA_ISR_TCIF))
@@ -767,127 +2747,16 @@ void argb_tim_dma_delay_pulse(void *param, uint32_t flags)
             dmaStreamClearInterrupt(DMA_HANDLE);
         }
 
-        if (buf_counter < NUM_PIXELS) 
-        {
-            // fill first part of buffer
-            for (volatile uint8_t i = 0; i < 8; i++) 
-            {
-#if defined(MIXED_RGB_GRB) && defined(RGBW)
-                if ((buf_counter >= grb_start) && (buf_counter <= grb_end))
-                {
-                    pwm_buf[i] = (((rgb_buf[4 * buf_counter] << i) & 0x80) > 0) ?          GRB_PWM_HI : GRB_PWM_LO;
-                    pwm_buf[i + 8] = (((rgb_buf[4 * buf_counter + 1] << i) & 0x80) > 0) ?  GRB_PWM_HI : GRB_PWM_LO;
-                    pwm_buf[i + 16] = (((rgb_buf[4 * buf_counter + 2] << i) & 0x80) > 0) ? GRB_PWM_HI : GRB_PWM_LO;
-                    pwm_buf[i + 24] = (((rgb_buf[4 * buf_counter + 3] << i) & 0x80) > 0)?  GRB_PWM_HI : GRB_PWM_LO;
-                }
-                else if ((buf_counter >= rgb_start) && (buf_counter <= rgb_end))
-                {
-                    pwm_buf[i] = (((rgb_buf[4 * buf_counter] << i) & 0x80) > 0) ?          RGB_PWM_HI : RGB_PWM_LO;
-                    pwm_buf[i + 8] = (((rgb_buf[4 * buf_counter + 1] << i) & 0x80) > 0) ?  RGB_PWM_HI : RGB_PWM_LO;
-                    pwm_buf[i + 16] = (((rgb_buf[4 * buf_counter + 2] << i) & 0x80) > 0) ? RGB_PWM_HI : RGB_PWM_LO;
-                    pwm_buf[i + 24] = (((rgb_buf[4 * buf_counter + 3] << i) & 0x80) > 0)?  RGB_PWM_HI : RGB_PWM_LO;
-                }
-#elif defined(MIXED_RGB_GRB) && !defined(RGBW)
-                if ((buf_counter >= grb_start) && (buf_counter <= grb_end))
-                {
-                    pwm_buf[i] = (((rgb_buf[3 * buf_counter] << i) & 0x80) > 0) ?          GRB_PWM_HI : GRB_PWM_LO;
-                    pwm_buf[i + 8] = (((rgb_buf[3 * buf_counter + 1] << i) & 0x80) > 0) ?  GRB_PWM_HI : GRB_PWM_LO;
-                    pwm_buf[i + 16] = (((rgb_buf[3 * buf_counter + 2] << i) & 0x80) > 0) ? GRB_PWM_HI : GRB_PWM_LO;
-                }
-                else if ((buf_counter >= rgb_start) && (buf_counter <= rgb_end))
-                {
-                    pwm_buf[i] = (((rgb_buf[3 * buf_counter] << i) & 0x80) > 0) ?          RGB_PWM_HI : RGB_PWM_LO;
-                    pwm_buf[i + 8] = (((rgb_buf[3 * buf_counter + 1] << i) & 0x80) > 0) ?  RGB_PWM_HI : RGB_PWM_LO;
-                    pwm_buf[i + 16] = (((rgb_buf[3 * buf_counter + 2] << i) & 0x80) > 0) ? RGB_PWM_HI : RGB_PWM_LO;
-                }
-#elif defined(RGBW)
-                pwm_buf[i] = (((rgb_buf[4 * buf_counter] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-                pwm_buf[i + 8] = (((rgb_buf[4 * buf_counter + 1] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-                pwm_buf[i + 16] = (((rgb_buf[4 * buf_counter + 2] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-                pwm_buf[i + 24] = (((rgb_buf[4 * buf_counter + 3] << i) & 0x80) > 0)? PWM_HI : PWM_LO;
-#else
-                pwm_buf[i] = (((rgb_buf[3 * buf_counter] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-                pwm_buf[i + 8] = (((rgb_buf[3 * buf_counter + 1] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-                pwm_buf[i + 16] = (((rgb_buf[3 * buf_counter + 2] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-#endif
-            }
-            buf_counter++;
-        } 
-        else if (buf_counter < NUM_PIXELS + 2) // if RET transfer
-        {
-            memset((dma_siz *) &pwm_buf[0], 0, (PWM_BUF_LEN / 2)*sizeof(dma_siz)); // first part
-            buf_counter++;
-        }
+        // fill first part of buffer
+        if (argb_half_sent(0))
+            return;
     }
     if (flags & STM32_DMA_ISR_TCIF)
     {
-        // if data transfer
-        if (buf_counter < NUM_PIXELS) 
-        {
-            // fill second part of buffer
-            for (volatile uint8_t i = 0; i < 8; i++) 
-            {
-#if defined(MIXED_RGB_GRB) && defined(RGBW)
-                if ((buf_counter >= grb_start) && (buf_counter <= grb_end))
-                {
-                    pwm_buf[i + 32] = (((rgb_buf[4 * buf_counter] << i) & 0x80) > 0) ?     GRB_PWM_HI : GRB_PWM_LO;
-                    pwm_buf[i + 40] = (((rgb_buf[4 * buf_counter + 1] << i) & 0x80) > 0) ? GRB_PWM_HI : GRB_PWM_LO;
-                    pwm_buf[i + 48] = (((rgb_buf[4 * buf_counter + 2] << i) & 0x80) > 0) ? GRB_PWM_HI : GRB_PWM_LO;
-                    pwm_buf[i + 56] = (((rgb_buf[4 * buf_counter + 3] << i) & 0x80) > 0) ? GRB_PWM_HI : GRB_PWM_LO;
-                }
-                else if ((buf_counter >= rgb_start) && (buf_counter <= rgb_end))
-                {
-                    pwm_buf[i + 32] = (((rgb_buf[4 * buf_counter] << i) & 0x80) > 0) ?     RGB_PWM_HI : RGB_PWM_LO;
-                    pwm_buf[i + 40] = (((rgb_buf[4 * buf_counter + 1] << i) & 0x80) > 0) ? RGB_PWM_HI : RGB_PWM_LO;
-                    pwm_buf[i + 48] = (((rgb_buf[4 * buf_counter + 2] << i) & 0x80) > 0) ? RGB_PWM_HI : RGB_PWM_LO;
-                    pwm_buf[i + 56] = (((rgb_buf[4 * buf_counter + 3] << i) & 0x80) > 0) ? RGB_PWM_HI : RGB_PWM_LO;
-                }
-#elif defined(MIXED_RGB_GRB) && !defined(RGBW)
-                if ((buf_counter >= grb_start) && (buf_counter <= grb_end))
-                {
-                    pwm_buf[i + 24] = (((rgb_buf[3 * buf_counter] << i) & 0x80) > 0) ?     GRB_PWM_HI : GRB_PWM_LO;
-                    pwm_buf[i + 32] = (((rgb_buf[3 * buf_counter + 1] << i) & 0x80) > 0) ? GRB_PWM_HI : GRB_PWM_LO;
-                    pwm_buf[i + 40] = (((rgb_buf[3 * buf_counter + 2] << i) & 0x80) > 0) ? GRB_PWM_HI : GRB_PWM_LO;
-                }
-                else if ((buf_counter >= rgb_start) && (buf_counter <= rgb_end))
-                {
-                    pwm_buf[i + 24] = (((rgb_buf[3 * buf_counter] << i) & 0x80) > 0) ?     RGB_PWM_HI : RGB_PWM_LO;
-                    pwm_buf[i + 32] = (((rgb_buf[3 * buf_counter + 1] << i) & 0x80) > 0) ? RGB_PWM_HI : RGB_PWM_LO;
-                    pwm_buf[i + 40] = (((rgb_buf[3 * buf_counter + 2] << i) & 0x80) > 0) ? RGB_PWM_HI : RGB_PWM_LO;
-                }
-#elif defined(RGBW)
-                pwm_buf[i + 32] = (((rgb_buf[4 * buf_counter] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-                pwm_buf[i + 40] = (((rgb_buf[4 * buf_counter + 1] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-                pwm_buf[i + 48] = (((rgb_buf[4 * buf_counter + 2] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-                pwm_buf[i + 56] = (((rgb_buf[4 * buf_counter + 3] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-#else
-                pwm_buf[i + 24] = (((rgb_buf[3 * buf_counter] << i) & 0x80) > 0) ?     PWM_HI : PWM_LO;
-                pwm_buf[i + 32] = (((rgb_buf[3 * buf_counter + 1] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-                pwm_buf[i + 40] = (((rgb_buf[3 * buf_counter + 2] << i) & 0x80) > 0) ? PWM_HI : PWM_LO;
-#endif
-            }
-            buf_counter++;
-        } 
-        else if (buf_counter < NUM_PIXELS + 2) // if RET transfer
-        {
-            memset((dma_siz *) &pwm_buf[PWM_BUF_LEN / 2], 0, (PWM_BUF_LEN / 2)*sizeof(dma_siz)); // second part
-            buf_counter++;
-        } 
-        else 
-        { // if END of transfer
-            buf_counter = 0;
-
-            // STOP DMA
-            dmaStreamDisable(DMA_HANDLE);
-            
-            /* Disable the Peripheral */
-            TIM_HANDLE.tim->DIER &= ~STM32_TIM_DIER_CC4DE;
-            pwmDisableChannelI(&TIM_HANDLE, TIM_CH);
-            TIM_HANDLE.tim->CR1 &= ~STM32_TIM_CR1_CEN;
-
-            argb_lock_state = ARGB_READY;
-        }
+        // fill second part of buffer
+        argb_half_sent(1);
     }
+#endif
 }
 
 /** @} */ // Private
@@ -910,3 +2779,44 @@ void argb_tim_dma_delay_pulse(void *param, uint32_t flags)
 #if !(defined(DMA_SIZE_BYTE) | defined(DMA_SIZE_HWORD) | defined(DMA_SIZE_WORD))
 #error Wrong DMA Size! Fix it in ARGB.h string 42
 #endif
+
+// Check double-buffer mode
+#if ARGB_USE_DBM && !defined(STM32_DMA_CR_DBM)
+#error ARGB_USE_DBM needs a DMA with double-buffer mode (STM32F2/F4/F7)
+#endif
+#if ARGB_USE_DBM && ARGB_USE_ENCODE_THREAD
+#error ARGB_USE_DBM and ARGB_USE_ENCODE_THREAD can not be used together
+#endif
+#if ARGB_USE_DBM && (ARGB_DBM_LEDS < 1)
+#error ARGB_DBM_LEDS must be at least 1
+#endif
+
+// Check white extraction
+#if ARGB_WHITE_EXTRACT && ((ARGB_WHITE_R < 1) || (ARGB_WHITE_G < 1) || (ARGB_WHITE_B < 1) || \
+                           (ARGB_WHITE_R > 255) || (ARGB_WHITE_G > 255) || (ARGB_WHITE_B > 255))
+#error ARGB_WHITE_R/G/B must be 1..255
+#endif
+
+// Check trace ring
+#if ARGB_USE_TRACE && ((ARGB_TRACE_LEN & (ARGB_TRACE_LEN - 1)) || (ARGB_TRACE_LEN < 2))
+#error ARGB_TRACE_LEN must be a power of 2
+#endif
+
+// Check encode ring
+#if ARGB_USE_ENCODE_THREAD && ((ARGB_RING_CHUNKS < 4) || (ARGB_RING_CHUNKS % 2) || (ARGB_RING_CHUNKS > 254))
+#error ARGB_RING_CHUNKS must be even, 4..254
+#endif
+
+// Check lock-free pixel format
+#if (ARGB_PIXEL_FORMAT == ARGB_FMT_ATOMIC) && defined(__ARM_ARCH_6M__)
+#error ARGB_FMT_ATOMIC needs LDREX/STREX, not available on Cortex-M0/M0+
+#endif
+
+// Check bit rate against chip tolerances and timer clock
+#if defined(MIXED_RGB_GRB)
+_Static_assert(ARGB_TIMING_OK(ARGB_RGB_PROFILE), "RGB chip timing can't be met, check ARGB_BIT_RATE_HZ and timer clock");
+_Static_assert(ARGB_TIMING_OK(ARGB_GRB_PROFILE), "GRB chip timing can't be met, check ARGB_BIT_RATE_HZ and timer clock");
+#else
+_Static_assert(ARGB_TIMING_OK(ARGB_PROFILE), "LED timing can't be met, check ARGB_BIT_RATE_HZ and timer clock");
+#endif
+_Static_assert(ARR_VAL <= (dma_siz) ~0u, "Bit period doesn't fit DMA size, use wider DMA_SIZE");
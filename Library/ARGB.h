@@ -31,8 +31,7 @@
  * @brief LED & Timer's settings
  * @{
  */ 
-#define NUM_PIXELS (NUM_LEDS + 1) ///<- Pixel quantity
-// The `+1` above is an extra byte used to give the DMA transfer a bit of extra time which ensures the last LED's RGB-PWM data gets transfered and then displayed correctly.
+#define NUM_PIXELS NUM_LEDS ///<- Pixel quantity
 
 #define USE_GAMMA_CORRECTION 1 ///< Gamma-correction should fix red&green, try for yourself
 
@@ -45,8 +44,121 @@
 
 #define LED_SIGNAL_RISE_DELAY_US LED_PWM_RISE_DELAY_US
 
+#if !defined(ARGB_BIT_RATE_HZ)
+#if defined(WS2811S)
+#define ARGB_BIT_RATE_HZ 400000 ///< Bit rate, checked against chip timing at compile time
+#else
+#define ARGB_BIT_RATE_HZ 800000 ///< Bit rate, checked against chip timing at compile time
+#endif
+#endif
+
+#if !defined(ARGB_RESET_US)
+#define ARGB_RESET_US 0 ///< Latch (RET code) length in us, 0 - datasheet reset of chips in the chain, nonzero overrides it
+#endif
+
+#define ARGB_FMT_RAW    0 ///< Wire-order bytes, 3-4 bytes per LED
+#define ARGB_FMT_RGB565 1 ///< 16-bit color, 2 bytes per LED, no white
+#define ARGB_FMT_PAL8   2 ///< 8-bit index into 256-entry palette, 1 byte per LED
+#define ARGB_FMT_PAL4   3 ///< 4-bit index into 16-entry palette, 2 LEDs per byte
+#define ARGB_FMT_ATOMIC 4 ///< 32-bit word per LED, lock-free updates from any thread
+
+#if !defined(ARGB_PIXEL_FORMAT)
+#define ARGB_PIXEL_FORMAT ARGB_FMT_RAW ///< Pixel buffer storage, compact ones expand at encode time
+#endif
+
+#if !defined(ARGB_SKIP_UNCHANGED)
+#define ARGB_SKIP_UNCHANGED 0 ///< argb_show() sends nothing if no LED was written since last frame
+#endif
+
+#if !defined(ARGB_FRAME_HASH)
+#define ARGB_FRAME_HASH 0 ///< Also skip frames rewritten with same values, hashes the buffer on show
+#endif
+
+#if !defined(ARGB_KEEPALIVE_MS)
+#define ARGB_KEEPALIVE_MS 1000 ///< Resend unchanged frame after this time, 0 - never
+#endif
+
+#if !defined(ARGB_USE_POWER_LIMIT)
+#define ARGB_USE_POWER_LIMIT 0 ///< Track frame current and limit it at encode time
+#endif
+
+#if !defined(ARGB_WHITE_EXTRACT)
+#define ARGB_WHITE_EXTRACT 0 ///< RGBW LEDs: move the white part of RGB colors to W
+#endif
+
+#if !defined(ARGB_WHITE_R)
+#define ARGB_WHITE_R 255 ///< Tint of W LED as R, G, B mix [1..255], e.g. 255, 200, 140 for warm white
+#endif
+#if !defined(ARGB_WHITE_G)
+#define ARGB_WHITE_G 255
+#endif
+#if !defined(ARGB_WHITE_B)
+#define ARGB_WHITE_B 255
+#endif
+
+#if !defined(ARGB_USE_ENCODE_THREAD)
+#define ARGB_USE_ENCODE_THREAD 0 ///< Encode in a worker thread, DMA interrupt only releases chunks
+#endif
+
+#if !defined(ARGB_RING_CHUNKS)
+#define ARGB_RING_CHUNKS 8 ///< Chunks (one LED each) in PWM buffer ring of the worker, even
+#endif
+
+#if !defined(ARGB_ENCODE_THREAD_PRIO)
+#define ARGB_ENCODE_THREAD_PRIO (HIGHPRIO - 1) ///< Encode worker priority
+#endif
+
+#if !defined(ARGB_ENCODE_THREAD_STACK)
+#define ARGB_ENCODE_THREAD_STACK 256 ///< Encode worker stack, bytes
+#endif
+
+#if !defined(ARGB_USE_DBM)
+#define ARGB_USE_DBM 0 ///< DMA double-buffer mode instead of circular halves (F2/F4/F7)
+#endif
+
+#if !defined(ARGB_DBM_LEDS)
+#define ARGB_DBM_LEDS 1 ///< LEDs encoded in each of the two DMA buffers
+#endif
+
+#if !defined(ARGB_DBM_BUF0_ATTR)
+#define ARGB_DBM_BUF0_ATTR ///< Placement of DMA buffer 0, e.g. __attribute__((section(".ram1")))
+#endif
+
+#if !defined(ARGB_DBM_BUF1_ATTR)
+#define ARGB_DBM_BUF1_ATTR ///< Placement of DMA buffer 1, DMA must reach it (not CCM)
+#endif
+
+#if !defined(ARGB_USE_BENCH)
+#define ARGB_USE_BENCH 0 ///< Build encoder hook for ARGB_bench.c
+#endif
+
+#if !defined(ARGB_DYNAMIC_BUFFERS)
+#define ARGB_DYNAMIC_BUFFERS 0 ///< Buffers come from an arena or heap at init, NUM_LEDS is only the argb_init() layout
+#endif
+
+#if !defined(ARGB_USE_TRACE)
+#define ARGB_USE_TRACE 0 ///< Record driver events with timestamps, see ARGB_trace.h
+#endif
+
+#if !defined(ARGB_TRACE_LEN)
+#define ARGB_TRACE_LEN 64 ///< Trace records kept, power of 2, oldest ones are overwritten
+#endif
+
+#if !defined(ARGB_MAX_SEGMENTS)
+#define ARGB_MAX_SEGMENTS 4 ///< Capacity of the segment table (LED types in one chain)
+#endif
+
 /// @}
 
+/// DMA Size
+#if defined(DMA_SIZE_BYTE)
+typedef uint8_t dma_siz;
+#elif defined(DMA_SIZE_HWORD)
+typedef uint16_t dma_siz;
+#elif defined(DMA_SIZE_WORD)
+typedef uint32_t dma_siz;
+#endif
+
 /**
  * @addtogroup Global_entities
  * @brief All driver's methods
@@ -61,6 +173,44 @@ typedef enum argb_state {
     ARGB_PARAM_ERR = 3, ///< Error in input parameters
 } argb_state;
 
+/**
+ * @enum argb_chip
+ * @brief LED chip family, selects PWM timing of a segment
+ */
+typedef enum argb_chip {
+    ARGB_CHIP_WS2811S = 0, ///< WS2811 slow mode, 400 KHz
+    ARGB_CHIP_WS2811F = 1, ///< WS2811 fast mode, 800 KHz
+    ARGB_CHIP_WS2812 = 2,  ///< WS2812 / WS2812B, 800 KHz
+    ARGB_CHIP_SK6812 = 3,  ///< SK6812, 800 KHz
+} argb_chip;
+
+/**
+ * @enum argb_order
+ * @brief Subpixel order on the wire
+ */
+typedef enum argb_order {
+    ARGB_ORDER_RGB = 0,
+    ARGB_ORDER_RBG = 1,
+    ARGB_ORDER_GRB = 2,
+    ARGB_ORDER_GBR = 3,
+    ARGB_ORDER_BRG = 4,
+    ARGB_ORDER_BGR = 5,
+} argb_order;
+
+/**
+ * @struct argb_segment
+ * @brief Run of identical LEDs inside the chain
+ * @note Segments must follow each other: first one starts at 0,
+ *       every next one starts where the previous ends
+ */
+typedef struct argb_segment {
+    uint16_t start;   ///< First LED of the segment
+    uint16_t length;  ///< LED quantity in the segment
+    argb_order order; ///< Subpixel order on the wire
+    uint8_t bpp;      ///< Bytes per pixel: 3 (RGB) or 4 (RGBW)
+    argb_chip chip;   ///< Chip family, gives HI/LO PWM values
+} argb_segment;
+
 // stolen from https://github.com/FastLED/FastLED
 typedef struct {
 	union {
@@ -119,7 +269,63 @@ typedef enum
     // HUE_PINK = 224
 } hsv_hue;
 
-void argb_init(void);   // Initialization
+/**
+ * @enum argb_noise_kind
+ * @brief Noise function of #argb_noise
+ */
+typedef enum argb_noise_kind {
+    ARGB_NOISE_VALUE = 0,    ///< Smoothed random lattice values, cheapest, blocky at low steps
+    ARGB_NOISE_GRADIENT = 1, ///< Perlin-style gradient noise, smoother features
+} argb_noise_kind;
+
+/**
+ * @struct argb_noise
+ * @brief Noise field sampled along LEDs range
+ * @note Coordinates are 8.8 fixed point, 256 is one lattice cell,
+ *       field repeats every 256 cells
+ */
+typedef struct argb_noise {
+    argb_noise_kind kind; ///< Value or gradient noise
+    uint8_t dims;         ///< Dimensions: 1, 2 or 3
+    uint16_t x;           ///< Position of the first LED
+    uint16_t dx;          ///< Step between LEDs, 16..64 for organic looks
+    uint16_t y;           ///< Row, 2D and 3D
+    uint16_t z;           ///< Plane, 3D, usually time
+} argb_noise;
+
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+/**
+ * @brief Encoder made for one chain layout
+ * @param[out] slots PWM values, 8 per byte
+ * @param[in] src Pixel buffer, wire order
+ * @param[in] byte First wire byte
+ * @param[in] bytes Bytes wanted
+ * @return Bytes encoded, fewer at the chain end
+ */
+typedef uint16_t (*argb_encoder)(volatile dma_siz *slots, const volatile uint8_t *src,
+                                 uint16_t byte, uint16_t bytes);
+#endif
+
+#if ARGB_DYNAMIC_BUFFERS
+extern volatile uint8_t *rgb_buf; ///< Pixel buffer, #ARGB_PIXEL_FORMAT layout
+#else
+extern volatile uint8_t rgb_buf[]; ///< Pixel buffer, #ARGB_PIXEL_FORMAT layout
+#endif
+extern volatile uint8_t argb_brightness; ///< Global brightness
+
+argb_state argb_init(void);   // Initialization
+argb_state argb_init_segments(const argb_segment *segs, uint8_t count); // Initialization with LED segment table
+#if ARGB_DYNAMIC_BUFFERS
+size_t argb_buf_size(const argb_segment *segs, uint8_t count); // Arena bytes a layout needs
+argb_state argb_init_arena(const argb_segment *segs, uint8_t count, void *arena, size_t size);
+#if CH_CFG_USE_HEAP
+argb_state argb_init_heap(const argb_segment *segs, uint8_t count, memory_heap_t *heap); // Buffers from heap, NULL - system
+#endif
+#endif
+uint16_t argb_get_num_leds(void); // LEDs in the chain
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+void argb_set_encoder(argb_encoder enc); // Encoder of the layout just set, NULL - segment table one
+#endif
 void argb_clear(void);  // Clear strip
 
 void argb_set_brightness(uint8_t br); // Set global brightness
@@ -134,13 +340,102 @@ void argb_fill_hsv_range(uint16_t start, uint16_t end, uint8_t hue, uint8_t sat,
 void argb_fill_hsv(hsv_hue hue, uint8_t sat, uint8_t val); // Fill all strip with HSV color
 void argb_fill_white_range(uint16_t start, uint16_t end, uint8_t w);
 void argb_fill_white(uint8_t w); // Fill all strip's white component (RGBW)
+void argb_move(uint16_t dst, uint16_t src, uint16_t count); // Move LEDs span, colors are kept
+uint16_t argb_write_rgb(uint16_t start, const uint8_t *rgb, uint16_t count); // Write raw R,G,B bytes
+void argb_fill_noise_hsv(uint16_t start, uint16_t end, const argb_noise *nz, hsv_t lo, hsv_t hi); // Fill range with noise colors
+#if ARGB_WHITE_EXTRACT
+void argb_rgb_to_rgbw(const uint8_t *rgb, uint8_t *rgbw, uint16_t count); // Split R,G,B span into R,G,B,W
+#endif
 
 void hsv2rgb_spectrum( const hsv_t hsv, rgb_t * rgb);
+hsv_t rgb2hsv_approximate(const rgb_t rgb);
 
 hsv_t argb_get_hue(uint16_t i);
 rgb_t argb_get_rgb(uint16_t i);
+uint8_t argb_get_white(uint16_t i); // Get white component (RGBW)
+uint16_t argb_get_rgb_range(uint16_t start, uint16_t count, rgb_t *out); // Read LEDs range as RGB
+uint16_t argb_get_hsv_range(uint16_t start, uint16_t count, hsv_t *out); // Read LEDs range as HSV
+
+#if (ARGB_PIXEL_FORMAT == ARGB_FMT_PAL8) || (ARGB_PIXEL_FORMAT == ARGB_FMT_PAL4)
+void argb_set_palette(uint8_t idx, uint8_t r, uint8_t g, uint8_t b, uint8_t w); // Set palette entry
+void argb_set_index(uint16_t i, uint8_t idx); // Set single LED by palette index
+void argb_fill_index_range(uint16_t start, uint16_t end, uint8_t idx);
+void argb_fill_noise_index(uint16_t start, uint16_t end, const argb_noise *nz); // Fill range with noise as palette index
+uint8_t argb_get_index(uint16_t i);
+#endif
+
+#if ARGB_USE_POWER_LIMIT
+void argb_set_power_limit(uint32_t ma); // Limit strip current, 0 - no limit
+uint32_t argb_get_power(void); // Get estimated strip current, mA
+#endif
+
+#if ARGB_USE_BENCH
+uint16_t argb_bench_encode(void); // Encode whole chain without DMA
+#endif
+
+#if ARGB_USE_TRACE
+/**
+ * @enum argb_trace_ev
+ * @brief Traced driver event
+ */
+typedef enum argb_trace_ev {
+    ARGB_TR_SHOW = 0,      ///< Show requested, arg8: 1 - cross-fade, arg16: 1 - strip busy
+    ARGB_TR_DMA_START = 1, ///< DMA started
+    ARGB_TR_HALF = 2,      ///< Half sent, arg8: HT/TC half or DBM buffer, arg16: halves filled, encode thread: chunks encoded ahead
+    ARGB_TR_RESET = 3,     ///< RET code started, arg16: zero slots already sent
+    ARGB_TR_READY = 4,     ///< RET code over, strip ready
+    ARGB_TR_SKIP = 5,      ///< Frame skipped as unchanged
+} argb_trace_ev;
+
+/**
+ * @struct argb_trace_rec
+ * @brief Trace record
+ */
+typedef struct argb_trace_rec {
+    rtcnt_t t;      ///< Realtime counter
+    uint8_t ev;     ///< #argb_trace_ev
+    uint8_t arg8;   ///< Event argument
+    uint16_t arg16; ///< Event argument
+} argb_trace_rec;
+
+void argb_trace_enable(bool on); // Start / stop recording
+void argb_trace_clear(void); // Drop all records
+uint16_t argb_trace_count(void); // Records kept
+bool argb_trace_get(uint16_t k, argb_trace_rec *rec); // Get record, 0 - oldest
+#endif
+
+#if ARGB_SKIP_UNCHANGED
+void argb_touch(void); // Mark frame as changed after direct buffer writes
+uint32_t argb_get_skipped(void); // Frames skipped as unchanged
+#endif
+
+#if ARGB_USE_ENCODE_THREAD
+/**
+ * @struct argb_encode_stats
+ * @brief Encode worker counters
+ */
+typedef struct argb_encode_stats {
+    uint32_t stalls;   ///< Halves DMA started before the worker had encoded them
+    uint8_t depth;     ///< Encoded chunks ahead of DMA now
+    uint8_t min_depth; ///< Lowest depth at a half boundary since last read
+} argb_encode_stats;
+
+void argb_get_encode_stats(argb_encode_stats *stats); // Get worker queue depth & stalls
+#endif
 
 argb_state argb_ready(void); // Get DMA Ready state
 argb_state argb_show(void); // Push data to the strip
 
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+#if defined(RGBW)
+#define ARGB_FRAME_BYTES (4 * NUM_PIXELS) ///< Frame size for cross-fades
+#else
+#define ARGB_FRAME_BYTES (3 * NUM_PIXELS) ///< Frame size for cross-fades
+#endif
+argb_state argb_show_crossfade(const uint8_t *a, const uint8_t *b, uint8_t amount); // Push blend of two frames
+uint16_t argb_get_frame_bytes(void); // Frame size of current layout
+void argb_frame_save(uint8_t *frame); // Copy pixel buffer into a frame
+void argb_fade(const uint8_t *a, const uint8_t *b, uint16_t frames, uint32_t ms); // Timed fade, blocking
+#endif
+
 /// @} @}
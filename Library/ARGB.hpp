@@ -0,0 +1,567 @@
+/**
+ *******************************************
+ * @file    ARGB.hpp
+ * @brief   Compile-time chain layout for C++ on top of ARGB Driver
+ *******************************************
+ *
+ * Strip<Chip, NumLeds, Order> describes LEDs of one type and
+ * Chain<Strips...> puts them one after another on the driver's timer
+ * channel. Chip timing, subpixel order and strip offsets are constant
+ * expressions: strip setters write the pixel buffer at positions known
+ * at compile time and the chain hands the driver an encoder unrolled
+ * per strip, with no segment lookup at run time. DMA, latch and the
+ * frame calls stay the ones of ARGB.c.
+ *
+ * Features that keep per-segment bookkeeping (power limit, white
+ * extraction for RGBW strips, compact pixel formats) make the strip
+ * setters call the C functions instead; cross-fades and frames scaled
+ * by the power limit go through the C encoder.
+ *
+ * @code
+ * using Desk = argb::Strip<argb::Ws2812, 60, argb::GRB>;
+ * using Shelf = argb::Strip<argb::Sk6812, 30, argb::GRBW>;
+ * using Leds = argb::Chain<Desk, Shelf>;
+ *
+ * Leds::init();
+ * Leds::strip<0>().set_rgb(0, 255, 0, 0);
+ * Leds::strip<1>().set_white(3, 128);
+ * while (Leds::show() != ARGB_OK);
+ * @endcode
+ *
+ * @note Needs C++14. Chip timing is checked at compile time at the
+ *       driver's timer clock and bit rate
+ * @note Strip setters write #rgb_buf, dynamic buffers need init() first
+ */
+
+#pragma once
+
+extern "C" {
+#include "ARGB.h"
+#include "ARGB_timing.h"
+}
+#include <stdint.h>
+
+/**
+ * @addtogroup ARGB_Driver
+ * @{
+ * @addtogroup Cpp_front_end
+ * @brief Compile-time chain layout
+ * @{
+ */
+
+namespace argb {
+
+/**
+ * @brief Chip family with its PWM values at the driver's clock
+ * @tparam C Chip of the C driver
+ * @tparam Hi Log.1 compare value
+ * @tparam Lo Log.0 compare value
+ * @tparam Ok Tolerances met at #ARGB_BIT_RATE_HZ
+ */
+template <argb_chip C, uint32_t Hi, uint32_t Lo, bool Ok>
+struct Chip {
+    static constexpr argb_chip chip = C;
+    static constexpr dma_siz hi = Hi; ///< Log.1 compare value
+    static constexpr dma_siz lo = Lo; ///< Log.0 compare value
+    static constexpr bool timing_ok = Ok;
+
+    static_assert((Hi == hi) && (Lo == lo), "PWM values don't fit DMA size");
+};
+
+/// Chip of a profile from ARGB_timing.h
+#define ARGB_CPP_CHIP(chip, prof) \
+    Chip<chip, ARGB_PWM_HI(prof), ARGB_PWM_LO(prof), ARGB_TIMING_OK(prof)>
+
+using Ws2811Slow = ARGB_CPP_CHIP(ARGB_CHIP_WS2811S, ARGB_WS2811S); ///< WS2811 slow mode, 400 KHz
+using Ws2811Fast = ARGB_CPP_CHIP(ARGB_CHIP_WS2811F, ARGB_WS2811F); ///< WS2811 fast mode, 800 KHz
+using Ws2812 = ARGB_CPP_CHIP(ARGB_CHIP_WS2812, ARGB_WS2812);       ///< WS2812 / WS2812B, 800 KHz
+using Sk6812 = ARGB_CPP_CHIP(ARGB_CHIP_SK6812, ARGB_SK6812);       ///< SK6812, 800 KHz
+
+#undef ARGB_CPP_CHIP
+
+/**
+ * @brief Subpixel order on the wire
+ * @tparam O Order of R, G, B
+ * @tparam White RGBW LED, white byte goes last
+ */
+template <argb_order O, bool White = false>
+struct Order {
+    static constexpr argb_order order = O;
+    static constexpr bool white = White;
+    static constexpr uint8_t bpp = White ? 4 : 3; ///< Bytes per pixel
+
+    /// Wire position of R, G, B, the table of ARGB.c
+    static constexpr uint8_t pos(uint8_t c)
+    {
+        constexpr uint8_t map[][3] = {
+            {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {2, 0, 1}, {1, 2, 0}, {2, 1, 0},
+        };
+        return map[O][c];
+    }
+
+    static constexpr uint8_t r = pos(0); ///< Wire position of red
+    static constexpr uint8_t g = pos(1); ///< Wire position of green
+    static constexpr uint8_t b = pos(2); ///< Wire position of blue
+};
+
+using RGB = Order<ARGB_ORDER_RGB>;
+using RBG = Order<ARGB_ORDER_RBG>;
+using GRB = Order<ARGB_ORDER_GRB>;
+using GBR = Order<ARGB_ORDER_GBR>;
+using BRG = Order<ARGB_ORDER_BRG>;
+using BGR = Order<ARGB_ORDER_BGR>;
+using RGBW = Order<ARGB_ORDER_RGB, true>;
+using GRBW = Order<ARGB_ORDER_GRB, true>;
+
+/**
+ * @brief LEDs of one type, a segment of the chain
+ * @tparam Chip Chip family: Ws2811Slow, Ws2811Fast, Ws2812, Sk6812
+ * @tparam NumLeds LED quantity
+ * @tparam Ord Subpixel order, RGBW ones add white
+ */
+template <class Chip, uint16_t NumLeds, class Ord = GRB>
+struct Strip {
+    using chip_type = Chip;
+    using order_type = Ord;
+    static constexpr uint16_t num_leds = NumLeds;
+
+    static_assert(NumLeds != 0, "Strip needs LEDs");
+};
+
+/**
+ * @brief Strip placed in the chain, positions are the strip's own
+ * @tparam First Chain position of the strip's LED 0
+ * @tparam Off Pixel buffer offset of the strip's LED 0
+ * @tparam S Strip type
+ */
+template <uint16_t First, uint16_t Off, class S>
+class StripAt {
+    using Ord = typename S::order_type;
+
+    /// Setters write #rgb_buf themselves, no C bookkeeping to keep
+    static constexpr bool direct = (ARGB_PIXEL_FORMAT == ARGB_FMT_RAW) && !ARGB_USE_POWER_LIMIT &&
+                                   !(ARGB_WHITE_EXTRACT && Ord::white);
+
+    /// Global brightness, argb_dim() of ARGB.c
+    static uint8_t dim(uint8_t x)
+    {
+        return x / (256 / ((uint16_t) argb_brightness + 1));
+    }
+
+    /// Store R, G, B at wire positions
+    static void put(uint16_t i, uint8_t r, uint8_t g, uint8_t b)
+    {
+        volatile uint8_t *px = &rgb_buf[Off + i * Ord::bpp];
+        px[Ord::r] = r;
+        px[Ord::g] = g;
+        px[Ord::b] = b;
+    }
+
+    /// Frame changed, see argb_touch()
+    static void touch()
+    {
+#if ARGB_SKIP_UNCHANGED
+        argb_touch();
+#endif
+    }
+
+public:
+    static constexpr uint16_t first = First;           ///< Chain position of LED 0
+    static constexpr uint16_t offset = Off;            ///< Pixel buffer offset of LED 0
+    static constexpr uint16_t num_leds = S::num_leds;  ///< LED quantity
+
+    /**
+     * @brief Set LED with RGB color
+     * @param[in] i LED position in the strip
+     * @param[in] r Red component   [0..255]
+     * @param[in] g Green component [0..255]
+     * @param[in] b Blue component  [0..255]
+     */
+    static void set_rgb(uint16_t i, uint8_t r, uint8_t g, uint8_t b)
+    {
+        if (i >= num_leds)
+            return;
+        if (!direct)
+        {
+            argb_set_rgb(first + i, r, g, b);
+            return;
+        }
+        r = dim(r);
+        g = dim(g);
+        b = dim(b);
+#if USE_GAMMA_CORRECTION
+        g = ((uint16_t) g * 0xB0) >> 8;
+        b = ((uint16_t) b * 0xF0) >> 8;
+#endif
+        put(i, r, g, b);
+        touch();
+    }
+
+    /**
+     * @brief Set LED with HSV color
+     * @param[in] i LED position in the strip
+     * @param[in] hue HUE (color) [0..255]
+     * @param[in] sat Saturation  [0..255]
+     * @param[in] val Value (brightness) [0..255]
+     */
+    static void set_hsv(uint16_t i, uint8_t hue, uint8_t sat, uint8_t val)
+    {
+        rgb_t rgb = {};
+        hsv_t hsv = {};
+
+        hsv.h = hue;
+        hsv.s = sat;
+        hsv.v = val;
+        hsv2rgb_spectrum(hsv, &rgb);
+        set_rgb(i, rgb.r, rgb.g, rgb.b);
+    }
+
+    /**
+     * @brief Set white component of LED, RGBW orders only
+     * @param[in] i LED position in the strip
+     * @param[in] w White component [0..255]
+     */
+    static void set_white(uint16_t i, uint8_t w)
+    {
+        static_assert(Ord::white, "Strip has no white component");
+        if (i >= num_leds)
+            return;
+        if (!direct)
+        {
+            argb_set_white(first + i, w);
+            return;
+        }
+        rgb_buf[Off + i * 4 + 3] = dim(w);
+        touch();
+    }
+
+    /**
+     * @brief Fill the strip with RGB color
+     * @param[in] r Red component   [0..255]
+     * @param[in] g Green component [0..255]
+     * @param[in] b Blue component  [0..255]
+     */
+    static void fill_rgb(uint8_t r, uint8_t g, uint8_t b)
+    {
+        if (!direct)
+        {
+            argb_fill_rgb_range(first, first + num_leds - 1, r, g, b);
+            return;
+        }
+        r = dim(r);
+        g = dim(g);
+        b = dim(b);
+#if USE_GAMMA_CORRECTION
+        g = ((uint16_t) g * 0xB0) >> 8;
+        b = ((uint16_t) b * 0xF0) >> 8;
+#endif
+        for (uint16_t i = 0; i < num_leds; i++)
+            put(i, r, g, b);
+        touch();
+    }
+
+    /**
+     * @brief Fill the strip with HSV color
+     * @param[in] hue HUE (color) [0..255]
+     * @param[in] sat Saturation  [0..255]
+     * @param[in] val Value (brightness) [0..255]
+     */
+    static void fill_hsv(uint8_t hue, uint8_t sat, uint8_t val)
+    {
+        rgb_t rgb = {};
+        hsv_t hsv = {};
+
+        hsv.h = hue;
+        hsv.s = sat;
+        hsv.v = val;
+        hsv2rgb_spectrum(hsv, &rgb);
+        fill_rgb(rgb.r, rgb.g, rgb.b);
+    }
+
+    /**
+     * @brief Fill white component of the strip, RGBW orders only
+     * @param[in] w White component [0..255]
+     */
+    static void fill_white(uint8_t w)
+    {
+        static_assert(Ord::white, "Strip has no white component");
+        if (!direct)
+        {
+            argb_fill_white_range(first, first + num_leds - 1, w);
+            return;
+        }
+        w = dim(w);
+        for (uint16_t i = 0; i < num_leds; i++)
+            rgb_buf[Off + i * 4 + 3] = w;
+        touch();
+    }
+
+    /**
+     * @brief Write LEDs span from packed R, G, B bytes
+     * @param[in] start First LED position in the strip
+     * @param[in] rgb Colors, 3 bytes per LED
+     * @param[in] count LED quantity
+     * @return LEDs written, the span is cut at the strip end
+     * @note Values are stored as is, see argb_write_rgb()
+     */
+    static uint16_t write_rgb(uint16_t start, const uint8_t *rgb, uint16_t count)
+    {
+        if (start >= num_leds)
+            return 0;
+        if (count > num_leds - start)
+            count = num_leds - start;
+        if (!direct)
+            return argb_write_rgb(first + start, rgb, count);
+        for (uint16_t k = 0; k < count; k++, rgb += 3)
+            put(start + k, rgb[0], rgb[1], rgb[2]);
+        touch();
+        return count;
+    }
+
+    /**
+     * @brief Get stored color of LED
+     * @param[in] i LED position in the strip
+     * @return Color with brightness & gamma, zero if out of strip
+     */
+    static rgb_t get_rgb(uint16_t i)
+    {
+        rgb_t c = {};
+        if (i >= num_leds)
+            return c;
+        if (!direct)
+            return argb_get_rgb(first + i);
+        const volatile uint8_t *px = &rgb_buf[Off + i * Ord::bpp];
+        c.r = px[Ord::r];
+        c.g = px[Ord::g];
+        c.b = px[Ord::b];
+        return c;
+    }
+
+    /**
+     * @brief Turn all LEDs of the strip off, doesn't send
+     */
+    static void clear()
+    {
+        if (!direct)
+        {
+            argb_fill_rgb_range(first, first + num_leds - 1, 0, 0, 0);
+            if (Ord::white)
+                argb_fill_white_range(first, first + num_leds - 1, 0);
+            return;
+        }
+        for (uint16_t k = 0; k < num_leds * Ord::bpp; k++)
+            rgb_buf[Off + k] = 0;
+        touch();
+    }
+};
+
+/**
+ * @brief Strips in chain order on the driver's timer channel
+ * @tparam Strips Strip types, first one starts at LED 0
+ */
+template <class... Strips>
+class Chain {
+    /// K-th type of a pack
+    template <uint8_t K, class H, class... T>
+    struct Nth { using type = typename Nth<K - 1, T...>::type; };
+    template <class H, class... T>
+    struct Nth<0, H, T...> { using type = H; };
+
+    /// Strip index as a type, picks the encoder overload
+    template <uint8_t K>
+    struct At {};
+
+public:
+    static constexpr uint8_t count = sizeof...(Strips); ///< Segments in the chain
+
+    /// Segment table, filled at compile time
+    struct Table {
+        argb_segment seg[sizeof...(Strips)];
+        uint32_t offset[sizeof...(Strips) + 1]; ///< Wire byte of every strip's LED 0, chain end last
+        uint32_t leds;  ///< LEDs in the chain
+        uint32_t bytes; ///< Wire bytes of the chain
+        bool timing_ok; ///< Every chip meets its tolerances
+    };
+
+private:
+    static constexpr Table make_table()
+    {
+        const uint16_t len[] = {Strips::num_leds...};
+        const argb_order order[] = {Strips::order_type::order...};
+        const uint8_t bpp[] = {Strips::order_type::bpp...};
+        const argb_chip chip[] = {Strips::chip_type::chip...};
+        const bool ok[] = {Strips::chip_type::timing_ok...};
+        Table t = {};
+
+        t.timing_ok = true;
+        for (uint8_t k = 0; k < count; k++)
+        {
+            t.offset[k] = t.bytes;
+            t.timing_ok = t.timing_ok && ok[k];
+            t.seg[k].start = (uint16_t) t.leds;
+            t.seg[k].length = len[k];
+            t.seg[k].order = order[k];
+            t.seg[k].bpp = bpp[k];
+            t.seg[k].chip = chip[k];
+            t.leds += len[k];
+            t.bytes += (uint32_t) len[k] * bpp[k];
+        }
+        t.offset[count] = t.bytes;
+        return t;
+    }
+
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+    /**
+     * @brief Encode wire bytes of strip K on, one loop per strip
+     * @param[out] slots PWM values
+     * @param[in] src Pixel buffer
+     * @param[in] byte First wire byte
+     * @param[in] stop Wire byte to stop at
+     * @return Wire byte reached
+     */
+    template <uint8_t K>
+    static uint16_t encode_from(volatile dma_siz *slots, const volatile uint8_t *src,
+                                uint16_t byte, uint16_t stop, At<K>)
+    {
+        using C = typename Nth<K, Strips...>::type::chip_type;
+        const uint16_t end = (table.offset[K + 1] < stop) ? table.offset[K + 1] : stop;
+
+        for (; byte < end; byte++)
+        {
+            uint8_t v = src[byte];
+            for (uint8_t i = 0; i < 8; i++, v <<= 1)
+                *slots++ = C::lo + (v >> 7) * (C::hi - C::lo);
+        }
+        return encode_from(slots, src, byte, stop, At<K + 1>());
+    }
+
+    static uint16_t encode_from(volatile dma_siz *, const volatile uint8_t *,
+                                uint16_t byte, uint16_t, At<sizeof...(Strips)>)
+    {
+        return byte;
+    }
+
+    /// #argb_encoder of the chain
+    static uint16_t encode(volatile dma_siz *slots, const volatile uint8_t *src, uint16_t byte, uint16_t bytes)
+    {
+        uint16_t stop = (bytes < table.bytes - byte) ? byte + bytes : table.bytes;
+
+        // skip strips sent already, slots go from the first byte on
+        return encode_from(slots, src, byte, stop, At<0>()) - byte;
+    }
+#endif
+
+public:
+    static constexpr Table table = make_table();     ///< Segment table of the chain
+    static constexpr uint32_t num_leds = table.leds; ///< LEDs in the chain
+
+    static_assert(count != 0, "Chain needs strips");
+    static_assert(count <= ARGB_MAX_SEGMENTS, "More strips than ARGB_MAX_SEGMENTS");
+    static_assert((table.leds <= 0xFFFF) && (table.bytes <= 0xFFFF), "Chain too long for 16-bit positions");
+    static_assert(table.timing_ok, "Chip timing out of tolerance at ARGB_BIT_RATE_HZ and timer clock");
+#if !ARGB_DYNAMIC_BUFFERS
+    static_assert(table.leds <= NUM_PIXELS, "Chain longer than NUM_LEDS buffers");
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+    static_assert(table.bytes <= ARGB_FRAME_BYTES, "Chain doesn't fit pixel buffer, define RGBW for RGBW strips");
+#endif
+#endif
+
+    /**
+     * @brief Strip in the chain
+     * @tparam K Strip index in Strips
+     * @return Strip object, positions are the strip's own
+     */
+    template <uint8_t K>
+    static constexpr StripAt<table.seg[K].start, table.offset[K], typename Nth<K, Strips...>::type> strip()
+    {
+        static_assert(K < count, "No such strip in the chain");
+        return {};
+    }
+
+#if ARGB_DYNAMIC_BUFFERS
+    /**
+     * @brief Start driver with the chain layout, buffers from caller's memory
+     * @param[in] arena Memory DMA can reach, argb_buf_size() bytes
+     * @param[in] size Arena size
+     * @return #argb_state enum
+     */
+    static argb_state init(void *arena, size_t size)
+    {
+        argb_state st = argb_init_arena(table.seg, count, arena, size);
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+        if (st == ARGB_OK)
+            argb_set_encoder(encoder());
+#endif
+        return st;
+    }
+#else
+    /**
+     * @brief Start driver with the chain layout
+     * @return #argb_state enum
+     */
+    static argb_state init()
+    {
+        argb_state st = argb_init_segments(table.seg, count);
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+        if (st == ARGB_OK)
+            argb_set_encoder(encoder());
+#endif
+        return st;
+    }
+#endif
+
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+    /**
+     * @brief Encoder of the chain, init() hands it to the driver
+     * @return #argb_encoder for argb_set_encoder()
+     */
+    static constexpr argb_encoder encoder()
+    {
+        return &encode;
+    }
+#endif
+
+    /**
+     * @brief Set global brightness
+     * @param[in] br Brightness [0..255], applies to next set calls
+     */
+    static void set_brightness(uint8_t br)
+    {
+        argb_set_brightness(br);
+    }
+
+    /**
+     * @brief Turn all LEDs off, doesn't send
+     */
+    static void clear()
+    {
+        argb_fill_rgb(0, 0, 0);
+        argb_fill_white(0); // RGBW strips even without RGBW defined
+    }
+
+    /**
+     * @brief Get transfer state
+     * @return #ARGB_READY or #ARGB_BUSY
+     */
+    static argb_state ready()
+    {
+        return argb_ready();
+    }
+
+    /**
+     * @brief Send pixel buffer to the chain
+     * @return #ARGB_OK, #ARGB_BUSY if previous frame is still going,
+     *         #ARGB_PARAM_ERR before init
+     */
+    static argb_state show()
+    {
+        return argb_show();
+    }
+};
+
+template <class... Strips>
+constexpr typename Chain<Strips...>::Table Chain<Strips...>::table;
+
+} // namespace argb
+
+/// @} @}
@@ -0,0 +1,277 @@
+/**
+ *******************************************
+ * @file    ARGB_bench.c
+ * @brief   On-target benchmark of ARGB Driver
+ *******************************************
+ *
+ * Times every pixel path and the DMA encoder with the port's realtime
+ * counter (DWT cycle counter on Cortex-M3 and higher) over several
+ * strip lengths. Results are printed as one JSON object, with the
+ * build configuration, so runs of RGB/RGBW/MIXED/DMA size builds can
+ * be stored and compared between releases.
+ *
+ * Noise functions are checked against golden values first, a port
+ * or compiler change that alters them shows as "noise_golden":false.
+ *
+ * Strip content is lost, strip is cleared when done.
+ */
+
+#include "ARGB_bench.h"
+#include "chprintf.h"
+#include "fast_math.h"
+
+#if !ARGB_USE_BENCH
+#error ARGB_bench.c needs ARGB_USE_BENCH set to 1
+#endif
+
+/**
+ * @addtogroup ARGB_Driver
+ * @{
+ */
+
+/**
+ * @addtogroup Private_entities
+ * @{
+ */
+
+/// Strip lengths of the length sweep, longer ones than NUM_PIXELS are skipped
+static const uint16_t bench_lengths[] = {1, 8, 32, 128, 512, NUM_PIXELS};
+
+/// Benchmark case: runs the measured path over n LEDs
+typedef void (*bench_fn)(uint16_t n);
+
+/// Results of one case
+typedef struct bench_res {
+    rtcnt_t best; ///< Fastest run, cycles
+    rtcnt_t avg;  ///< Average run, cycles
+} bench_res;
+
+static volatile uint8_t bench_sink; ///< Keeps conversions from being optimized out
+
+static void bench_set_rgb(uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+        argb_set_rgb(i, i, 255 - i, 0x55);
+}
+
+static void bench_set_hsv(uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+        argb_set_hsv(i, i, 255, 200);
+}
+
+static void bench_fill_rgb(uint16_t n)
+{
+    argb_fill_rgb_range(0, n - 1, 10, 20, 30);
+}
+
+static void bench_fill_hsv(uint16_t n)
+{
+    argb_fill_hsv_range(0, n - 1, 100, 255, 255);
+}
+
+static void bench_fill_white(uint16_t n)
+{
+    argb_fill_white_range(0, n - 1, 128);
+}
+
+static void bench_hsv2rgb(uint16_t n)
+{
+    rgb_t rgb;
+    for (uint16_t i = 0; i < n; i++)
+    {
+        hsv_t hsv = {.h = i, .s = 255 - i, .v = 200};
+        hsv2rgb_spectrum(hsv, &rgb);
+        bench_sink = rgb.r;
+    }
+}
+
+static void bench_rgb2hsv(uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+    {
+        rgb_t rgb = {.r = i, .g = 255 - i, .b = i * 3};
+        bench_sink = rgb2hsv_approximate(rgb).h;
+    }
+}
+
+static void bench_vnoise(uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+        bench_sink = vnoise8_3d(i * 24, 0x1234, 0x5678);
+}
+
+static void bench_gnoise(uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+        bench_sink = gnoise8_3d(i * 24, 0x1234, 0x5678);
+}
+
+static void bench_fill_noise(uint16_t n)
+{
+    const argb_noise nz = {ARGB_NOISE_GRADIENT, 3, 0, 24, 0x1234, 0x5678};
+    const hsv_t lo = {.h = 0, .s = 255, .v = 40}, hi = {.h = 40, .s = 255, .v = 255};
+    argb_fill_noise_hsv(0, n - 1, &nz, lo, hi);
+}
+
+static void bench_encode(uint16_t n)
+{
+    (void) n; // chain length is set by the caller
+    bench_sink = argb_bench_encode();
+}
+
+/// Measured cases, all cost per LED
+static const struct {
+    const char *name;
+    bench_fn fn;
+} bench_cases[] = {
+    {"argb_set_rgb",          bench_set_rgb},
+    {"argb_set_hsv",          bench_set_hsv},
+    {"argb_fill_rgb",         bench_fill_rgb},
+    {"argb_fill_hsv",         bench_fill_hsv},
+    {"argb_fill_white",       bench_fill_white},
+    {"hsv2rgb_spectrum",      bench_hsv2rgb},
+    {"rgb2hsv_approximate",   bench_rgb2hsv},
+    {"vnoise8_3d",            bench_vnoise},
+    {"gnoise8_3d",            bench_gnoise},
+    {"argb_fill_noise_hsv",   bench_fill_noise},
+    {"argb_encode",           bench_encode},
+};
+
+/// Noise golden values: x, y, z, then vnoise8 1D/2D/3D and gnoise8 1D/2D/3D
+static const uint16_t bench_noise_golden[][9] = {
+    {0x0000, 0x0000, 0x0000, 151,  17,  36, 128, 128, 128},
+    {0x0080, 0x0040, 0x0020, 155,  90,  72, 184,  65, 105},
+    {0x1234, 0x5678, 0x9ABC,  95, 150, 145, 192, 113, 144},
+    {0xFFFF, 0x8000, 0x0100, 151,  99,   1, 127, 128, 128},
+    {0x7F3A, 0x00C5, 0x4E21,  62, 153,  63, 117, 104, 149},
+};
+
+/**
+ * @brief Check noise functions against golden values
+ * @return true if all match
+ */
+static bool bench_noise_check(void)
+{
+    for (uint8_t k = 0; k < sizeof(bench_noise_golden) / sizeof(bench_noise_golden[0]); k++)
+    {
+        const uint16_t *g = bench_noise_golden[k];
+        uint8_t got[6] = {
+            vnoise8(g[0]), vnoise8_2d(g[0], g[1]), vnoise8_3d(g[0], g[1], g[2]),
+            gnoise8(g[0]), gnoise8_2d(g[0], g[1]), gnoise8_3d(g[0], g[1], g[2]),
+        };
+
+        for (uint8_t f = 0; f < 6; f++)
+        {
+            if (got[f] != g[3 + f])
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Time one case
+ * @param[in] fn Case to run
+ * @param[in] n LED quantity
+ * @return Best and average cycles
+ */
+static bench_res bench_time(bench_fn fn, uint16_t n)
+{
+    bench_res res = {.best = (rtcnt_t) -1, .avg = 0};
+    uint32_t total = 0;
+
+    for (uint8_t r = 0; r < ARGB_BENCH_REPEAT; r++)
+    {
+        rtcnt_t start = chSysGetRealtimeCounterX();
+        fn(n);
+        rtcnt_t cycles = chSysGetRealtimeCounterX() - start;
+
+        total += cycles;
+        if (cycles < res.best)
+            res.best = cycles;
+    }
+    res.avg = total / ARGB_BENCH_REPEAT;
+    return res;
+}
+
+/**
+ * @brief Set single-segment chain of n LEDs of the build's default type
+ * @param[in] n LED quantity
+ * @return #argb_state enum
+ */
+static argb_state bench_chain(uint16_t n)
+{
+#if defined(WS2812)
+    argb_segment seg = {0, n, ARGB_ORDER_GRB, 3, ARGB_CHIP_WS2812};
+#elif defined(SK6812)
+    argb_segment seg = {0, n, ARGB_ORDER_RGB, 3, ARGB_CHIP_SK6812};
+#elif defined(WS2811S)
+    argb_segment seg = {0, n, ARGB_ORDER_RGB, 3, ARGB_CHIP_WS2811S};
+#else
+    argb_segment seg = {0, n, ARGB_ORDER_RGB, 3, ARGB_CHIP_WS2811F};
+#endif
+#if defined(RGBW)
+    seg.bpp = 4;
+#endif
+    return argb_init_segments(&seg, 1);
+}
+
+/** @} */ // Private
+
+/**
+ * @brief Run all benchmark cases and print JSON
+ * @param[in] out Stream for results, e.g. serial port
+ * @note Strip has to be idle, chain layout is restored by argb_init()
+ */
+void argb_bench_run(BaseSequentialStream *out)
+{
+    bool first = true;
+
+    while (argb_ready() != ARGB_READY);
+
+    chprintf(out, "{\"bench\":\"argb\",\"config\":{");
+    chprintf(out, "\"num_pixels\":%u,\"bit_rate\":%u,\"rgbw\":%s,\"mixed\":%s,",
+             (unsigned) NUM_PIXELS, (unsigned) ARGB_BIT_RATE_HZ,
+#if defined(RGBW)
+             "true",
+#else
+             "false",
+#endif
+#if defined(MIXED_RGB_GRB)
+             "true");
+#else
+             "false");
+#endif
+#if defined(DMA_SIZE_BYTE)
+    chprintf(out, "\"dma_size\":1,");
+#elif defined(DMA_SIZE_HWORD)
+    chprintf(out, "\"dma_size\":2,");
+#else
+    chprintf(out, "\"dma_size\":4,");
+#endif
+    chprintf(out, "\"power_limit\":%s,\"repeat\":%u},\"noise_golden\":%s,\"results\":[",
+             ARGB_USE_POWER_LIMIT ? "true" : "false", (unsigned) ARGB_BENCH_REPEAT,
+             bench_noise_check() ? "true" : "false");
+
+    for (uint8_t l = 0; l < sizeof(bench_lengths) / sizeof(bench_lengths[0]); l++)
+    {
+        uint16_t n = bench_lengths[l];
+
+        if ((n > NUM_PIXELS) || (bench_chain(n) != ARGB_OK))
+            continue;
+        for (uint8_t c = 0; c < sizeof(bench_cases) / sizeof(bench_cases[0]); c++)
+        {
+            bench_res res = bench_time(bench_cases[c].fn, n);
+            chprintf(out, "%s{\"name\":\"%s\",\"leds\":%u,\"best\":%u,\"avg\":%u,\"best_per_led\":%u}",
+                     first ? "" : ",", bench_cases[c].name, (unsigned) n,
+                     (unsigned) res.best, (unsigned) res.avg, (unsigned) (res.best / n));
+            first = false;
+        }
+    }
+    chprintf(out, "]}\r\n");
+
+    argb_init(); // back to configured layout, strip is cleared
+}
+
+/** @} */ // Driver
@@ -0,0 +1,28 @@
+/**
+ *******************************************
+ * @file    ARGB_bench.h
+ * @brief   On-target benchmark of ARGB Driver
+ *******************************************
+ *
+ * @note Needs ARGB_USE_BENCH set to 1
+ */
+
+#pragma once
+
+#include "ARGB.h"
+
+/**
+ * @addtogroup ARGB_Driver
+ * @{
+ * @addtogroup Benchmark
+ * @brief Cycle counts of pixel and encode paths as JSON
+ * @{
+ */
+
+#if !defined(ARGB_BENCH_REPEAT)
+#define ARGB_BENCH_REPEAT 8 ///< Runs of every case, best and average are reported
+#endif
+
+void argb_bench_run(BaseSequentialStream *out); // Run all cases, print JSON
+
+/// @} @}
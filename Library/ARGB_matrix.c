@@ -0,0 +1,317 @@
+/**
+ *******************************************
+ * @file    ARGB_matrix.c
+ * @brief   2D matrix layer of ARGB Driver
+ *******************************************
+ *
+ * XY table holds LED index of every cell in display order (after
+ * rotation), so drawing never repeats the layout math. Rectangles
+ * and scrolling look for runs of neighbour LEDs in the table and
+ * hand them to #argb_fill_rgb_range / #argb_move as a whole, so
+ * serpentine rows cost the same as straight ones. Runs break only
+ * where the wiring does (tile edges, rotated panels, serpentine rows
+ * moved across parity), there the work falls back to single LEDs.
+ */
+
+#include "ARGB_matrix.h"
+
+/**
+ * @addtogroup ARGB_Driver
+ * @{
+ */
+
+/**
+ * @addtogroup Private_entities
+ * @{
+ */
+
+static uint16_t xy_table[ARGB_MATRIX_MAX_CELLS]; ///< LED index of cells, row by row
+static uint8_t xy_width = 0;  ///< Display width
+static uint8_t xy_height = 0; ///< Display height
+
+static void matrix_fill_line(const uint16_t *line, uint8_t n, uint8_t r, uint8_t g, uint8_t b);
+static void matrix_move_line(const uint16_t *dst, const uint16_t *src, uint8_t n, int8_t dir);
+/// @} //Private
+
+/**
+ * @brief Build XY table of the matrix
+ * @param[in] layout Panel layout
+ * @return #ARGB_OK or #ARGB_PARAM_ERR if layout doesn't fit
+ */
+argb_state argb_matrix_init(const argb_matrix_layout *layout)
+{
+    const uint16_t pw = (uint16_t) layout->width * layout->tiles_x;  // physical size
+    const uint16_t ph = (uint16_t) layout->height * layout->tiles_y;
+    const uint16_t tile = (uint16_t) layout->width * layout->height;
+    const bool swap = (layout->rotation == ARGB_ROT_90) || (layout->rotation == ARGB_ROT_270);
+
+    if ((pw == 0) || (ph == 0) || (pw > 255) || (ph > 255) ||
+        ((uint32_t) pw * ph > ARGB_MATRIX_MAX_CELLS) ||
+        ((uint32_t) layout->first + (uint32_t) pw * ph > argb_get_num_leds()) ||
+        ((uint8_t) layout->rotation > ARGB_ROT_270))
+        return ARGB_PARAM_ERR;
+
+    xy_width = swap ? ph : pw;
+    xy_height = swap ? pw : ph;
+
+    uint16_t *cell = xy_table;
+    for (uint16_t y = 0; y < xy_height; y++)
+    {
+        for (uint16_t x = 0; x < xy_width; x++)
+        {
+            // display to physical coordinates
+            uint16_t px, py;
+            switch (layout->rotation)
+            {
+                case ARGB_ROT_90:  px = y;          py = ph - 1 - x; break;
+                case ARGB_ROT_180: px = pw - 1 - x; py = ph - 1 - y; break;
+                case ARGB_ROT_270: px = pw - 1 - y; py = x;          break;
+                default:           px = x;          py = y;          break;
+            }
+
+            // physical coordinates to chain position
+            uint16_t tx = px / layout->width, lx = px % layout->width;
+            uint16_t ty = py / layout->height, ly = py % layout->height;
+            if (layout->serpentine && (ly & 1))
+                lx = layout->width - 1 - lx;
+            *cell++ = layout->first + (ty * layout->tiles_x + tx) * tile + ly * layout->width + lx;
+        }
+    }
+    return ARGB_OK;
+}
+
+/**
+ * @brief Get matrix width
+ * @return Cells in a row, after rotation
+ */
+uint8_t argb_matrix_width(void)
+{
+    return xy_width;
+}
+
+/**
+ * @brief Get matrix height
+ * @return Cells in a column, after rotation
+ */
+uint8_t argb_matrix_height(void)
+{
+    return xy_height;
+}
+
+/**
+ * @brief Get LED index of a cell
+ * @param[in] x Column, from left
+ * @param[in] y Row, from top
+ * @return Chain position or #ARGB_XY_NONE
+ */
+uint16_t argb_xy(uint8_t x, uint8_t y)
+{
+    if ((x >= xy_width) || (y >= xy_height))
+        return ARGB_XY_NONE;
+    return xy_table[(uint16_t) y * xy_width + x];
+}
+
+/**
+ * @brief Set cell with RGB color
+ * @param[in] x Column, from left
+ * @param[in] y Row, from top
+ * @param[in] r Red component   [0..255]
+ * @param[in] g Green component [0..255]
+ * @param[in] b Blue component  [0..255]
+ */
+void argb_set_xy(uint8_t x, uint8_t y, uint8_t r, uint8_t g, uint8_t b)
+{
+    if ((x >= xy_width) || (y >= xy_height))
+        return;
+    argb_set_rgb(xy_table[(uint16_t) y * xy_width + x], r, g, b);
+}
+
+/**
+ * @brief Fill rectangle with RGB color
+ * @param[in] x Left column
+ * @param[in] y Top row
+ * @param[in] w Width, cut at matrix edge
+ * @param[in] h Height, cut at matrix edge
+ * @param[in] r Red component   [0..255]
+ * @param[in] g Green component [0..255]
+ * @param[in] b Blue component  [0..255]
+ */
+void argb_fill_rect(uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint8_t r, uint8_t g, uint8_t b)
+{
+    if ((x >= xy_width) || (y >= xy_height))
+        return;
+    if (w > xy_width - x)
+        w = xy_width - x;
+    if (h > xy_height - y)
+        h = xy_height - y;
+
+    for (const uint16_t *line = &xy_table[(uint16_t) y * xy_width + x]; h != 0; h--, line += xy_width)
+        matrix_fill_line(line, w, r, g, b);
+}
+
+/**
+ * @brief Draw colors along a row
+ * @param[in] x First column
+ * @param[in] y Row
+ * @param[in] count Cells, cut at matrix edge
+ * @param[in] src Colors, count entries
+ */
+void argb_blit_row(uint8_t x, uint8_t y, uint8_t count, const rgb_t *src)
+{
+    if ((x >= xy_width) || (y >= xy_height))
+        return;
+    if (count > xy_width - x)
+        count = xy_width - x;
+
+    const uint16_t *cell = &xy_table[(uint16_t) y * xy_width + x];
+    for (; count != 0; count--, cell++, src++)
+        argb_set_rgb(*cell, src->r, src->g, src->b);
+}
+
+/**
+ * @brief Draw colors along a column
+ * @param[in] x Column
+ * @param[in] y First row
+ * @param[in] count Cells, cut at matrix edge
+ * @param[in] src Colors, count entries
+ */
+void argb_blit_col(uint8_t x, uint8_t y, uint8_t count, const rgb_t *src)
+{
+    if ((x >= xy_width) || (y >= xy_height))
+        return;
+    if (count > xy_height - y)
+        count = xy_height - y;
+
+    const uint16_t *cell = &xy_table[(uint16_t) y * xy_width + x];
+    for (; count != 0; count--, cell += xy_width, src++)
+        argb_set_rgb(*cell, src->r, src->g, src->b);
+}
+
+/**
+ * @brief Shift the picture, fill freed cells with RGB color
+ * @param[in] dx Columns to shift, positive - right
+ * @param[in] dy Rows to shift, positive - down
+ * @param[in] r Red component   [0..255]
+ * @param[in] g Green component [0..255]
+ * @param[in] b Blue component  [0..255]
+ * @note Stored colors are moved, brightness is not applied twice
+ */
+void argb_matrix_scroll(int8_t dx, int8_t dy, uint8_t r, uint8_t g, uint8_t b)
+{
+    const uint8_t w = xy_width, h = xy_height;
+    const uint8_t mx = (dx < 0) ? -dx : dx;
+    const uint8_t my = (dy < 0) ? -dy : dy;
+
+    if ((mx >= w) || (my >= h))
+    {
+        argb_fill_rect(0, 0, w, h, r, g, b);
+        return;
+    }
+
+    if (mx != 0)
+    {
+        // every row moves inside itself, go away from the overlap
+        for (uint16_t *row = xy_table; row < &xy_table[(uint16_t) w * h]; row += w)
+        {
+            if (dx > 0)
+                matrix_move_line(&row[mx], &row[0], w - mx, -1);
+            else
+                matrix_move_line(&row[0], &row[mx], w - mx, 1);
+        }
+        argb_fill_rect((dx > 0) ? 0 : w - mx, 0, mx, h, r, g, b);
+    }
+
+    if (my != 0)
+    {
+        // whole rows, rows don't overlap, only their order matters
+        if (dy > 0)
+        {
+            for (uint8_t y = h - 1; y >= my; y--)
+                matrix_move_line(&xy_table[(uint16_t) y * w], &xy_table[(uint16_t) (y - my) * w], w, 1);
+        }
+        else
+        {
+            for (uint8_t y = 0; y < h - my; y++)
+                matrix_move_line(&xy_table[(uint16_t) y * w], &xy_table[(uint16_t) (y + my) * w], w, 1);
+        }
+        argb_fill_rect(0, (dy > 0) ? 0 : h - my, w, my, r, g, b);
+    }
+}
+
+/**
+ * @addtogroup Private_entities
+ * @{ */
+
+/**
+ * @brief Fill table cells, neighbour LEDs at once
+ * @param[in] line First cell
+ * @param[in] n Cells
+ * @param[in] r Red component   [0..255]
+ * @param[in] g Green component [0..255]
+ * @param[in] b Blue component  [0..255]
+ */
+static void matrix_fill_line(const uint16_t *line, uint8_t n, uint8_t r, uint8_t g, uint8_t b)
+{
+    uint8_t k = 0;
+
+    while (k < n)
+    {
+        uint8_t end = k;
+        int16_t step = 0;
+
+        // run: LEDs go one by one in the same direction
+        while (end + 1 < n)
+        {
+            int16_t ds = line[end + 1] - line[end];
+            if (((ds != 1) && (ds != -1)) || ((step != 0) && (ds != step)))
+                break;
+            step = ds;
+            end++;
+        }
+
+        if (line[k] < line[end])
+            argb_fill_rgb_range(line[k], line[end], r, g, b);
+        else
+            argb_fill_rgb_range(line[end], line[k], r, g, b);
+        k = end + 1;
+    }
+}
+
+/**
+ * @brief Copy table cells, neighbour LEDs as one span
+ * @param[in] dst Destination cells
+ * @param[in] src Source cells
+ * @param[in] n Cells
+ * @param[in] dir 1 - first to last, -1 - last to first
+ */
+static void matrix_move_line(const uint16_t *dst, const uint16_t *src, uint8_t n, int8_t dir)
+{
+    int16_t k = (dir > 0) ? 0 : n - 1;
+
+    while ((k >= 0) && (k < n))
+    {
+        int16_t end = k;
+        int16_t step = 0;
+
+        // run: both sides go one LED per cell in the same direction
+        while ((end + dir >= 0) && (end + dir < n))
+        {
+            int16_t ds = dst[end + dir] - dst[end];
+            if (((ds != 1) && (ds != -1)) || (src[end + dir] - src[end] != ds) ||
+                ((step != 0) && (ds != step)))
+                break;
+            step = ds;
+            end += dir;
+        }
+
+        const int16_t a = (k < end) ? k : end;
+        const int16_t z = (k < end) ? end : k;
+        const uint16_t d = (dst[a] < dst[z]) ? dst[a] : dst[z];
+        const uint16_t s = (src[a] < src[z]) ? src[a] : src[z];
+        argb_move(d, s, z - a + 1);
+        k = end + dir;
+    }
+}
+/// @} //Private
+
+/// @} //Driver
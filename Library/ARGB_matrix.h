@@ -0,0 +1,68 @@
+/**
+ *******************************************
+ * @file    ARGB_matrix.h
+ * @brief   2D matrix layer of ARGB Driver
+ *******************************************
+ *
+ * Panel layout is described once, XY to LED index table is built by
+ * #argb_matrix_init. Drawing goes through the ARGB Driver setters,
+ * scrolling moves LED spans inside the pixel buffer.
+ */
+
+#pragma once
+
+#include "ARGB.h"
+
+/**
+ * @addtogroup ARGB_Driver
+ * @{
+ * @addtogroup Matrix
+ * @brief XY mapping of serpentine, rotated and tiled panels
+ * @{
+ */
+
+#if !defined(ARGB_MATRIX_MAX_CELLS)
+#define ARGB_MATRIX_MAX_CELLS NUM_PIXELS ///< Capacity of the XY table, 2 bytes per cell
+#endif
+
+#define ARGB_XY_NONE 0xFFFF ///< Index of a cell outside the matrix
+
+/**
+ * @enum argb_rotation
+ * @brief Matrix rotation, clockwise
+ */
+typedef enum argb_rotation {
+    ARGB_ROT_0 = 0,
+    ARGB_ROT_90 = 1,
+    ARGB_ROT_180 = 2,
+    ARGB_ROT_270 = 3,
+} argb_rotation;
+
+/**
+ * @struct argb_matrix_layout
+ * @brief Physical layout of the matrix
+ * @note Tiles are identical panels chained row by row,
+ *       LEDs inside a tile go row by row from top left corner
+ */
+typedef struct argb_matrix_layout {
+    uint16_t first;          ///< Chain position of the first LED
+    uint8_t width;           ///< Tile width, LEDs
+    uint8_t height;          ///< Tile height, LEDs
+    uint8_t tiles_x;         ///< Tiles in a row
+    uint8_t tiles_y;         ///< Tile rows
+    bool serpentine;         ///< Every odd row of a tile goes right to left
+    argb_rotation rotation;  ///< Rotation of the whole matrix
+} argb_matrix_layout;
+
+argb_state argb_matrix_init(const argb_matrix_layout *layout); // Build XY table
+uint8_t argb_matrix_width(void);  // Width after rotation
+uint8_t argb_matrix_height(void); // Height after rotation
+uint16_t argb_xy(uint8_t x, uint8_t y); // LED index of a cell
+
+void argb_set_xy(uint8_t x, uint8_t y, uint8_t r, uint8_t g, uint8_t b); // Set single cell by RGB
+void argb_fill_rect(uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint8_t r, uint8_t g, uint8_t b);
+void argb_blit_row(uint8_t x, uint8_t y, uint8_t count, const rgb_t *src); // Draw colors along a row
+void argb_blit_col(uint8_t x, uint8_t y, uint8_t count, const rgb_t *src); // Draw colors along a column
+void argb_matrix_scroll(int8_t dx, int8_t dy, uint8_t r, uint8_t g, uint8_t b); // Shift picture, fill gap
+
+/// @} @}
@@ -0,0 +1,116 @@
+/**
+ *******************************************
+ * @file    ARGB_rle.c
+ * @brief   Run-length / delta compressed animations for ARGB Driver
+ *******************************************
+ *
+ * Frames are decoded straight into the pixel buffer: runs and
+ * literals are written, skipped LEDs keep the previous frame, so the
+ * work is proportional to the compressed size. Frame 0 must not
+ * skip, the player goes back to it after the last frame.
+ */
+
+#include "ARGB_rle.h"
+
+/**
+ * @addtogroup ARGB_Driver
+ * @{
+ */
+
+/**
+ * @brief Decode one frame into pixel buffer
+ * @param[in] frame First op of the frame
+ * @param[in] len Bytes available
+ * @param[in] first LED of the frame start
+ * @param[in] leds LEDs in a frame, ops past it are an error
+ * @return Frame size with #ARGB_RLE_END, 0 if frame is broken
+ * @note Broken frames may be partly written
+ */
+size_t argb_rle_decode(const uint8_t *frame, size_t len, uint16_t first, uint16_t leds)
+{
+    const uint8_t *p = frame;
+    const uint8_t *end = frame + len;
+    uint16_t led = 0;
+
+    while (p < end)
+    {
+        const uint8_t op = *p++;
+        const uint8_t n = (op & 0x3F) + 1;
+
+        if (op == ARGB_RLE_END)
+            return p - frame;
+        if ((op >= 0xC0) || (n > leds - led))
+            return 0;
+
+        switch (op & 0xC0)
+        {
+            case ARGB_RLE_RUN:
+                if (end - p < 3)
+                    return 0;
+                for (uint8_t k = 0; k < n; k++)
+                    argb_write_rgb(first + led + k, p, 1);
+                p += 3;
+                break;
+            case ARGB_RLE_LITERAL:
+                if (end - p < 3 * n)
+                    return 0;
+                argb_write_rgb(first + led, p, n);
+                p += 3 * n;
+                break;
+            default: // skip
+                break;
+        }
+        led += n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Check animation header and rewind player
+ * @param[out] anim Player
+ * @param[in] data Animation, header included
+ * @param[in] len Animation size
+ * @param[in] first LED of the animation start
+ * @return #ARGB_OK or #ARGB_PARAM_ERR if header is wrong
+ */
+argb_state argb_rle_open(argb_rle_anim *anim, const uint8_t *data, size_t len, uint16_t first)
+{
+    if ((len < ARGB_RLE_HEADER) || (data[0] != 'A') || (data[1] != 'R') ||
+        (data[2] != 'L') || (data[3] != '1'))
+        return ARGB_PARAM_ERR;
+
+    anim->data = data;
+    anim->len = len;
+    anim->pos = ARGB_RLE_HEADER;
+    anim->first = first;
+    anim->leds = data[4] | (data[5] << 8);
+    anim->frames = data[6] | (data[7] << 8);
+    anim->frame = 0;
+    return (anim->frames != 0) ? ARGB_OK : ARGB_PARAM_ERR;
+}
+
+/**
+ * @brief Decode next frame into pixel buffer
+ * @param[in,out] anim Player
+ * @return #ARGB_OK or #ARGB_PARAM_ERR if frame is broken
+ * @note Call #argb_show after it
+ */
+argb_state argb_rle_next(argb_rle_anim *anim)
+{
+    if (anim->frame == anim->frames)
+    {
+        anim->frame = 0;
+        anim->pos = ARGB_RLE_HEADER;
+    }
+
+    size_t n = argb_rle_decode(&anim->data[anim->pos], anim->len - anim->pos,
+                               anim->first, anim->leds);
+    if (n == 0)
+        return ARGB_PARAM_ERR;
+
+    anim->pos += n;
+    anim->frame++;
+    return ARGB_OK;
+}
+
+/// @} //Driver
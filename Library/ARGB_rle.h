@@ -0,0 +1,59 @@
+/**
+ *******************************************
+ * @file    ARGB_rle.h
+ * @brief   Run-length / delta compressed animations for ARGB Driver
+ *******************************************
+ *
+ * Animation layout (little endian):
+ * - header: 'A' 'R' 'L' '1', LED count (u16), frame count (u16)
+ * - frames, each one is a list of ops ended by #ARGB_RLE_END:
+ *   | Op byte     | Meaning                                  |
+ *   |-------------|------------------------------------------|
+ *   | 0x00..0x3F  | RUN: op + 1 LEDs of next R, G, B         |
+ *   | 0x40..0x7F  | LITERAL: (op & 0x3F) + 1 LEDs, R, G, B each |
+ *   | 0x80..0xBF  | SKIP: (op & 0x3F) + 1 LEDs kept from last frame |
+ *   | 0xFF        | END of frame                             |
+ *
+ * Colors are stored ready for the wire, Tools/argb_rle.py makes the
+ * files from raw frames.
+ */
+
+#pragma once
+
+#include "ARGB.h"
+
+/**
+ * @addtogroup ARGB_Driver
+ * @{
+ * @addtogroup RLE
+ * @brief Compressed animation playback
+ * @{
+ */
+
+#define ARGB_RLE_RUN     0x00 ///< Run op, low 6 bits - length - 1
+#define ARGB_RLE_LITERAL 0x40 ///< Literal op, low 6 bits - length - 1
+#define ARGB_RLE_SKIP    0x80 ///< Skip op, low 6 bits - length - 1
+#define ARGB_RLE_END     0xFF ///< Frame end
+#define ARGB_RLE_MAX_LEN 64   ///< LEDs per op
+
+#define ARGB_RLE_HEADER  8    ///< Header size, bytes
+
+/**
+ * @struct argb_rle_anim
+ * @brief Animation player
+ */
+typedef struct argb_rle_anim {
+    const uint8_t *data; ///< Whole animation, header included
+    size_t len;          ///< Animation size
+    size_t pos;          ///< Next frame offset
+    uint16_t first;      ///< LED of the animation start
+    uint16_t leds;       ///< LEDs in a frame
+    uint16_t frames;     ///< Frames in the animation
+    uint16_t frame;      ///< Next frame number
+} argb_rle_anim;
+
+size_t argb_rle_decode(const uint8_t *frame, size_t len, uint16_t first, uint16_t leds); // Decode one frame
+argb_state argb_rle_open(argb_rle_anim *anim, const uint8_t *data, size_t len, uint16_t first);
+argb_state argb_rle_next(argb_rle_anim *anim); // Decode next frame, wraps around
+
+/// @} @}
@@ -0,0 +1,287 @@
+/**
+ *******************************************
+ * @file    ARGB_stream.c
+ * @brief   Adalight / TPM2 frame receiver for ARGB Driver
+ *******************************************
+ *
+ * Both protocols are recognised by their header, so one port serves
+ * either host software:
+ * - Adalight: 'A' 'd' 'a' hi lo chk, then (hi << 8 | lo) + 1 LEDs as
+ *   R, G, B; chk = hi ^ lo ^ 0x55
+ * - TPM2: 0xC9 type hi lo, (hi << 8 | lo) payload bytes, 0x36;
+ *   only data frames (type 0xDA) change LEDs
+ *
+ * Payload goes to #argb_write_rgb straight from the caller's buffer,
+ * only an LED split between two chunks is kept aside. Values are
+ * not corrected, hosts send them ready for the wire. If the strip
+ * is still busy when a frame ends, the show is retried by the next
+ * feed or poll.
+ */
+
+#include "ARGB_stream.h"
+
+/**
+ * @addtogroup ARGB_Driver
+ * @{
+ */
+
+/**
+ * @addtogroup Private_entities
+ * @{
+ */
+
+#define TPM2_START 0xC9 ///< TPM2 frame start
+#define TPM2_DATA  0xDA ///< TPM2 data frame type
+#define TPM2_CMD   0xC0 ///< TPM2 command frame type
+#define TPM2_ACK   0xAA ///< TPM2 answer frame type
+#define TPM2_END   0x36 ///< TPM2 frame end
+
+/// Receiver state
+typedef enum stream_state {
+    ST_IDLE = 0,  ///< Looking for a header
+    ST_ADA_D,     ///< Adalight 'd'
+    ST_ADA_A,     ///< Adalight 'a'
+    ST_ADA_HI,    ///< Adalight LED count, high byte
+    ST_ADA_LO,    ///< Adalight LED count, low byte
+    ST_ADA_CHK,   ///< Adalight checksum
+    ST_TPM_TYPE,  ///< TPM2 frame type
+    ST_TPM_HI,    ///< TPM2 payload size, high byte
+    ST_TPM_LO,    ///< TPM2 payload size, low byte
+    ST_DATA,      ///< LED payload
+    ST_SKIP,      ///< TPM2 payload of other frame types
+    ST_TPM_END,   ///< TPM2 frame end
+} stream_state;
+
+static stream_state st = ST_IDLE;
+static bool st_tpm = false;    ///< Current frame is TPM2
+static uint8_t st_hi = 0;      ///< Size high byte
+static uint32_t st_left = 0;   ///< Payload bytes left
+static uint16_t st_first = 0;  ///< LED of the first payload byte
+static uint16_t st_led = 0;    ///< Next LED to write
+static uint16_t st_room = 0;   ///< LEDs left in the chain from #st_led
+static uint8_t st_part[3];     ///< LED split between chunks
+static uint8_t st_part_n = 0;
+static bool st_show = false;   ///< Frame is waiting for the strip
+static argb_stream_stats st_stats;
+
+static void stream_frame_start(void);
+static void stream_payload(const uint8_t *p, size_t n);
+static void stream_frame_end(void);
+/// @} //Private
+
+/**
+ * @brief Reset receiver
+ * @param[in] first LED of the first payload byte
+ */
+void argb_stream_init(uint16_t first)
+{
+    st = ST_IDLE;
+    st_first = first;
+    st_part_n = 0;
+    st_show = false;
+    st_stats = (argb_stream_stats) {0};
+}
+
+/**
+ * @brief Parse received bytes
+ * @param[in] buf Bytes
+ * @param[in] n Byte quantity
+ */
+void argb_stream_feed(const uint8_t *buf, size_t n)
+{
+    if (st_show && (argb_show() == ARGB_OK))
+        st_show = false;
+
+    while (n != 0)
+    {
+        // payload is taken in one piece
+        if ((st == ST_DATA) || (st == ST_SKIP))
+        {
+            size_t m = (n < st_left) ? n : st_left;
+            if (st == ST_DATA)
+                stream_payload(buf, m);
+            buf += m;
+            n -= m;
+            st_left -= m;
+            if (st_left == 0)
+            {
+                if (st_tpm)
+                    st = ST_TPM_END;
+                else
+                    stream_frame_end();
+            }
+            continue;
+        }
+
+        uint8_t c = *buf++;
+        n--;
+        switch (st)
+        {
+            case ST_IDLE:
+                if (c == 'A')
+                    st = ST_ADA_D;
+                else if (c == TPM2_START)
+                    st = ST_TPM_TYPE;
+                else
+                    st_stats.skipped++;
+                break;
+            case ST_ADA_D:
+                if (c != 'A')
+                    st = (c == 'd') ? ST_ADA_A : ST_IDLE;
+                break;
+            case ST_ADA_A:
+                st = (c == 'a') ? ST_ADA_HI : ST_IDLE;
+                break;
+            case ST_ADA_HI:
+                st_hi = c;
+                st = ST_ADA_LO;
+                break;
+            case ST_ADA_LO:
+                st_left = (((uint32_t) st_hi << 8) | c) + 1;
+                st_hi ^= c ^ 0x55; // expected checksum
+                st = ST_ADA_CHK;
+                break;
+            case ST_ADA_CHK:
+                if (c != st_hi)
+                {
+                    st_stats.errors++;
+                    st = ST_IDLE;
+                    break;
+                }
+                st_left *= 3;
+                st_tpm = false;
+                stream_frame_start();
+                st = ST_DATA;
+                break;
+            case ST_TPM_TYPE:
+                // unknown type - start byte was noise, resync
+                if ((c != TPM2_DATA) && (c != TPM2_CMD) && (c != TPM2_ACK))
+                {
+                    st_stats.skipped++;
+                    if (c != TPM2_START)
+                        st = ST_IDLE;
+                    break;
+                }
+                st_tpm = true;
+                st_hi = c; // type until size comes
+                st = ST_TPM_HI;
+                break;
+            case ST_TPM_HI:
+                st_left = (uint32_t) c << 8;
+                st = ST_TPM_LO;
+                break;
+            case ST_TPM_LO:
+                st_left |= c;
+                stream_frame_start();
+                if (st_left == 0)
+                    st = ST_TPM_END;
+                else
+                    st = (st_hi == TPM2_DATA) ? ST_DATA : ST_SKIP;
+                break;
+            case ST_TPM_END:
+                if (c != TPM2_END)
+                    st_stats.errors++;
+                else if (st_hi == TPM2_DATA)
+                    stream_frame_end();
+                st = ST_IDLE;
+                break;
+            default:
+                st = ST_IDLE;
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Read channel once and parse received bytes
+ * @param[in] chn Serial port or USB CDC channel
+ * @param[in] timeout Read timeout
+ */
+void argb_stream_poll(BaseChannel *chn, sysinterval_t timeout)
+{
+    uint8_t buf[ARGB_STREAM_CHUNK];
+
+    argb_stream_feed(buf, chnReadTimeout(chn, buf, sizeof(buf), timeout));
+}
+
+/**
+ * @brief Get receiver counters
+ * @return Counters
+ */
+const argb_stream_stats *argb_stream_get_stats(void)
+{
+    return &st_stats;
+}
+
+/**
+ * @addtogroup Private_entities
+ * @{ */
+
+/**
+ * @brief Set up payload of a new frame
+ * @note LEDs past the chain end are dropped, the count in the header
+ *       may be anything up to 65536
+ */
+static void stream_frame_start(void)
+{
+    uint16_t leds = argb_get_num_leds();
+
+    st_led = st_first;
+    st_room = (leds > st_first) ? leds - st_first : 0;
+    st_part_n = 0;
+}
+
+/**
+ * @brief Write payload bytes into pixel buffer
+ * @param[in] p Bytes
+ * @param[in] n Byte quantity
+ */
+static void stream_payload(const uint8_t *p, size_t n)
+{
+    // finish LED split by the previous chunk
+    if (st_part_n != 0)
+    {
+        while ((st_part_n < 3) && (n != 0))
+        {
+            st_part[st_part_n++] = *p++;
+            n--;
+        }
+        if (st_part_n < 3)
+            return;
+        if (st_room != 0)
+        {
+            argb_write_rgb(st_led++, st_part, 1);
+            st_room--;
+        }
+        st_part_n = 0;
+    }
+
+    // whole LEDs right from the chunk
+    size_t leds = n / 3;
+    if (leds != 0)
+    {
+        uint16_t m = (leds < st_room) ? leds : st_room;
+        if (m != 0)
+            argb_write_rgb(st_led, p, m);
+        st_led += m;
+        st_room -= m;
+        p += leds * 3;
+        n -= leds * 3;
+    }
+
+    while (n-- != 0)
+        st_part[st_part_n++] = *p++;
+}
+
+/**
+ * @brief Show complete frame or leave it for later
+ */
+static void stream_frame_end(void)
+{
+    st_stats.frames++;
+    st_show = (argb_show() != ARGB_OK);
+    st = ST_IDLE;
+}
+/// @} //Private
+
+/// @} //Driver
@@ -0,0 +1,43 @@
+/**
+ *******************************************
+ * @file    ARGB_stream.h
+ * @brief   Adalight / TPM2 frame receiver for ARGB Driver
+ *******************************************
+ *
+ * Bytes can come in chunks of any size, LED data is written into
+ * the pixel buffer as it arrives and the strip is shown when a
+ * frame is complete.
+ */
+
+#pragma once
+
+#include "ARGB.h"
+
+/**
+ * @addtogroup ARGB_Driver
+ * @{
+ * @addtogroup Stream
+ * @brief Streaming frame input from a host
+ * @{
+ */
+
+#if !defined(ARGB_STREAM_CHUNK)
+#define ARGB_STREAM_CHUNK 64 ///< Bytes read from a channel at once
+#endif
+
+/**
+ * @struct argb_stream_stats
+ * @brief Receiver counters
+ */
+typedef struct argb_stream_stats {
+    uint32_t frames;  ///< Complete frames
+    uint32_t errors;  ///< Bad header checksum or frame end
+    uint32_t skipped; ///< Bytes dropped while looking for a header
+} argb_stream_stats;
+
+void argb_stream_init(uint16_t first); // Reset receiver, frames start at LED first
+void argb_stream_feed(const uint8_t *buf, size_t n); // Parse received bytes
+void argb_stream_poll(BaseChannel *chn, sysinterval_t timeout); // Read channel once and parse
+const argb_stream_stats *argb_stream_get_stats(void);
+
+/// @} @}
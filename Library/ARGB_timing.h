@@ -0,0 +1,152 @@
+/**
+ *******************************************
+ * @file    ARGB_timing.h
+ * @brief   Timing and current profiles of supported LED chips
+ *******************************************
+ *
+ * All times are in nanoseconds, reset in microseconds.
+ * MIN/MAX are datasheet tolerances, TYP is the nominal value.
+ * TL_MIN is the shortest LOW part of a bit the chip still reads,
+ * it limits the highest usable bit rate.
+ *
+ * Currents are typical values at 5V in mA: per fully lit channel
+ * and idle current of one LED. Override them to match your strip.
+ *
+ * Tick macros need the timer settings, include after ARGB.h.
+ */
+
+#pragma once
+
+/**
+ * @addtogroup ARGB_Driver
+ * @{
+ * @addtogroup Timing_profiles
+ * @brief Chip timing with tolerances
+ * @{
+ */
+
+/// WS2811 slow mode, 400 KHz nominal
+#define ARGB_WS2811S_T0H_MIN_NS  350
+#define ARGB_WS2811S_T0H_TYP_NS  500
+#define ARGB_WS2811S_T0H_MAX_NS  650
+#define ARGB_WS2811S_T1H_MIN_NS  1050
+#define ARGB_WS2811S_T1H_TYP_NS  1200
+#define ARGB_WS2811S_T1H_MAX_NS  1350
+#define ARGB_WS2811S_TL_MIN_NS   1150
+#define ARGB_WS2811S_RES_MIN_US  50
+#define ARGB_WS2811S_RATE_HZ     400000
+
+/// WS2811 fast mode, 800 KHz nominal
+#define ARGB_WS2811F_T0H_MIN_NS  100
+#define ARGB_WS2811F_T0H_TYP_NS  250
+#define ARGB_WS2811F_T0H_MAX_NS  400
+#define ARGB_WS2811F_T1H_MIN_NS  450
+#define ARGB_WS2811F_T1H_TYP_NS  600
+#define ARGB_WS2811F_T1H_MAX_NS  750
+#define ARGB_WS2811F_TL_MIN_NS   500
+#define ARGB_WS2811F_RES_MIN_US  50
+#define ARGB_WS2811F_RATE_HZ     800000
+
+/// WS2812 / WS2812B, 800 KHz nominal
+#define ARGB_WS2812_T0H_MIN_NS   200
+#define ARGB_WS2812_T0H_TYP_NS   350
+#define ARGB_WS2812_T0H_MAX_NS   500
+#define ARGB_WS2812_T1H_MIN_NS   550
+#define ARGB_WS2812_T1H_TYP_NS   700
+#define ARGB_WS2812_T1H_MAX_NS   850
+#define ARGB_WS2812_TL_MIN_NS    300
+#define ARGB_WS2812_RES_MIN_US   280 ///< WS2812B datasheet, older WS2812 latch after 50 us, see #ARGB_RESET_US
+#define ARGB_WS2812_RATE_HZ      800000
+
+/// SK6812, 800 KHz nominal
+#define ARGB_SK6812_T0H_MIN_NS   150
+#define ARGB_SK6812_T0H_TYP_NS   300
+#define ARGB_SK6812_T0H_MAX_NS   450
+#define ARGB_SK6812_T1H_MIN_NS   450
+#define ARGB_SK6812_T1H_TYP_NS   600
+#define ARGB_SK6812_T1H_MAX_NS   750
+#define ARGB_SK6812_TL_MIN_NS    450
+#define ARGB_SK6812_RES_MIN_US   80
+#define ARGB_SK6812_RATE_HZ      800000
+
+/**
+ * @addtogroup Current_profiles
+ * @brief Current draw used by power estimation
+ * @{
+ */
+#if !defined(ARGB_WS2811_MA_RGB)
+#define ARGB_WS2811_MA_RGB   18 ///< WS2811 (both modes), per channel
+#endif
+#if !defined(ARGB_WS2811_MA_IDLE)
+#define ARGB_WS2811_MA_IDLE  1
+#endif
+#if !defined(ARGB_WS2812_MA_RGB)
+#define ARGB_WS2812_MA_RGB   20 ///< WS2812 / WS2812B, per channel
+#endif
+#if !defined(ARGB_WS2812_MA_IDLE)
+#define ARGB_WS2812_MA_IDLE  1
+#endif
+#if !defined(ARGB_SK6812_MA_RGB)
+#define ARGB_SK6812_MA_RGB   18 ///< SK6812, per colour channel
+#endif
+#if !defined(ARGB_SK6812_MA_W)
+#define ARGB_SK6812_MA_W     20 ///< SK6812, white channel
+#endif
+#if !defined(ARGB_SK6812_MA_IDLE)
+#define ARGB_SK6812_MA_IDLE  1
+#endif
+/// @}
+
+/// Profile field access: ARGB_TIMING(ARGB_WS2812, T1H_MIN_NS)
+#define ARGB_TIMING(chip, field)  ARGB_TIMING_(chip, field)
+#define ARGB_TIMING_(chip, field) chip##_##field
+
+/**
+ * @addtogroup Timer_ticks
+ * @brief Profiles at the LED timer clock and #ARGB_BIT_RATE_HZ,
+ *        constant expressions for ARGB.c and ARGB.hpp alike
+ * @{
+ */
+/// Timer handler
+#if (TIM_HANDLE == PWMD2) || (TIM_HANDLE == PWMD3) || (TIM_HANDLE == PWMD4) || \
+    (TIM_HANDLE == PWMD5) || (TIM_HANDLE == PWMD5) || (TIM_HANDLE == PWMD12)
+#define APB_FREQ  STM32_TIMCLK1
+#else
+#define APB_FREQ  STM32_TIMCLK2
+#endif
+
+#ifdef APB1
+#define APB_FREQ STM32_TIMCLK1
+#elif defined(APB2)
+#define APB_FREQ STM32_TIMCLK2
+#endif
+
+#define ARR_VAL (APB_FREQ / ARGB_BIT_RATE_HZ) ///< Timer ticks per bit
+
+#define LED_SIGNAL_RISE_DELAY_NS ((uint32_t) (LED_SIGNAL_RISE_DELAY_US * 1000))
+
+#define ARGB_NS2TICKS(ns) ((uint32_t) (((uint64_t) (ns) * APB_FREQ) / 1000000000u))
+#define ARGB_TICKS2NS(t)  ((uint32_t) (((uint64_t) (t) * 1000000000u) / APB_FREQ))
+#define ARGB_PERIOD_NS    ARGB_TICKS2NS(ARR_VAL) ///< Bit period after rounding to ticks
+
+/// Log.1 high time: typical one, cut down at high bit rates to keep the minimal low time, 0 if nothing is left
+#define ARGB_T1H_NS(c) \
+    ((ARGB_TIMING(c, T1H_TYP_NS) + ARGB_TIMING(c, TL_MIN_NS) <= ARGB_PERIOD_NS) ? ARGB_TIMING(c, T1H_TYP_NS) : \
+     (ARGB_TIMING(c, TL_MIN_NS) < ARGB_PERIOD_NS) ? (ARGB_PERIOD_NS - ARGB_TIMING(c, TL_MIN_NS)) : 0)
+
+#define ARGB_PWM_HI(c) ARGB_NS2TICKS(ARGB_T1H_NS(c) + LED_SIGNAL_RISE_DELAY_NS)               ///< Log.1 compare value
+#define ARGB_PWM_LO(c) ARGB_NS2TICKS(ARGB_TIMING(c, T0H_TYP_NS) + LED_SIGNAL_RISE_DELAY_NS)   ///< Log.0 compare value
+
+/// High time seen by the chip
+#define ARGB_HIGH_NS(ticks) (ARGB_TICKS2NS(ticks) - LED_SIGNAL_RISE_DELAY_NS)
+
+/// Chip tolerances are met at selected bit rate and timer clock
+#define ARGB_TIMING_OK(c) \
+    ((ARGB_HIGH_NS(ARGB_PWM_LO(c)) >= ARGB_TIMING(c, T0H_MIN_NS)) && \
+     (ARGB_HIGH_NS(ARGB_PWM_LO(c)) <= ARGB_TIMING(c, T0H_MAX_NS)) && \
+     (ARGB_HIGH_NS(ARGB_PWM_HI(c)) >= ARGB_TIMING(c, T1H_MIN_NS)) && \
+     (ARGB_HIGH_NS(ARGB_PWM_HI(c)) <= ARGB_TIMING(c, T1H_MAX_NS)) && \
+     (ARGB_PERIOD_NS >= ARGB_HIGH_NS(ARGB_PWM_HI(c)) + ARGB_TIMING(c, TL_MIN_NS)))
+/// @}
+
+/// @} @}
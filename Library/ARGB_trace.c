@@ -0,0 +1,62 @@
+/**
+ *******************************************
+ * @file    ARGB_trace.c
+ * @brief   Trace dump of ARGB Driver
+ *******************************************
+ *
+ * Prints the trace ring as text, one record per line, framed by a
+ * header with the counter clock and an end line, so it can be cut
+ * out of any console log and fed to Tools/argb_trace.py:
+ *
+ *     argb-trace hz=168000000 n=3 mode=circ
+ *     1a2b3c4d 0 0 0
+ *     ...
+ *     argb-trace end
+ *
+ * The mode tells how half events read: circ (HT/TC halves), dbm
+ * (double-buffer memory targets) or thread (encode thread ring).
+ * Recording is paused while printing and resumed afterwards.
+ */
+
+#include "ARGB_trace.h"
+#include "chprintf.h"
+
+#if !ARGB_USE_TRACE
+#error ARGB_trace.c needs ARGB_USE_TRACE set to 1
+#endif
+
+#if ARGB_USE_DBM
+#define ARGB_TRACE_MODE "dbm"    ///< arg8 of halves is the buffer
+#elif ARGB_USE_ENCODE_THREAD
+#define ARGB_TRACE_MODE "thread" ///< arg16 of halves is the ring depth
+#else
+#define ARGB_TRACE_MODE "circ"
+#endif
+
+/**
+ * @addtogroup ARGB_Driver
+ * @{
+ */
+
+/**
+ * @brief Print trace records, oldest first
+ * @param[in] out Stream: serial port, USB CDC, ...
+ */
+void argb_trace_dump(BaseSequentialStream *out)
+{
+    argb_trace_rec rec;
+    uint16_t n;
+
+    argb_trace_enable(false);
+    n = argb_trace_count();
+    chprintf(out, "argb-trace hz=%lu n=%u mode=%s\r\n", (unsigned long) ARGB_TRACE_CLOCK_HZ, n, ARGB_TRACE_MODE);
+    for (uint16_t k = 0; k < n; k++)
+    {
+        if (argb_trace_get(k, &rec))
+            chprintf(out, "%08lx %u %u %u\r\n", (unsigned long) rec.t, rec.ev, rec.arg8, rec.arg16);
+    }
+    chprintf(out, "argb-trace end\r\n");
+    argb_trace_enable(true);
+}
+
+/// @} //Driver
@@ -0,0 +1,28 @@
+/**
+ *******************************************
+ * @file    ARGB_trace.h
+ * @brief   Trace dump of ARGB Driver
+ *******************************************
+ *
+ * @note Needs ARGB_USE_TRACE set to 1
+ */
+
+#pragma once
+
+#include "ARGB.h"
+
+/**
+ * @addtogroup ARGB_Driver
+ * @{
+ * @addtogroup Trace
+ * @brief Timestamped driver events for timing analysis
+ * @{
+ */
+
+#if !defined(ARGB_TRACE_CLOCK_HZ)
+#define ARGB_TRACE_CLOCK_HZ STM32_HCLK ///< Realtime counter clock (DWT counts core cycles)
+#endif
+
+void argb_trace_dump(BaseSequentialStream *out); // Print records, oldest first, for Tools/argb_trace.py
+
+/// @} @}
@@ -29,7 +29,7 @@ static inline uint8_t qsub8( uint8_t i, uint8_t j)
 ///         square root for 16-bit integers
 ///         About three times faster and five times smaller
 ///         than Arduino's general sqrt on AVR.
-static uint8_t sqrt16(uint16_t x)
+static inline uint8_t sqrt16(uint16_t x)
 {
     if( x <= 1) {
         return x;
@@ -57,4 +57,304 @@ static uint8_t sqrt16(uint16_t x)
     } while (hi >= low);
 
     return low - 1;
-}
\ No newline at end of file
+}
+
+/// sqrt16(k * 256) for every byte k, i.e. 16 * sqrt(k)
+static const uint8_t sqrt16_x256_lut[256] = {
+      0,  16,  22,  27,  32,  35,  39,  42,  45,  48,  50,  53,  55,  57,  59,  61,
+     64,  65,  67,  69,  71,  73,  75,  76,  78,  80,  81,  83,  84,  86,  87,  89,
+     90,  91,  93,  94,  96,  97,  98,  99, 101, 102, 103, 104, 106, 107, 108, 109,
+    110, 112, 113, 114, 115, 116, 117, 118, 119, 120, 121, 122, 123, 124, 125, 126,
+    128, 128, 129, 130, 131, 132, 133, 134, 135, 136, 137, 138, 139, 140, 141, 142,
+    143, 144, 144, 145, 146, 147, 148, 149, 150, 150, 151, 152, 153, 154, 155, 155,
+    156, 157, 158, 159, 160, 160, 161, 162, 163, 163, 164, 165, 166, 167, 167, 168,
+    169, 170, 170, 171, 172, 173, 173, 174, 175, 176, 176, 177, 178, 178, 179, 180,
+    181, 181, 182, 183, 183, 184, 185, 185, 186, 187, 187, 188, 189, 189, 190, 191,
+    192, 192, 193, 193, 194, 195, 195, 196, 197, 197, 198, 199, 199, 200, 201, 201,
+    202, 203, 203, 204, 204, 205, 206, 206, 207, 208, 208, 209, 209, 210, 211, 211,
+    212, 212, 213, 214, 214, 215, 215, 216, 217, 217, 218, 218, 219, 219, 220, 221,
+    221, 222, 222, 223, 224, 224, 225, 225, 226, 226, 227, 227, 228, 229, 229, 230,
+    230, 231, 231, 232, 232, 233, 234, 234, 235, 235, 236, 236, 237, 237, 238, 238,
+    239, 240, 240, 241, 241, 242, 242, 243, 243, 244, 244, 245, 245, 246, 246, 247,
+    247, 248, 248, 249, 249, 250, 250, 251, 251, 252, 252, 253, 253, 254, 254, 255,
+};
+
+///         square root of a byte scaled up by 256
+///         Same result as sqrt16(k * 256), without the search
+static inline uint8_t sqrt16_x256(uint8_t k)
+{
+    return sqrt16_x256_lut[k];
+}
+
+/// 65535 / d for every byte d, d = 0 is taken as 1
+static const uint16_t recip16_lut[256] = {
+    65535, 65535, 32767, 21845, 16383, 13107, 10922,  9362,
+     8191,  7281,  6553,  5957,  5461,  5041,  4681,  4369,
+     4095,  3855,  3640,  3449,  3276,  3120,  2978,  2849,
+     2730,  2621,  2520,  2427,  2340,  2259,  2184,  2114,
+     2047,  1985,  1927,  1872,  1820,  1771,  1724,  1680,
+     1638,  1598,  1560,  1524,  1489,  1456,  1424,  1394,
+     1365,  1337,  1310,  1285,  1260,  1236,  1213,  1191,
+     1170,  1149,  1129,  1110,  1092,  1074,  1057,  1040,
+     1023,  1008,   992,   978,   963,   949,   936,   923,
+      910,   897,   885,   873,   862,   851,   840,   829,
+      819,   809,   799,   789,   780,   771,   762,   753,
+      744,   736,   728,   720,   712,   704,   697,   689,
+      682,   675,   668,   661,   655,   648,   642,   636,
+      630,   624,   618,   612,   606,   601,   595,   590,
+      585,   579,   574,   569,   564,   560,   555,   550,
+      546,   541,   537,   532,   528,   524,   520,   516,
+      511,   508,   504,   500,   496,   492,   489,   485,
+      481,   478,   474,   471,   468,   464,   461,   458,
+      455,   451,   448,   445,   442,   439,   436,   434,
+      431,   428,   425,   422,   420,   417,   414,   412,
+      409,   407,   404,   402,   399,   397,   394,   392,
+      390,   387,   385,   383,   381,   378,   376,   374,
+      372,   370,   368,   366,   364,   362,   360,   358,
+      356,   354,   352,   350,   348,   346,   344,   343,
+      341,   339,   337,   336,   334,   332,   330,   329,
+      327,   326,   324,   322,   321,   319,   318,   316,
+      315,   313,   312,   310,   309,   307,   306,   304,
+      303,   302,   300,   299,   297,   296,   295,   293,
+      292,   291,   289,   288,   287,   286,   284,   283,
+      282,   281,   280,   278,   277,   276,   275,   274,
+      273,   271,   270,   269,   268,   267,   266,   265,
+      264,   263,   262,   261,   260,   259,   258,   257,
+};
+
+///         16-bit reciprocal of a byte
+///         Same result as 65535 / d, without the division
+static inline uint16_t recip16(uint8_t d)
+{
+    return recip16_lut[d];
+}
+
+/// smoothstep of a fraction, 3t^2 - 2t^3 in 8 bits
+static inline uint8_t ease8(uint8_t t)
+{
+    int t2 = (t * t) >> 8;
+    int r = 3 * t2 - ((2 * t2 * t) >> 8);
+    return (r > 255) ? 255 : r;
+}
+
+/// a + (b - a) * u / 256 for signed values
+static inline int16_t lerp16by8(int16_t a, int16_t b, uint8_t u)
+{
+    return a + (((int32_t) (b - a) * u) >> 8);
+}
+
+/// Ken Perlin's permutation, lattice hash of the noise functions
+static const uint8_t noise8_perm[256] = {
+    151, 160, 137,  91,  90,  15, 131,  13, 201,  95,  96,  53, 194, 233,   7, 225,
+    140,  36, 103,  30,  69, 142,   8,  99,  37, 240,  21,  10,  23, 190,   6, 148,
+    247, 120, 234,  75,   0,  26, 197,  62,  94, 252, 219, 203, 117,  35,  11,  32,
+     57, 177,  33,  88, 237, 149,  56,  87, 174,  20, 125, 136, 171, 168,  68, 175,
+     74, 165,  71, 134, 139,  48,  27, 166,  77, 146, 158, 231,  83, 111, 229, 122,
+     60, 211, 133, 230, 220, 105,  92,  41,  55,  46, 245,  40, 244, 102, 143,  54,
+     65,  25,  63, 161,   1, 216,  80,  73, 209,  76, 132, 187, 208,  89,  18, 169,
+    200, 196, 135, 130, 116, 188, 159,  86, 164, 100, 109, 198, 173, 186,   3,  64,
+     52, 217, 226, 250, 124, 123,   5, 202,  38, 147, 118, 126, 255,  82,  85, 212,
+    207, 206,  59, 227,  47,  16,  58,  17, 182, 189,  28,  42, 223, 183, 170, 213,
+    119, 248, 152,   2,  44, 154, 163,  70, 221, 153, 101, 155, 167,  43, 172,   9,
+    129,  22,  39, 253,  19,  98, 108, 110,  79, 113, 224, 232, 178, 185, 112, 104,
+    218, 246,  97, 228, 251,  34, 242, 193, 238, 210, 144,  12, 191, 179, 162, 241,
+     81,  51, 145, 235, 249,  14, 239, 107,  49, 192, 214,  31, 181, 199, 106, 157,
+    184,  84, 204, 176, 115, 121,  50,  45, 127,   4, 150, 254, 138, 236, 205,  93,
+    222, 114,  67,  29,  24,  72, 243, 141, 128, 195,  78,  66, 215,  61, 156, 180,
+};
+
+/// Gradients of 2D noise: axes and diagonals
+static const int8_t noise8_grad2[8][2] = {
+    { 1,  1}, {-1,  1}, { 1, -1}, {-1, -1},
+    { 1,  0}, {-1,  0}, { 0,  1}, { 0, -1},
+};
+
+/// Gradients of 3D noise: cube edges, four repeated to make 16
+static const int8_t noise8_grad3[16][3] = {
+    { 1,  1,  0}, {-1,  1,  0}, { 1, -1,  0}, {-1, -1,  0},
+    { 1,  0,  1}, {-1,  0,  1}, { 1,  0, -1}, {-1,  0, -1},
+    { 0,  1,  1}, { 0, -1,  1}, { 0,  1, -1}, { 0, -1, -1},
+    { 1,  1,  0}, { 0, -1,  1}, {-1,  1,  0}, { 0, -1, -1},
+};
+
+/// Gradient noise gain per dimension, 256 = 1, maps all but the rarest peaks to [0..255]
+static const uint16_t noise8_gain[3] = {256, 171, 171};
+
+///         Noise sampler walking along x of a 1D/2D/3D noise field
+///         Coordinates are 8.8 fixed point, 256 is one lattice cell,
+///         the field repeats every 256 cells. Along the row y and z are
+///         fixed, so the corners of a cell are reduced to one slope and
+///         offset per side once and every sample inside the cell costs
+///         two multiplies and a blend.
+typedef struct noise8_row {
+    uint16_t x;       ///< Next sample position
+    uint16_t dx;      ///< Step between samples
+    uint8_t dims;     ///< 1, 2 or 3
+    bool grad;        ///< Gradient noise, value noise if false
+    uint8_t ly, lz;   ///< Lattice row and plane
+    uint8_t uy, uz;   ///< Eased fractions of y and z
+    int16_t fy, fz;   ///< Fractions of y and z
+    uint8_t cell;     ///< Lattice cell of a[] and c[]
+    bool valid;       ///< a[] and c[] are set
+    int16_t a[2];     ///< Slope along x of left and right corner
+    int16_t c[2];     ///< Offset of left and right corner
+} noise8_row;
+
+/// Lattice hash of corner (lx, ly, lz), y and z are skipped below their dimension
+static inline uint8_t noise8_hash(uint8_t dims, uint8_t lx, uint8_t ly, uint8_t lz)
+{
+    uint8_t h = noise8_perm[lx];
+    if (dims > 1)
+        h = noise8_perm[(uint8_t) (h + ly)];
+    if (dims > 2)
+        h = noise8_perm[(uint8_t) (h + lz)];
+    return h;
+}
+
+/// Reduce corners of lattice x = lx to slope *a and offset *c
+static inline void noise8_corner(const noise8_row *w, uint8_t lx, int16_t *a, int16_t *c)
+{
+    int16_t va[2] = {0, 0}, vc[2] = {0, 0};
+
+    for (uint8_t k = 0; k < ((w->dims > 2) ? 2 : 1); k++)
+    {
+        int16_t ja[2] = {0, 0}, jc[2] = {0, 0};
+
+        for (uint8_t j = 0; j < ((w->dims > 1) ? 2 : 1); j++)
+        {
+            uint8_t h = noise8_hash(w->dims, lx, w->ly + j, w->lz + k);
+
+            if (!w->grad)
+            {
+                jc[j] = h;
+            }
+            else if (w->dims == 1)
+            {
+                // slopes +-1/8 .. +-8/8
+                ja[j] = ((h & 7) + 1) * 32;
+                if (h & 8)
+                    ja[j] = -ja[j];
+            }
+            else if (w->dims == 2)
+            {
+                ja[j] = noise8_grad2[h & 7][0] * 256;
+                jc[j] = noise8_grad2[h & 7][1] * (w->fy - 256 * j);
+            }
+            else
+            {
+                ja[j] = noise8_grad3[h & 15][0] * 256;
+                jc[j] = noise8_grad3[h & 15][1] * (w->fy - 256 * j)
+                      + noise8_grad3[h & 15][2] * (w->fz - 256 * k);
+            }
+        }
+        va[k] = (w->dims > 1) ? lerp16by8(ja[0], ja[1], w->uy) : ja[0];
+        vc[k] = (w->dims > 1) ? lerp16by8(jc[0], jc[1], w->uy) : jc[0];
+    }
+    *a = (w->dims > 2) ? lerp16by8(va[0], va[1], w->uz) : va[0];
+    *c = (w->dims > 2) ? lerp16by8(vc[0], vc[1], w->uz) : vc[0];
+}
+
+///         Start a noise row
+///         @param w - sampler
+///         @param grad - gradient noise, value noise if false
+///         @param dims - 1, 2 or 3, y and z are ignored below
+///         @param x - position of the first sample, 8.8
+///         @param dx - step between samples, 8.8
+///         @param y, z - row and plane, 8.8
+static inline void noise8_row_init(noise8_row *w, bool grad, uint8_t dims,
+                                   uint16_t x, uint16_t dx, uint16_t y, uint16_t z)
+{
+    w->x = x;
+    w->dx = dx;
+    w->dims = (dims < 1) ? 1 : (dims > 3) ? 3 : dims;
+    w->grad = grad;
+    w->ly = y >> 8;
+    w->lz = z >> 8;
+    w->fy = y & 0xFF;
+    w->fz = z & 0xFF;
+    w->uy = ease8(w->fy);
+    w->uz = ease8(w->fz);
+    w->valid = false;
+}
+
+///         Next sample of a noise row
+///         @returns noise [0..255], 128 on average
+static inline uint8_t noise8_row_next(noise8_row *w)
+{
+    uint8_t cell = w->x >> 8, fx = w->x;
+    int16_t n;
+
+    if (!w->valid || (cell != w->cell))
+    {
+        if (w->valid && (cell == (uint8_t) (w->cell + 1)))
+        {
+            // stepped into the next cell, its left side is known
+            w->a[0] = w->a[1];
+            w->c[0] = w->c[1];
+        }
+        else
+        {
+            noise8_corner(w, cell, &w->a[0], &w->c[0]);
+        }
+        noise8_corner(w, cell + 1, &w->a[1], &w->c[1]);
+        w->cell = cell;
+        w->valid = true;
+    }
+    w->x += w->dx;
+
+    if (!w->grad)
+        return lerp16by8(w->c[0], w->c[1], ease8(fx));
+
+    n = lerp16by8(((w->a[0] * fx) >> 8) + w->c[0],
+                  ((w->a[1] * (fx - 256)) >> 8) + w->c[1], ease8(fx));
+    n = 128 + ((n * noise8_gain[w->dims - 1]) >> 8);
+    return (n < 0) ? 0 : (n > 255) ? 255 : n;
+}
+
+///         1D value noise, x is 8.8
+static inline uint8_t vnoise8(uint16_t x)
+{
+    noise8_row w;
+    noise8_row_init(&w, false, 1, x, 0, 0, 0);
+    return noise8_row_next(&w);
+}
+
+///         2D value noise, x and y are 8.8
+static inline uint8_t vnoise8_2d(uint16_t x, uint16_t y)
+{
+    noise8_row w;
+    noise8_row_init(&w, false, 2, x, 0, y, 0);
+    return noise8_row_next(&w);
+}
+
+///         3D value noise, x, y and z are 8.8
+static inline uint8_t vnoise8_3d(uint16_t x, uint16_t y, uint16_t z)
+{
+    noise8_row w;
+    noise8_row_init(&w, false, 3, x, 0, y, z);
+    return noise8_row_next(&w);
+}
+
+///         1D gradient noise, x is 8.8
+static inline uint8_t gnoise8(uint16_t x)
+{
+    noise8_row w;
+    noise8_row_init(&w, true, 1, x, 0, 0, 0);
+    return noise8_row_next(&w);
+}
+
+///         2D gradient noise, x and y are 8.8
+static inline uint8_t gnoise8_2d(uint16_t x, uint16_t y)
+{
+    noise8_row w;
+    noise8_row_init(&w, true, 2, x, 0, y, 0);
+    return noise8_row_next(&w);
+}
+
+///         3D gradient noise, x, y and z are 8.8
+static inline uint8_t gnoise8_3d(uint16_t x, uint16_t y, uint16_t z)
+{
+    noise8_row w;
+    noise8_row_init(&w, true, 3, x, 0, y, z);
+    return noise8_row_next(&w);
+}
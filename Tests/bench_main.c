@@ -0,0 +1,18 @@
+/**
+ *******************************************
+ * @file    bench_main.c
+ * @brief   Runs ARGB_bench.c on the host
+ *******************************************
+ *
+ * Same cases and JSON as on target, "cycles" are nanoseconds of the
+ * host's monotonic clock.
+ */
+
+#include "ARGB_bench.h"
+
+int main(void)
+{
+    argb_init();
+    argb_bench_run(NULL);
+    return 0;
+}
@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+"""
+Write raw RGB frames for the RLE test: long runs, long literals,
+sparse changes and repeated frames, so every op and the 64 LED split
+are used.
+
+    rle_frames.py leds out.rgb
+"""
+
+import random
+import sys
+
+
+def frames(leds):
+    rnd = random.Random(35)
+    color = lambda: tuple(rnd.randrange(256) for _ in range(3))
+
+    # keyframe: a long run, then noise
+    cur = [color()] * (leds // 2) + [color() for _ in range(leds - leds // 2)]
+    out = [cur]
+    for f in range(24):
+        cur = list(cur)
+        kind = f % 4
+        if kind == 0:
+            # few LEDs changed
+            for _ in range(rnd.randrange(1, 6)):
+                cur[rnd.randrange(leds)] = color()
+        elif kind == 1:
+            # run of random length and place
+            a = rnd.randrange(leds)
+            b = rnd.randrange(a, leds) + 1
+            cur[a:b] = [color()] * (b - a)
+        elif kind == 2:
+            # literal of random length and place, pairs of equal LEDs in it;
+            # the first one is all new LEDs over the whole frame
+            a = rnd.randrange(leds) if f > 2 else 0
+            b = rnd.randrange(a, leds) + 1 if f > 2 else leds
+            pairs = 0.2 if f > 2 else 0
+            for i in range(a, b):
+                cur[i] = cur[i - 1] if i > a and rnd.random() < pairs else color()
+        # kind 3: same frame again
+        out.append(cur)
+    return out
+
+
+def main():
+    leds = int(sys.argv[1])
+    with open(sys.argv[2], "wb") as f:
+        for frame in frames(leds):
+            for px in frame:
+                f.write(bytes(px))
+
+
+if __name__ == "__main__":
+    main()
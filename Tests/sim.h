@@ -0,0 +1,116 @@
+/**
+ *******************************************
+ * @file    sim.h
+ * @brief   Host simulation of the LED timer & DMA stream
+ *******************************************
+ *
+ * Include after ARGB.c; C++ tests link the driver and get no decoder.
+ * The stream is run slot by slot from the registers the driver
+ * programmed: NDTR counts down and reloads, HT/TC are raised at the
+ * half and the end, CT toggles in double-buffer mode. Once the driver
+ * stops the stream, periods of the latch timer are run till the strip
+ * is ready. Every slot read is kept and decoded back into wire bytes.
+ */
+
+#pragma once
+
+#include <assert.h>
+
+#define SIM_MAX_SLOTS (1u << 18)
+
+static uint32_t sim_slots[SIM_MAX_SLOTS]; ///< PWM values read by DMA, in wire order
+static size_t sim_nslots = 0;             ///< Slots read by the last sim_frame()
+static size_t sim_latch_periods = 0;      ///< Latch timer periods of the last frame
+static void (*sim_slot_hook)(void) = NULL; ///< Called after every slot, e.g. to run the encode worker
+
+/**
+ * @brief Run DMA and latch timer till the strip is ready
+ * @return Slots read
+ */
+static inline size_t sim_frame(void)
+{
+    DMA_Stream_TypeDef *st = DMA_HANDLE->stream;
+
+    sim_nslots = 0;
+    sim_latch_periods = 0;
+    while (st->CR & STM32_DMA_CR_EN)
+    {
+        uint32_t flags = 0;
+        uintptr_t mem = (st->CR & STM32_DMA_CR_CT) ? st->M1AR : st->M0AR;
+
+        assert((st->NDTR != 0) && (st->NDTR <= st->len));
+        assert(sim_nslots < SIM_MAX_SLOTS);
+        sim_slots[sim_nslots++] = ((const volatile dma_siz *) mem)[st->len - st->NDTR];
+
+        if (--st->NDTR == st->len / 2)
+            flags |= (st->CR & STM32_DMA_CR_HTIE) ? STM32_DMA_ISR_HTIF : 0;
+        if (st->NDTR == 0)
+        {
+            st->NDTR = st->len;
+            if (st->CR & STM32_DMA_CR_DBM)
+                st->CR ^= STM32_DMA_CR_CT;
+            else if (!(st->CR & STM32_DMA_CR_CIRC))
+                st->CR &= ~STM32_DMA_CR_EN;
+            flags |= (st->CR & STM32_DMA_CR_TCIE) ? STM32_DMA_ISR_TCIF : 0;
+        }
+        if (flags)
+            host_dma_isr(host_dma_param, flags);
+        if (sim_slot_hook != NULL)
+            sim_slot_hook();
+    }
+
+    while (TIM_HANDLE.notify)
+    {
+        assert(++sim_latch_periods < 1000);
+        TIM_HANDLE.config->callback(&TIM_HANDLE);
+    }
+    return sim_nslots;
+}
+
+#if !defined(__cplusplus) // segment table is private to ARGB.c
+/**
+ * @brief Decode slots of the last frame with the segment table
+ * @param[out] wire Wire bytes, argb_total_bytes at most
+ * @return Trailing zero slots, -1 if a data slot is neither HI nor LO
+ *         or the frame is short
+ */
+static inline long sim_decode(uint8_t *wire)
+{
+    size_t pos = 0;
+
+    for (uint8_t s = 0; s < argb_seg_count; s++)
+    {
+        const argb_seg *seg = &argb_segs[s];
+        for (uint32_t b = seg->offset; b < seg->limit; b++)
+        {
+            uint8_t v = 0;
+            for (uint8_t i = 0; i < 8; i++, pos++)
+            {
+                if ((pos >= sim_nslots) || ((sim_slots[pos] != seg->hi) && (sim_slots[pos] != seg->lo)))
+                    return -1;
+                v = (v << 1) | (sim_slots[pos] == seg->hi);
+            }
+            wire[b] = v;
+        }
+    }
+    for (size_t k = pos; k < sim_nslots; k++)
+    {
+        if (sim_slots[k] != 0)
+            return -1;
+    }
+    return (long) (sim_nslots - pos);
+}
+
+/**
+ * @brief Show #rgb_buf and decode it
+ * @param[out] wire Wire bytes
+ * @return Trailing zero slots, -1 on bad frame or busy strip
+ */
+static inline long sim_show(uint8_t *wire)
+{
+    if (argb_show() != ARGB_OK)
+        return -1;
+    sim_frame();
+    return sim_decode(wire);
+}
+#endif
@@ -0,0 +1,31 @@
+/**
+ *******************************************
+ * @file    board.h
+ * @brief   Host test board: 60 WS2812 on TIM4 CH4
+ *******************************************
+ *
+ * Tests change LED type and DMA size with -D flags.
+ */
+
+#pragma once
+
+#include "hal.h"
+
+#if !defined(NUM_LEDS)
+#define NUM_LEDS 60
+#endif
+#define LED_TIMER PWMD4
+#define TIM_CH TIM_CHANNEL_4
+
+extern const stm32_dma_stream_t host_dma;
+#define DMA_HANDLE (&host_dma)
+
+#if !(defined(WS2811S) || defined(WS2811F) || defined(WS2812) || defined(SK6812))
+#define WS2812
+#endif
+#if !(defined(DMA_SIZE_BYTE) || defined(DMA_SIZE_HWORD) || defined(DMA_SIZE_WORD))
+#define DMA_SIZE_WORD
+#endif
+
+#define LED_PWM_RISE_DELAY_US 0.02
+#define LED_PWM_ACTIVE_EDGE PWM_OUTPUT_ACTIVE_HIGH
@@ -0,0 +1,87 @@
+/**
+ *******************************************
+ * @file    ch.h
+ * @brief   Host stand-in of ChibiOS/RT kernel API used by ARGB Driver
+ *******************************************
+ *
+ * Just enough kernel for the driver to build and run on a PC:
+ * locks are no-ops, time is a counter the tests move, the heap is
+ * malloc and threads are never started.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#if !defined(CH_CFG_USE_HEAP)
+#define CH_CFG_USE_HEAP 1
+#endif
+
+typedef uint32_t systime_t;
+typedef uint32_t sysinterval_t;
+typedef uint32_t rtcnt_t;
+typedef uint32_t syssts_t;
+typedef int32_t cnt_t;
+typedef int32_t msg_t;
+typedef uint8_t tprio_t;
+
+typedef struct semaphore {
+    volatile cnt_t cnt;
+} semaphore_t;
+
+typedef struct memory_heap {
+    int unused;
+} memory_heap_t;
+
+typedef struct thread thread_t;
+typedef void (*tfunc_t)(void *p);
+
+typedef struct BaseSequentialStream BaseSequentialStream;
+typedef struct BaseChannel BaseChannel;
+
+#define HIGHPRIO   255
+#define NORMALPRIO 128
+#define MSG_OK     0
+
+#define THD_WORKING_AREA(s, n) uint64_t s[((n) + 256) / 8]
+#define THD_FUNCTION(tname, arg) void tname(void *arg)
+
+#define TIME_INFINITE ((sysinterval_t) -1)
+#define TIME_IMMEDIATE ((sysinterval_t) 0)
+#define TIME_MS2I(ms) ((sysinterval_t) (ms))
+#define TIME_US2I(us) ((sysinterval_t) (((us) + 999) / 1000))
+#define TIME_I2MS(i)  ((uint32_t) (i))
+#define chTimeAddX(t, i) ((systime_t) ((t) + (i)))
+
+extern systime_t host_time; ///< System time, 1 ms ticks, moved by the tests
+extern void (*host_sleep_hook)(void); ///< Called from chThdSleep*, e.g. to run the DMA simulation
+
+systime_t chVTGetSystemTimeX(void);
+sysinterval_t chVTTimeElapsedSinceX(systime_t start);
+rtcnt_t chSysGetRealtimeCounterX(void);
+
+void chSysLock(void);
+void chSysUnlock(void);
+void chSysLockFromISR(void);
+void chSysUnlockFromISR(void);
+syssts_t chSysGetStatusAndLockX(void);
+void chSysRestoreStatusX(syssts_t sts);
+
+void chSemObjectInit(semaphore_t *sp, cnt_t n);
+msg_t chSemWait(semaphore_t *sp);
+msg_t chSemWaitS(semaphore_t *sp);
+void chSemAddCounterI(semaphore_t *sp, cnt_t n);
+#define chSemGetCounterI(sp) ((sp)->cnt)
+
+thread_t *chThdCreateStatic(void *wsp, size_t size, tprio_t prio, tfunc_t pf, void *arg);
+void chThdSleep(sysinterval_t time);
+systime_t chThdSleepUntilWindowed(systime_t prev, systime_t next);
+void chRegSetThreadName(const char *name);
+
+void *chHeapAllocAligned(memory_heap_t *heapp, size_t size, unsigned align);
+#define chHeapAlloc(heapp, size) chHeapAllocAligned(heapp, size, 8)
+void chHeapFree(void *p);
+
+size_t chnReadTimeout(BaseChannel *chn, uint8_t *buf, size_t n, sysinterval_t timeout);
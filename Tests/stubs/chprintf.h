@@ -0,0 +1,12 @@
+/**
+ *******************************************
+ * @file    chprintf.h
+ * @brief   Host stand-in of ChibiOS chprintf, prints to stdout
+ *******************************************
+ */
+
+#pragma once
+
+#include "ch.h"
+
+int chprintf(BaseSequentialStream *chp, const char *fmt, ...);
@@ -0,0 +1,67 @@
+/**
+ *******************************************
+ * @file    hal.h
+ * @brief   Host stand-in of ChibiOS/HAL PWM & STM32 timer API
+ *******************************************
+ */
+
+#pragma once
+
+#include "ch.h"
+
+#define STM32_TIMCLK1 84000000
+#define STM32_TIMCLK2 168000000
+#define STM32_HCLK    168000000
+
+typedef struct stm32_tim {
+    volatile uint32_t CR1, CR2, SMCR, DIER, SR, EGR, CCMR1, CCMR2, CCER, CNT, PSC, ARR, RCR;
+    volatile uint32_t CCR[4];
+} stm32_tim_t;
+
+#define STM32_TIM_CR1_CEN    (1u << 0)
+#define STM32_TIM_CR1_OPM    (1u << 3)
+#define STM32_TIM_DIER_UIE   (1u << 0)
+#define STM32_TIM_DIER_CC1DE (1u << 9)
+#define STM32_TIM_DIER_CC4DE (1u << 12)
+#define STM32_TIM_EGR_UG     (1u << 0)
+#define STM32_TIM_SR_UIF     (1u << 0)
+
+#define PWM_OUTPUT_DISABLED    0
+#define PWM_OUTPUT_ACTIVE_HIGH 1
+#define PWM_OUTPUT_ACTIVE_LOW  2
+
+struct PWMDriver;
+typedef void (*pwmcallback_t)(struct PWMDriver *pwmp);
+
+typedef struct PWMChannelConfig {
+    uint32_t mode;
+    pwmcallback_t callback;
+} PWMChannelConfig;
+
+typedef struct PWMConfig {
+    uint32_t frequency;
+    uint32_t period;
+    pwmcallback_t callback;
+    PWMChannelConfig channels[4];
+    uint32_t cr2;
+    uint32_t dier;
+} PWMConfig;
+
+typedef struct PWMDriver {
+    stm32_tim_t *tim;
+    const PWMConfig *config;
+    uint32_t period;
+    bool notify;            ///< Periodic notification enabled
+} PWMDriver;
+
+extern PWMDriver PWMD4;
+
+void pwmStart(PWMDriver *pwmp, const PWMConfig *config);
+void pwmEnableChannel(PWMDriver *pwmp, uint32_t channel, uint32_t width);
+void pwmDisableChannelI(PWMDriver *pwmp, uint32_t channel);
+void pwmChangePeriodI(PWMDriver *pwmp, uint32_t period);
+void pwmEnablePeriodicNotificationI(PWMDriver *pwmp);
+void pwmDisablePeriodicNotificationI(PWMDriver *pwmp);
+bool pwmIsChannelEnabledI(PWMDriver *pwmp, uint32_t channel);
+
+#include "stm32_dma.h"
@@ -0,0 +1,184 @@
+/**
+ *******************************************
+ * @file    host_hal.c
+ * @brief   Host stand-ins of ChibiOS kernel & HAL functions
+ *******************************************
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "hal.h"
+#include "board.h"
+#include "chprintf.h"
+
+static stm32_tim_t host_tim4;
+PWMDriver PWMD4 = {&host_tim4, NULL, 0, false};
+
+static DMA_Stream_TypeDef host_dma_regs;
+const stm32_dma_stream_t host_dma = {&host_dma_regs};
+stm32_dmaisr_t host_dma_isr = NULL;
+void *host_dma_param = NULL;
+
+systime_t host_time = 0;
+void (*host_sleep_hook)(void) = NULL;
+
+void pwmStart(PWMDriver *pwmp, const PWMConfig *config)
+{
+    pwmp->config = config;
+    pwmp->period = config->period;
+}
+
+void pwmEnableChannel(PWMDriver *pwmp, uint32_t channel, uint32_t width)
+{
+    pwmp->tim->CCR[channel] = width;
+}
+
+void pwmDisableChannelI(PWMDriver *pwmp, uint32_t channel)
+{
+    pwmp->tim->CCR[channel] = 0;
+}
+
+void pwmChangePeriodI(PWMDriver *pwmp, uint32_t period)
+{
+    pwmp->period = period;
+    pwmp->tim->ARR = period - 1;
+}
+
+void pwmEnablePeriodicNotificationI(PWMDriver *pwmp)
+{
+    pwmp->notify = true;
+}
+
+void pwmDisablePeriodicNotificationI(PWMDriver *pwmp)
+{
+    pwmp->notify = false;
+}
+
+bool pwmIsChannelEnabledI(PWMDriver *pwmp, uint32_t channel)
+{
+    (void) pwmp;
+    (void) channel;
+    return false;
+}
+
+bool dmaStreamAllocate(const stm32_dma_stream_t *dmastp, uint32_t priority, stm32_dmaisr_t func, void *param)
+{
+    (void) dmastp;
+    (void) priority;
+    host_dma_isr = func;
+    host_dma_param = param;
+    return false;
+}
+
+systime_t chVTGetSystemTimeX(void)
+{
+    return host_time;
+}
+
+sysinterval_t chVTTimeElapsedSinceX(systime_t start)
+{
+    return host_time - start;
+}
+
+/// Nanoseconds, stands for the DWT cycle counter
+rtcnt_t chSysGetRealtimeCounterX(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (rtcnt_t) ((uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec);
+}
+
+void chSysLock(void) {}
+void chSysUnlock(void) {}
+void chSysLockFromISR(void) {}
+void chSysUnlockFromISR(void) {}
+syssts_t chSysGetStatusAndLockX(void) { return 0; }
+void chSysRestoreStatusX(syssts_t sts) { (void) sts; }
+
+void chSemObjectInit(semaphore_t *sp, cnt_t n)
+{
+    sp->cnt = n;
+}
+
+msg_t chSemWaitS(semaphore_t *sp)
+{
+    sp->cnt--;
+    return MSG_OK;
+}
+
+msg_t chSemWait(semaphore_t *sp)
+{
+    return chSemWaitS(sp);
+}
+
+void chSemAddCounterI(semaphore_t *sp, cnt_t n)
+{
+    sp->cnt += n;
+}
+
+thread_t *chThdCreateStatic(void *wsp, size_t size, tprio_t prio, tfunc_t pf, void *arg)
+{
+    (void) wsp;
+    (void) size;
+    (void) prio;
+    (void) pf;
+    (void) arg;
+    return NULL;
+}
+
+void chThdSleep(sysinterval_t time)
+{
+    host_time += time;
+    if (host_sleep_hook != NULL)
+        host_sleep_hook();
+}
+
+systime_t chThdSleepUntilWindowed(systime_t prev, systime_t next)
+{
+    (void) prev;
+    if ((int32_t) (next - host_time) > 0)
+        host_time = next;
+    if (host_sleep_hook != NULL)
+        host_sleep_hook();
+    return next;
+}
+
+void chRegSetThreadName(const char *name)
+{
+    (void) name;
+}
+
+void *chHeapAllocAligned(memory_heap_t *heapp, size_t size, unsigned align)
+{
+    void *p = NULL;
+    (void) heapp;
+    return posix_memalign(&p, (align < sizeof(void *)) ? sizeof(void *) : align, size) ? NULL : p;
+}
+
+void chHeapFree(void *p)
+{
+    free(p);
+}
+
+__attribute__((weak)) size_t chnReadTimeout(BaseChannel *chn, uint8_t *buf, size_t n, sysinterval_t timeout)
+{
+    (void) chn;
+    (void) buf;
+    (void) n;
+    (void) timeout;
+    return 0;
+}
+
+int chprintf(BaseSequentialStream *chp, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    (void) chp;
+    va_start(ap, fmt);
+    n = vprintf(fmt, ap);
+    va_end(ap);
+    return n;
+}
@@ -0,0 +1,63 @@
+/**
+ *******************************************
+ * @file    stm32_dma.h
+ * @brief   Host stand-in of ChibiOS STM32 DMAv2 stream API
+ *******************************************
+ *
+ * Registers only hold what the driver writes, Tests/sim.h moves
+ * NDTR and CT and raises the interrupts like the stream would.
+ */
+
+#pragma once
+
+#include "ch.h"
+
+typedef struct DMA_Stream_TypeDef {
+    volatile uint32_t CR;
+    volatile uint32_t NDTR;
+    volatile uintptr_t PAR, M0AR, M1AR; ///< Host pointers don't fit 32 bits
+    volatile uint32_t FCR;
+    uint32_t len;                        ///< Programmed NDTR, reloaded in circular mode
+} DMA_Stream_TypeDef;
+
+typedef void (*stm32_dmaisr_t)(void *p, uint32_t flags);
+
+typedef struct stm32_dma_stream {
+    DMA_Stream_TypeDef *stream;
+} stm32_dma_stream_t;
+
+#define STM32_DMA_CR_EN          (1u << 0)
+#define STM32_DMA_CR_TCIE        (1u << 4)
+#define STM32_DMA_CR_HTIE        (1u << 3)
+#define STM32_DMA_CR_DIR_M2P     (1u << 6)
+#define STM32_DMA_CR_CIRC        (1u << 8)
+#define STM32_DMA_CR_MINC        (1u << 10)
+#define STM32_DMA_CR_PSIZE_BYTE  (0u << 11)
+#define STM32_DMA_CR_PSIZE_HWORD (1u << 11)
+#define STM32_DMA_CR_PSIZE_WORD  (2u << 11)
+#define STM32_DMA_CR_MSIZE_BYTE  (0u << 13)
+#define STM32_DMA_CR_MSIZE_HWORD (1u << 13)
+#define STM32_DMA_CR_MSIZE_WORD  (2u << 13)
+#define STM32_DMA_CR_DBM         (1u << 18)
+#define STM32_DMA_CR_CT          (1u << 19)
+#define STM32_DMA_CR_CHSEL(n)    ((uint32_t) (n) << 25)
+
+#define STM32_DMA_ISR_HTIF (1u << 4)
+#define STM32_DMA_ISR_TCIF (1u << 5)
+
+extern stm32_dmaisr_t host_dma_isr; ///< Handler given to dmaStreamAllocate
+extern void *host_dma_param;
+
+bool dmaStreamAllocate(const stm32_dma_stream_t *dmastp, uint32_t priority, stm32_dmaisr_t func, void *param);
+
+#define dmaStreamSetPeripheral(dmastp, addr) ((dmastp)->stream->PAR = (uintptr_t) (addr))
+#define dmaStreamSetMemory0(dmastp, addr) ((dmastp)->stream->M0AR = (uintptr_t) (addr))
+#define dmaStreamSetMemory1(dmastp, addr) ((dmastp)->stream->M1AR = (uintptr_t) (addr))
+#define dmaStreamSetTransactionSize(dmastp, size) \
+    ((dmastp)->stream->NDTR = (dmastp)->stream->len = (uint32_t) (size))
+#define dmaStreamGetTransactionSize(dmastp) ((size_t) (dmastp)->stream->NDTR)
+#define dmaStreamSetMode(dmastp, mode) ((dmastp)->stream->CR = (uint32_t) (mode))
+#define dmaStreamEnable(dmastp) ((dmastp)->stream->CR |= STM32_DMA_CR_EN)
+#define dmaStreamDisable(dmastp) \
+    ((dmastp)->stream->CR &= ~(STM32_DMA_CR_TCIE | STM32_DMA_CR_HTIE | STM32_DMA_CR_EN))
+#define dmaStreamClearInterrupt(dmastp) ((void) (dmastp))
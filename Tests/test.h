@@ -0,0 +1,32 @@
+/**
+ *******************************************
+ * @file    test.h
+ * @brief   Check macros of host tests
+ *******************************************
+ *
+ * A failed check prints its location and the test goes on,
+ * TEST_END() gives the exit code.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+static int test_fails = 0; ///< Failed checks
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            if (test_fails++ < 20) \
+                printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) do { \
+        long long _a = (long long) (a), _b = (long long) (b); \
+        if (_a != _b) { \
+            if (test_fails++ < 20) \
+                printf("%s:%d: %s == %s failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+        } \
+    } while (0)
+
+#define TEST_END() (printf("%s: %s\n", __FILE__, test_fails ? "FAILED" : "ok"), test_fails != 0)
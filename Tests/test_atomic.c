@@ -0,0 +1,171 @@
+/**
+ *******************************************
+ * @file    test_atomic.c
+ * @brief   ARGB_FMT_ATOMIC pixels written from several threads
+ *******************************************
+ *
+ * RGB threads write overlapping LEDs and ranges while another one
+ * keeps rewriting white and one more moves spans around. Built with
+ * ThreadSanitizer, so any plain access shared between writers is
+ * reported. Afterwards no LED may hold parts of two writes, no white
+ * may be lost to an RGB write and the power sums must match the
+ * buffer, so a move never drops a write that lands during it.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include "ARGB.c"
+#include "test.h"
+
+static const argb_segment segs[] = {
+    // start, length, order,          bpp, chip
+    {  0,     20,     ARGB_ORDER_GRB, 3,   ARGB_CHIP_WS2812},
+    { 20,     20,     ARGB_ORDER_RGB, 4,   ARGB_CHIP_SK6812},
+    { 40,     20,     ARGB_ORDER_BRG, 3,   ARGB_CHIP_WS2811F},
+};
+#define LEDS 60
+#define RGB_THREADS 3
+
+static volatile bool white_done = false;
+static volatile bool move_done = false;
+
+/// G and B of an LED written as (x, x, x)
+static uint8_t gamma_g(uint8_t x)
+{
+#if USE_GAMMA_CORRECTION
+    return scale8(x, 0xB0);
+#else
+    return x;
+#endif
+}
+
+static uint8_t gamma_b(uint8_t x)
+{
+#if USE_GAMMA_CORRECTION
+    return scale8(x, 0xF0);
+#else
+    return x;
+#endif
+}
+
+static void *rgb_thread(void *arg)
+{
+    unsigned seed = (unsigned) (uintptr_t) arg;
+    uint32_t ops = 0;
+
+    while (!__atomic_load_n(&white_done, __ATOMIC_RELAXED) || (ops < 20000))
+    {
+        uint8_t x = rand_r(&seed);
+        uint16_t a = rand_r(&seed) % LEDS;
+        uint16_t b = a + rand_r(&seed) % (LEDS - a);
+
+        switch (rand_r(&seed) % 3)
+        {
+            case 0:
+                argb_set_rgb(a, x, x, x);
+                break;
+            case 1:
+                argb_fill_rgb_range(a, b, x, x, x);
+                break;
+            default:
+            {
+                uint8_t px[3 * 8];
+                uint16_t n = 1 + rand_r(&seed) % 8;
+                for (uint16_t k = 0; k < n; k++)
+                {
+                    px[3 * k] = x + k;
+                    px[3 * k + 1] = gamma_g(x + k);
+                    px[3 * k + 2] = gamma_b(x + k);
+                }
+                argb_write_rgb(a, px, n);
+                break;
+            }
+        }
+        ops++;
+    }
+    return NULL;
+}
+
+static void *move_thread(void *arg)
+{
+    unsigned seed = (unsigned) (uintptr_t) arg;
+
+    for (uint32_t ops = 0; ops < 20000; ops++)
+    {
+        uint16_t src = rand_r(&seed) % LEDS;
+        uint16_t dst = rand_r(&seed) % LEDS;
+        argb_move(dst, src, 1 + rand_r(&seed) % 16);
+    }
+    __atomic_store_n(&move_done, true, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static void *white_thread(void *arg)
+{
+    unsigned seed = (unsigned) (uintptr_t) arg;
+
+    for (uint32_t ops = 0; ops < 20000; ops++)
+    {
+        uint16_t a = rand_r(&seed) % LEDS;
+        if (rand_r(&seed) & 1)
+            argb_set_white(a, rand_r(&seed));
+        else
+            argb_fill_white_range(a, a + rand_r(&seed) % (LEDS - a), rand_r(&seed));
+    }
+    // last values, RGB threads are still running, moves would carry
+    // white to other LEDs
+    while (!__atomic_load_n(&move_done, __ATOMIC_RELAXED))
+        sched_yield();
+    for (uint16_t i = 0; i < LEDS; i++)
+        argb_set_white(i, 3 * i);
+    __atomic_store_n(&white_done, true, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t th[RGB_THREADS + 2];
+
+    argb_init();
+    argb_set_brightness(255);
+    CHECK_EQ(argb_init_segments(segs, 3), ARGB_OK);
+
+    for (uintptr_t t = 0; t < RGB_THREADS; t++)
+        pthread_create(&th[t], NULL, rgb_thread, (void *) (t + 1));
+    pthread_create(&th[RGB_THREADS], NULL, white_thread, (void *) 100);
+    pthread_create(&th[RGB_THREADS + 1], NULL, move_thread, (void *) 200);
+    for (int t = 0; t < RGB_THREADS + 2; t++)
+        pthread_join(th[t], NULL);
+
+    for (uint16_t i = 0; i < LEDS; i++)
+    {
+        const argb_seg *seg = argb_find_seg(i);
+        uint8_t c[4];
+
+        argb_read_px(seg, i, c);
+        CHECK_EQ(c[1], gamma_g(c[0]));
+        CHECK_EQ(c[2], gamma_b(c[0]));
+        if (seg->bpp == 4)
+            CHECK_EQ(c[3], (uint8_t) (3 * i));
+    }
+
+#if ARGB_USE_POWER_LIMIT
+    for (uint8_t s = 0; s < argb_seg_count; s++)
+    {
+        const argb_seg *seg = &argb_segs[s];
+        uint32_t sum[4] = {0, 0, 0, 0};
+
+        for (uint16_t i = seg->start; i < seg->end; i++)
+        {
+            uint8_t c[4];
+            argb_read_px(seg, i, c);
+            for (uint8_t k = 0; k < 4; k++)
+                sum[k] += c[k];
+        }
+        for (uint8_t k = 0; k < 4; k++)
+            CHECK_EQ(seg->sum[k], sum[k]);
+    }
+#endif
+    return TEST_END();
+}
@@ -0,0 +1,238 @@
+/**
+ *******************************************
+ * @file    test_color.c
+ * @brief   HSV to RGB to HSV round trip and the rgb2hsv tables
+ *******************************************
+ *
+ * rgb2hsv_approximate() takes its square roots and reciprocals from
+ * sqrt16_x256() and recip16(). The tables are checked against the
+ * expressions they replace, and the function against a copy of the
+ * one with the search and divisions, over every RGB colour and over
+ * colours coming from hsv2rgb_spectrum().
+ *
+ * The approximation undoes the dimmed rainbow, not the spectrum, so
+ * a spectrum colour doesn't come back at its own hue and no error
+ * bound follows from the maths. Round trips of vivid colours at the
+ * spectrum's primaries, secondaries and between them are pinned
+ * instead, a second pass included: a change of either conversion
+ * shows up there.
+ */
+
+#include "ARGB.c"
+#include "test.h"
+
+/// rgb2hsv_approximate() as it was before the tables
+static hsv_t rgb2hsv_reference(const rgb_t rgb)
+{
+    uint8_t r = rgb.r;
+    uint8_t g = rgb.g;
+    uint8_t b = rgb.b;
+    uint8_t h, s, v;
+    
+    // find desaturation
+    uint8_t desat = 255;
+    if( r < desat) desat = r;
+    if( g < desat) desat = g;
+    if( b < desat) desat = b;
+    
+    // remove saturation from all channels
+    r -= desat;
+    g -= desat;
+    b -= desat;
+    
+    //uint8_t orig_desat = sqrt16( desat * 256);
+    
+    // saturation is opposite of desaturation
+    s = 255 - desat;
+    
+    if( s != 255 ) {
+        // undo 'dimming' of saturation
+        s = 255 - sqrt16( (255-s) * 256);
+    }
+    // without lib8tion: float ... ew ... sqrt... double ew, or rather, ew ^ 0.5
+    // if( s != 255 ) s = (255 - (256.0 * sqrt( (float)(255-s) / 256.0)));
+    
+    
+    // at least one channel is now zero
+    // if all three channels are zero, we had a
+    // shade of gray.
+    if( (r + g + b) == 0) {
+        // we pick hue zero for no special reason
+        hsv_t hsv = {.h=0, .s=0, .v=255-s};
+        return hsv;
+    }
+    
+    // scale all channels up to compensate for desaturation
+    if( s < 255) {
+        if( s == 0) s = 1;
+        uint32_t scaleup = 65535 / (s);
+        r = ((uint32_t)(r) * scaleup) / 256;
+        g = ((uint32_t)(g) * scaleup) / 256;
+        b = ((uint32_t)(b) * scaleup) / 256;
+    }
+
+    uint16_t total = r + g + b;
+    
+    // scale all channels up to compensate for low values
+    if( total < 255) {
+        if( total == 0) total = 1;
+        uint32_t scaleup = 65535 / (total);
+        r = ((uint32_t)(r) * scaleup) / 256;
+        g = ((uint32_t)(g) * scaleup) / 256;
+        b = ((uint32_t)(b) * scaleup) / 256;
+    }
+    
+    if( total > 255 ) {
+        v = 255;
+    } else {
+        v = qadd8(desat,total);
+        // undo 'dimming' of brightness
+        if( v != 255) v = sqrt16( v * 256);
+        // without lib8tion: float ... ew ... sqrt... double ew, or rather, ew ^ 0.5
+        // if( v != 255) v = (256.0 * sqrt( (float)(v) / 256.0));
+        
+    }
+    
+    // since this wasn't a pure shade of gray,
+    // the interesting question is what hue is it    
+    
+    // start with which channel is highest
+    // (ties don't matter)
+    uint8_t highest = r;
+    if( g > highest) highest = g;
+    if( b > highest) highest = b;
+    
+    if( highest == r ) {
+        // Red is highest.
+        // Hue could be Purple/Pink-Red,Red-Orange,Orange-Yellow
+        if( g == 0 ) {
+            // if green is zero, we're in Purple/Pink-Red
+            h = (HUE_PURPLE + HUE_PURPLE) / 2;
+            h += scale8( qsub8(r, 128), FIXFRAC8(48,128));
+        } else if ( (r - g) > g) {
+            // if R-G > G then we're in Red-Orange
+            h = HUE_RED;
+            h += scale8( g, FIXFRAC8(32,85));
+        } else {
+            // R-G < G, we're in Orange-Yellow
+            h = HUE_YELLOW;
+            h += scale8( qsub8((g - 85) + (171 - r), 4), FIXFRAC8(32,85)); //221
+        }
+        
+    } else if ( highest == g) {
+        // Green is highest
+        // Hue could be Yellow-Green, Green-Aqua
+        if( b == 0) {
+            // if Blue is zero, we're in Yellow-Green
+            //   G = 171..255
+            //   R = 171..  0
+            h = HUE_YELLOW;
+            uint8_t radj = scale8( qsub8(171,r),   47); //171..0 -> 0..171 -> 0..31
+            uint8_t gadj = scale8( qsub8(g,171),   96); //171..255 -> 0..84 -> 0..31;
+            uint8_t rgadj = radj + gadj;
+            uint8_t hueadv = rgadj / 2;
+            h += hueadv;
+            //h += scale8( qadd8( 4, qadd8((g - 128), (128 - r))),
+            //             FIXFRAC8(32,255)); //
+        } else {
+            // if Blue is nonzero we're in Green-Aqua
+            if( (g-b) > b) {
+                h = HUE_GREEN;
+                h += scale8( b, FIXFRAC8(32,85));
+            } else {
+                h = HUE_AQUA;
+                h += scale8( qsub8(b, 85), FIXFRAC8(8,42));
+            }
+        }
+        
+    } else /* highest == b */ {
+        // Blue is highest
+        // Hue could be Aqua/Blue-Blue, Blue-Purple, Purple-Pink
+        if( r == 0) {
+            // if red is zero, we're in Aqua/Blue-Blue
+            h = HUE_AQUA + ((HUE_BLUE - HUE_AQUA) / 4);
+            h += scale8( qsub8(b, 128), FIXFRAC8(24,128));
+        } else if ( (b-r) > r) {
+            // B-R > R, we're in Blue-Purple
+            h = HUE_BLUE;
+            h += scale8( r, FIXFRAC8(32,85));
+        } else {
+            // B-R < R, we're in Purple-Pink
+            h = HUE_PURPLE;
+            h += scale8( qsub8(r, 85), FIXFRAC8(32,85));
+        }
+    }
+    
+    h += 1;
+    hsv_t hsv = {.h=h, .s=s, .v=v};
+    return hsv;
+}
+
+/// HSV in, HSV back, HSV after a second pass
+static const uint8_t round_trips[][9] = {
+    {  0, 255, 255,    5, 255, 253,    5, 255, 251},
+    { 21, 255, 255,   23, 255, 252,   26, 255, 251},
+    { 43, 255, 255,   47, 255, 252,   48, 255, 251},
+    { 85, 255, 255,   74, 255, 253,   65, 255, 251},
+    {107, 255, 255,  108, 255, 252,  110, 255, 251},
+    {128, 255, 255,  136, 255, 252,  143, 255, 251},
+    {150, 255, 192,  150, 255, 219,  150, 255, 234},
+    {171, 255, 255,  162, 255, 253,  157, 255, 251},
+    {192, 255, 255,  194, 255, 252,  196, 255, 251},
+    {213, 255, 255,  227, 255, 252,  228, 255, 251},
+};
+
+static int same_hsv(hsv_t a, hsv_t b)
+{
+    return a.h == b.h && a.s == b.s && a.v == b.v;
+}
+
+int main(void)
+{
+    for (uint16_t k = 0; k < 256; k++)
+    {
+        CHECK_EQ(sqrt16_x256(k), sqrt16(k * 256));
+        CHECK_EQ(recip16(k), 65535 / (k ? k : 1));
+    }
+
+    // every colour, table path against the search and divisions
+    uint32_t diff = 0;
+    for (uint32_t c = 0; c < (1u << 24); c++)
+    {
+        rgb_t rgb = {.r = c >> 16, .g = c >> 8, .b = c};
+        if (!same_hsv(rgb2hsv_approximate(rgb), rgb2hsv_reference(rgb)))
+            diff++;
+    }
+    CHECK_EQ(diff, 0);
+
+    // spectrum colours, table path against the search and divisions
+    for (uint32_t c = 0; c < (1u << 24); c++)
+    {
+        hsv_t hsv = {.h = c >> 16, .s = c >> 8, .v = c};
+        rgb_t rgb;
+
+        hsv2rgb_spectrum(hsv, &rgb);
+        if (!same_hsv(rgb2hsv_approximate(rgb), rgb2hsv_reference(rgb)))
+            diff++;
+    }
+    CHECK_EQ(diff, 0);
+
+    // HSV -> RGB -> HSV, twice
+    for (size_t k = 0; k < sizeof(round_trips) / sizeof(round_trips[0]); k++)
+    {
+        const uint8_t *t = round_trips[k];
+        hsv_t hsv = {.h = t[0], .s = t[1], .v = t[2]};
+        rgb_t rgb;
+
+        for (uint8_t pass = 1; pass <= 2; pass++)
+        {
+            hsv2rgb_spectrum(hsv, &rgb);
+            hsv = rgb2hsv_approximate(rgb);
+            CHECK_EQ(hsv.h, t[3 * pass]);
+            CHECK_EQ(hsv.s, t[3 * pass + 1]);
+            CHECK_EQ(hsv.v, t[3 * pass + 2]);
+        }
+    }
+
+    return TEST_END();
+}
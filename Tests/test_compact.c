@@ -0,0 +1,70 @@
+/**
+ *******************************************
+ * @file    test_compact.c
+ * @brief   Compact pixel formats on a chain of 3 and 4 byte LEDs
+ *******************************************
+ *
+ * Compact buffers are expanded one LED at a time while encoding.
+ * Every segment border changes the LED size, wire bytes of each
+ * LED must still come out in its own segment's order.
+ */
+
+#include <stdlib.h>
+#include "ARGB.c"
+#include "test.h"
+#include "sim.h"
+
+static const argb_segment segs[] = {
+    // start, length, order,          bpp, chip
+    {  0,     5,      ARGB_ORDER_GRB, 3,   ARGB_CHIP_WS2812},
+    {  5,     4,      ARGB_ORDER_BRG, 4,   ARGB_CHIP_SK6812},
+    {  9,     3,      ARGB_ORDER_RGB, 3,   ARGB_CHIP_WS2811F},
+    { 12,     2,      ARGB_ORDER_GRB, 4,   ARGB_CHIP_SK6812},
+};
+#define LEDS 14
+
+int main(void)
+{
+    static uint8_t wire[4 * LEDS], want[4 * LEDS];
+
+    srand(32);
+    argb_init();
+    argb_set_brightness(255);
+    CHECK_EQ(argb_init_segments(segs, 4), ARGB_OK);
+
+    for (int frame = 0; frame < 8; frame++)
+    {
+#ifdef ARGB_PALETTE_SIZE
+        for (uint16_t k = 0; k < ARGB_PALETTE_SIZE; k++)
+            argb_set_palette(k, rand(), rand(), rand(), rand());
+        for (uint16_t i = 0; i < LEDS; i++)
+            argb_set_index(i, rand() % ARGB_PALETTE_SIZE);
+#else
+        for (uint16_t i = 0; i < LEDS; i++)
+        {
+            argb_set_rgb(i, rand(), rand(), rand());
+            argb_set_white(i, rand());
+        }
+#endif
+        // wire bytes from what the buffer holds
+        for (uint8_t s = 0; s < argb_seg_count; s++)
+        {
+            const argb_seg *seg = &argb_segs[s];
+            for (uint16_t i = seg->start; i < seg->end; i++)
+            {
+                uint8_t *px = &want[seg->offset + (i - seg->start) * seg->bpp];
+                rgb_t c = argb_get_rgb(i);
+                px[seg->map[0]] = c.r;
+                px[seg->map[1]] = c.g;
+                px[seg->map[2]] = c.b;
+                if (seg->bpp == 4)
+                    px[3] = argb_get_white(i);
+            }
+        }
+
+        CHECK(sim_show(wire) >= ARGB_LATCH_ZEROS);
+        CHECK_EQ(argb_total_bytes, 3 * 8 + 4 * 6);
+        CHECK(memcmp(wire, want, argb_total_bytes) == 0);
+    }
+    return TEST_END();
+}
@@ -0,0 +1,211 @@
+/**
+ *******************************************
+ * @file    test_cpp.cpp
+ * @brief   C++ chain layout over the C driver
+ *******************************************
+ *
+ * The segment table is checked at compile time, strip objects must
+ * reach their own LEDs of the chain and never the neighbour's. Strip
+ * setters must leave the pixel buffer as the C setters at the chain
+ * positions do, whether they write it themselves or not, and the
+ * chain's encoder must put the slots of the segment table encoder on
+ * the wire.
+ */
+
+#include "ARGB.hpp"
+#include <stdlib.h>
+#include <string.h>
+extern "C" {
+#include "stm32_dma.h"
+}
+#include "test.h"
+#include "sim.h"
+
+using Desk = argb::Strip<argb::Ws2812, 10, argb::GRB>;
+using Shelf = argb::Strip<argb::Sk6812, 6, argb::GRBW>;
+using Tail = argb::Strip<argb::Ws2811Fast, 4, argb::BRG>;
+using Leds = argb::Chain<Desk, Shelf, Tail>;
+
+static_assert(Leds::count == 3, "");
+static_assert(Leds::num_leds == 20, "");
+static_assert(Leds::table.bytes == 10 * 3 + 6 * 4 + 4 * 3, "");
+static_assert((Leds::table.seg[1].start == 10) && (Leds::table.seg[1].bpp == 4), "");
+static_assert((Leds::table.seg[2].start == 16) && (Leds::table.seg[2].order == ARGB_ORDER_BRG), "");
+static_assert(Leds::table.seg[2].chip == ARGB_CHIP_WS2811F, "");
+static_assert(decltype(Leds::strip<2>())::first == 16, "");
+static_assert(decltype(Leds::strip<2>())::offset == 10 * 3 + 6 * 4, "");
+static_assert((Leds::table.offset[1] == 30) && (Leds::table.offset[3] == Leds::table.bytes), "");
+static_assert((argb::GRB::r == 1) && (argb::GRB::g == 0) && (argb::BRG::b == 0), "");
+static_assert(argb::Ws2812::hi == ARGB_PWM_HI(ARGB_WS2812), "");
+static_assert(argb::Ws2811Slow::lo == ARGB_PWM_LO(ARGB_WS2811S), "");
+static_assert(Leds::table.timing_ok, "");
+
+#define BYTES (Leds::table.bytes)
+
+static uint8_t snap[BYTES]; ///< Pixel buffer after strip calls
+
+static bool same(rgb_t a, rgb_t b)
+{
+    return (a.r == b.r) && (a.g == b.g) && (a.b == b.b);
+}
+
+/// Buffer after strip calls against the one after C calls
+static void check_setters(void)
+{
+    auto desk = Leds::strip<0>();
+    auto shelf = Leds::strip<1>();
+    auto tail = Leds::strip<2>();
+
+    for (int rep = 0; rep < 200; rep++)
+    {
+        uint8_t r = rand(), g = rand(), b = rand(), w = rand(), h = rand();
+        uint16_t i = rand() % 12;
+        uint8_t px[4 * 3];
+
+        for (uint8_t k = 0; k < sizeof(px); k++)
+            px[k] = rand();
+        Leds::set_brightness(rep < 100 ? 255 : rand());
+
+        Leds::clear();
+        desk.set_rgb(i, r, g, b);
+        shelf.set_rgb(i, g, b, r);
+        shelf.set_white(i, w);
+        tail.fill_rgb(b, r, g);
+        tail.set_hsv(i, h, g, r);
+        desk.fill_hsv(h, 255, b);
+        desk.write_rgb(i, px, 4);
+        shelf.write_rgb(3, px, 4);
+        shelf.fill_white(w ^ 0x55);
+        shelf.set_white(i, w);
+        memcpy(snap, (const uint8_t *) rgb_buf, BYTES);
+
+        argb_fill_rgb(0, 0, 0);
+        argb_fill_white(0);
+        if (i < 10)
+            argb_set_rgb(i, r, g, b);
+        if (i < 6)
+            argb_set_rgb(10 + i, g, b, r);
+        if (i < 6)
+            argb_set_white(10 + i, w);
+        argb_fill_rgb_range(16, 19, b, r, g);
+        if (i < 4)
+            argb_set_hsv(16 + i, (hsv_hue) h, g, r);
+        argb_fill_hsv_range(0, 9, (hsv_hue) h, 255, b);
+        if (i < 10)
+            argb_write_rgb(i, px, (i + 4 <= 10) ? 4 : 10 - i);
+        argb_write_rgb(13, px, 3);
+        argb_fill_white_range(10, 15, w ^ 0x55);
+        if (i < 6)
+            argb_set_white(10 + i, w);
+        CHECK(memcmp(snap, (const uint8_t *) rgb_buf, BYTES) == 0);
+
+        for (uint16_t k = 0; k < 6; k++)
+            CHECK(same(shelf.get_rgb(k), argb_get_rgb(10 + k)));
+    }
+}
+
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+/// Slots of the chain's encoder against the segment table encoder
+static void check_encoder(void)
+{
+    static uint32_t own[SIM_MAX_SLOTS];
+    size_t n;
+
+    for (int rep = 0; rep < 20; rep++)
+    {
+        for (uint16_t k = 0; k < BYTES; k++)
+            rgb_buf[k] = rand();
+
+        // init() left the chain's encoder in place
+        CHECK_EQ(Leds::show(), ARGB_OK);
+        n = sim_frame();
+        memcpy(own, sim_slots, n * sizeof(own[0]));
+
+        argb_set_encoder(NULL);
+        CHECK_EQ(Leds::show(), ARGB_OK);
+        CHECK_EQ(sim_frame(), n);
+        CHECK(memcmp(own, sim_slots, n * sizeof(own[0])) == 0);
+
+        // wire bits of every strip at its chip's compile-time values
+        for (uint8_t s = 0; s < Leds::count; s++)
+        {
+            const dma_siz hi[] = {argb::Ws2812::hi, argb::Sk6812::hi, argb::Ws2811Fast::hi};
+            const dma_siz lo[] = {argb::Ws2812::lo, argb::Sk6812::lo, argb::Ws2811Fast::lo};
+
+            for (uint32_t b = Leds::table.offset[s]; b < Leds::table.offset[s + 1]; b++)
+                for (uint8_t i = 0; i < 8; i++)
+                    CHECK_EQ(own[b * 8 + i], ((rgb_buf[b] << i) & 0x80) ? hi[s] : lo[s]);
+        }
+        for (size_t k = BYTES * 8; k < n; k++)
+            CHECK_EQ(own[k], 0);
+
+        // and back for the next frame
+        argb_set_encoder(Leds::encoder());
+    }
+}
+#endif
+
+int main(void)
+{
+    const rgb_t off = {};
+    auto desk = Leds::strip<0>();
+    auto shelf = Leds::strip<1>();
+    auto tail = Leds::strip<2>();
+
+    CHECK_EQ(Leds::init(), ARGB_OK);
+    CHECK_EQ(argb_get_num_leds(), 20);
+    Leds::set_brightness(255);
+
+    // strip positions are offset into the chain
+    shelf.set_rgb(2, 10, 20, 30);
+    argb_set_rgb(0, 10, 20, 30);
+#if !ARGB_WHITE_EXTRACT // RGBW LED keeps part of it as white
+    CHECK(same(argb_get_rgb(12), argb_get_rgb(0)));
+#endif
+    CHECK(same(shelf.get_rgb(2), argb_get_rgb(12)));
+    shelf.set_white(2, 77);
+    CHECK_EQ(argb_get_white(12), 77);
+
+    // nothing past the strip end
+    shelf.set_rgb(6, 1, 2, 3);
+    shelf.set_white(6, 1);
+    CHECK(same(argb_get_rgb(16), off));
+    CHECK(same(shelf.get_rgb(6), off));
+
+    tail.fill_rgb(40, 50, 60);
+    CHECK(same(argb_get_rgb(15), off));
+    for (uint16_t i = 16; i < 20; i++)
+        CHECK(same(argb_get_rgb(i), tail.get_rgb(0)));
+    CHECK(!same(tail.get_rgb(3), off));
+
+    const uint8_t px[5 * 3] = {1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5, 5, 5};
+    CHECK_EQ(desk.write_rgb(8, px, 5), 2);
+    CHECK_EQ(argb_get_rgb(9).r, 2);
+    CHECK(same(argb_get_rgb(10), off));
+
+    shelf.fill_white(9);
+    CHECK_EQ(argb_get_white(10), 9);
+    CHECK_EQ(argb_get_white(15), 9);
+
+    shelf.clear();
+    CHECK(same(argb_get_rgb(12), off));
+    CHECK_EQ(argb_get_white(12), 0);
+    CHECK(same(argb_get_rgb(9), desk.get_rgb(9)));
+    CHECK(!same(argb_get_rgb(9), off));
+
+    Leds::clear();
+    for (uint16_t i = 0; i < 20; i++)
+        CHECK(same(argb_get_rgb(i), off) && (argb_get_white(i) == 0));
+
+    CHECK_EQ(Leds::show(), ARGB_OK);
+    CHECK_EQ(Leds::ready(), ARGB_BUSY);
+    sim_frame();
+    CHECK_EQ(Leds::ready(), ARGB_READY);
+
+    srand(41);
+    check_setters();
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+    check_encoder();
+#endif
+    return TEST_END();
+}
@@ -0,0 +1,90 @@
+/**
+ *******************************************
+ * @file    test_dbm.c
+ * @brief   Double-buffer mode against the circular half encoder
+ *******************************************
+ *
+ * The stream switches buffers on CT and each buffer end refills the
+ * one just left. Chains end their data in either buffer and at any
+ * LED of it; the slots DMA read must be the ones the encoder gives
+ * when run from the chain start in one go, followed by the latch.
+ */
+
+#include <stdlib.h>
+#include "ARGB.c"
+#include "test.h"
+#include "sim.h"
+
+#if !ARGB_USE_DBM
+#error Build with ARGB_USE_DBM=1
+#endif
+
+static uint32_t want[SIM_MAX_SLOTS];
+
+/// Slots of the whole chain from the encoder, no buffers involved
+static size_t encode_all(void)
+{
+    static dma_siz slots[PWM_HALF_LEN];
+    size_t n = 0;
+
+    argb_enc_rewind();
+    while (enc_byte < argb_total_bytes)
+    {
+        uint16_t zeros = argb_fill_slots(slots);
+        for (uint16_t k = 0; k < PWM_HALF_LEN - zeros; k++)
+            want[n++] = slots[k];
+    }
+    return n;
+}
+
+int main(void)
+{
+    static uint8_t wire[4 * 64];
+    uint16_t ends[2] = {0, 0};
+
+    srand(40);
+    argb_init();
+    argb_set_brightness(255);
+    for (uint16_t leds = 1; leds <= 4 * ARGB_DBM_LEDS + 3; leds++)
+    {
+        // RGBW LEDs after the RGB ones, so chunks split LEDs too
+        argb_segment segs[2] = {
+            {0,               (leds + 1) / 2, ARGB_ORDER_GRB, 3, ARGB_CHIP_WS2812},
+            {(leds + 1) / 2,  leds / 2,       ARGB_ORDER_RGB, 4, ARGB_CHIP_SK6812},
+        };
+        CHECK_EQ(argb_init_segments(segs, (leds > 1) ? 2 : 1), ARGB_OK);
+
+        for (int frame = 0; frame < 3; frame++)
+        {
+            for (uint16_t i = 0; i < leds; i++)
+            {
+                argb_set_rgb(i, rand(), rand(), rand());
+                argb_set_white(i, rand());
+            }
+
+            CHECK_EQ(argb_show(), ARGB_OK);
+            DMA_Stream_TypeDef *st = DMA_HANDLE->stream;
+            CHECK_EQ(st->NDTR, PWM_DBM_LEN);
+            CHECK(st->M0AR == (uintptr_t) &pwm_buf0[0]);
+            CHECK(st->M1AR == (uintptr_t) &pwm_buf1[0]);
+            CHECK(st->CR & STM32_DMA_CR_DBM);
+            CHECK(!(st->CR & STM32_DMA_CR_CT));
+            sim_frame();
+
+            long zeros = sim_decode(wire);
+            CHECK(zeros >= ARGB_LATCH_ZEROS);
+            CHECK(memcmp(wire, (const uint8_t *) rgb_buf, argb_total_bytes) == 0);
+            CHECK_EQ(argb_ready(), ARGB_READY);
+
+            // buffer DMA was on when stopped
+            ends[(st->CR & STM32_DMA_CR_CT) != 0]++;
+
+            size_t n = encode_all();
+            CHECK_EQ(n, (size_t) argb_total_bytes * 8);
+            CHECK(memcmp(sim_slots, want, n * sizeof(want[0])) == 0);
+        }
+    }
+    CHECK(ends[0] != 0);
+    CHECK(ends[1] != 0);
+    return TEST_END();
+}
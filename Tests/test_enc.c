@@ -0,0 +1,146 @@
+/**
+ *******************************************
+ * @file    test_enc.c
+ * @brief   Encode worker ring, on time and late
+ *******************************************
+ *
+ * The worker thread doesn't run on the host, its loop body is called
+ * from the DMA simulation between slots instead. A worker that keeps
+ * up must give the same wire bytes as the interrupt encoder and count
+ * no stalls. One that misses halves must count one stall per half DMA
+ * starts unencoded, and the ring must never hand out more chunks than
+ * it holds, however long the stall.
+ */
+
+#include <stdlib.h>
+#include "ARGB.c"
+#include "test.h"
+#include "sim.h"
+
+#if !ARGB_USE_ENCODE_THREAD
+#error Build with ARGB_USE_ENCODE_THREAD=1
+#endif
+
+#define LEDS 40
+#define HALF_SLOTS (PWM_BUF_LEN / 2) ///< Slots between two releases
+
+static uint32_t worker_period = 1; ///< Slots per encoded chunk
+static size_t worker_off = 0;      ///< First half the worker sleeps through
+static size_t worker_on = 0;       ///< Half it wakes up in
+static uint32_t worker_tick = 0;
+static int ring_errors = 0;        ///< Slots with chunks lost or made up
+
+/// Worker run by the DMA simulation
+static void worker(void)
+{
+    size_t half = sim_nslots / HALF_SLOTS;
+
+    // every chunk is either queued, being encoded or waiting for DMA
+    if (enc_sem.cnt + enc_ring_ready + enc_working != ARGB_CHUNKS)
+        ring_errors++;
+    if ((half >= worker_off) && (half < worker_on))
+        return;
+    if (++worker_tick < worker_period)
+        return;
+    worker_tick = 0;
+    while (enc_sem.cnt > 0)
+    {
+        argb_enc_step();
+        if (worker_period > 1)
+            break;
+    }
+}
+
+/// Chunks left when DMA stopped
+static void drain(void)
+{
+    while (enc_sem.cnt > 0)
+        argb_enc_step();
+}
+
+/**
+ * @brief Send a random frame
+ * @param[out] stats Worker counters of the frame
+ * @return true if wire bytes are the frame's
+ */
+static bool frame(argb_encode_stats *stats)
+{
+    static uint8_t wire[3 * LEDS];
+
+    for (uint16_t i = 0; i < LEDS; i++)
+        argb_set_rgb(i, rand(), rand(), rand());
+
+    argb_get_encode_stats(stats); // resets lowest depth
+    uint32_t stalls = stats->stalls;
+
+    worker_tick = 0;
+    ring_errors = 0;
+    CHECK_EQ(argb_show(), ARGB_OK);
+    sim_frame();
+    CHECK_EQ(ring_errors, 0);
+    CHECK(sim_latch_periods != 0);
+    drain();
+    CHECK_EQ(argb_ready(), ARGB_READY);
+
+    argb_get_encode_stats(stats);
+    stats->stalls -= stalls;
+    CHECK(stats->depth <= ARGB_CHUNKS);
+
+    long zeros = sim_decode(wire);
+    return (zeros >= ARGB_LATCH_ZEROS) && (memcmp(wire, (const uint8_t *) rgb_buf, argb_total_bytes) == 0);
+}
+
+int main(void)
+{
+    argb_segment seg = {0, LEDS, ARGB_ORDER_GRB, 3, ARGB_CHIP_WS2812};
+    argb_encode_stats st;
+
+    srand(39);
+    argb_init();
+    argb_set_brightness(255);
+    CHECK_EQ(argb_init_segments(&seg, 1), ARGB_OK);
+    sim_slot_hook = worker;
+
+    // on time, at once and spread over the half
+    CHECK(frame(&st));
+    CHECK_EQ(st.stalls, 0);
+    CHECK_EQ(st.min_depth, ARGB_CHUNKS / 2);
+
+    worker_period = PWM_HALF_LEN - 1;
+    CHECK(frame(&st));
+    CHECK_EQ(st.stalls, 0);
+    worker_period = 1;
+
+    // sleeps through one half: DMA starts the next one unencoded, the
+    // worker still gets there first
+    worker_off = 2;
+    worker_on = 3;
+    CHECK(frame(&st));
+    CHECK_EQ(st.stalls, 1);
+    CHECK_EQ(st.min_depth, 0);
+
+    // two halves: one goes out stale, each is counted
+    worker_on = 4;
+    CHECK(!frame(&st));
+    CHECK_EQ(st.stalls, 2);
+    CHECK_EQ(st.min_depth, 0);
+
+    // long stall
+    worker_on = 9;
+    CHECK(!frame(&st));
+    CHECK_EQ(st.stalls, 7);
+
+    // slower than DMA all the way, till the zero chunks catch up
+    worker_off = 0;
+    worker_on = 0;
+    worker_period = 2 * PWM_HALF_LEN;
+    CHECK(!frame(&st));
+    CHECK(st.stalls != 0);
+
+    // and back on time
+    worker_period = 1;
+    CHECK(frame(&st));
+    CHECK_EQ(st.stalls, 0);
+    CHECK_EQ(st.min_depth, ARGB_CHUNKS / 2);
+    return TEST_END();
+}
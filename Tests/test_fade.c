@@ -0,0 +1,78 @@
+/**
+ *******************************************
+ * @file    test_fade.c
+ * @brief   Cross-fade blend on the wire
+ *******************************************
+ *
+ * Every amount is shown on random frames and decoded back, bytes
+ * must be the 8.8 blend of both frames: amount 0 gives the first
+ * one, 255 exactly the second. A timed fade must end on its target.
+ */
+
+#include <stdlib.h>
+#include "ARGB.c"
+#include "test.h"
+#include "sim.h"
+
+static const argb_segment segs[] = {
+    // start, length, order,          bpp, chip
+    {  0,     9,      ARGB_ORDER_GRB, 3,   ARGB_CHIP_WS2812},
+    {  9,     6,      ARGB_ORDER_RGB, 4,   ARGB_CHIP_SK6812},
+};
+
+static uint8_t a[ARGB_FRAME_BYTES], b[ARGB_FRAME_BYTES], wire[ARGB_FRAME_BYTES];
+static uint16_t fade_frames = 0;
+
+/// Strip runs while the fading thread sleeps
+static void run_strip(void)
+{
+    if (DMA_HANDLE->stream->CR & STM32_DMA_CR_EN)
+    {
+        sim_frame();
+        CHECK(sim_decode(wire) >= ARGB_LATCH_ZEROS);
+        fade_frames++;
+    }
+}
+
+int main(void)
+{
+    srand(38);
+    argb_init();
+    CHECK_EQ(argb_init_segments(segs, 2), ARGB_OK);
+    const uint16_t n = argb_get_frame_bytes();
+
+    for (uint16_t amt = 0; amt < 256; amt++)
+    {
+        for (uint16_t k = 0; k < n; k++)
+        {
+            a[k] = rand();
+            b[k] = rand();
+        }
+        // full swing at both ends
+        a[0] = 0;
+        b[0] = 255;
+        a[1] = 255;
+        b[1] = 0;
+
+        CHECK_EQ(argb_show_crossfade(a, b, amt), ARGB_OK);
+        sim_frame();
+        CHECK(sim_decode(wire) >= ARGB_LATCH_ZEROS);
+
+        const uint16_t u = amt + (amt >> 7);
+        for (uint16_t k = 0; k < n; k++)
+            CHECK_EQ(wire[k], (a[k] * (256 - u) + b[k] * u) >> 8);
+        if (amt == 0)
+            CHECK(memcmp(wire, a, n) == 0);
+        if (amt == 255)
+            CHECK(memcmp(wire, b, n) == 0);
+    }
+
+    // timed fade ends on b
+    host_sleep_hook = run_strip;
+    argb_fade(a, b, 16, 160);
+    CHECK_EQ(fade_frames, 16);
+    CHECK(memcmp(wire, b, n) == 0);
+    CHECK_EQ(argb_ready(), ARGB_READY);
+
+    return TEST_END();
+}
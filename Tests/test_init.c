@@ -0,0 +1,80 @@
+/**
+ *******************************************
+ * @file    test_init.c
+ * @brief   Driver calls before any layout is set
+ *******************************************
+ *
+ * Dynamic buffers without a heap can't take the compile-time layout,
+ * argb_init() reports it. A failed arena init leaves no segments too.
+ * Set, fill and move calls must then do nothing and show must refuse
+ * to start the timer.
+ */
+
+#include "ARGB.c"
+#include "test.h"
+
+/// Calls that go through the chain length, none may touch a buffer
+static void poke_all(void)
+{
+    argb_noise nz = {ARGB_NOISE_GRADIENT, 2, 0, 32, 100, 0};
+    hsv_t lo = {.h = 0, .s = 255, .v = 0}, hi = {.h = 255, .s = 255, .v = 255};
+
+    argb_set_rgb(0, 1, 2, 3);
+    argb_set_hsv(0, 10, 255, 255);
+    argb_fill_rgb(4, 5, 6);
+    argb_fill_hsv(20, 255, 128);
+    argb_fill_white(7);
+    argb_fill_noise_hsv(0, 9, &nz, lo, hi);
+    argb_move(0, 1, 5);
+    argb_move(3, 0, 5);
+#if defined(ARGB_PALETTE_SIZE)
+    argb_set_index(0, 1);
+    argb_fill_index_range(0, 9, 1);
+    argb_fill_noise_index(0, 9, &nz);
+#endif
+}
+
+int main(void)
+{
+#if ARGB_DYNAMIC_BUFFERS
+    static uint8_t arena[64] __attribute__((aligned(4)));
+    argb_segment seg = {0, 40, ARGB_ORDER_GRB, 3, ARGB_CHIP_WS2812};
+
+#if CH_CFG_USE_HEAP
+    CHECK_EQ(argb_init(), ARGB_OK);
+    CHECK_EQ(argb_seg_count, 1);
+    argb_seg_count = 0; // as if it never was set
+    argb_num_leds = 0;
+#else
+    CHECK_EQ(argb_init(), ARGB_PARAM_ERR);
+#endif
+    CHECK_EQ(argb_init_arena(&seg, 1, arena, sizeof(arena)), ARGB_PARAM_ERR);
+#else
+    CHECK_EQ(argb_init(), ARGB_OK);
+    argb_seg_count = 0;
+    argb_num_leds = 0;
+#endif
+    CHECK_EQ(argb_seg_count, 0);
+    CHECK_EQ(argb_get_num_leds(), 0);
+
+    bool started = argb_started;
+    argb_state lock = argb_ready();
+    poke_all();
+    CHECK_EQ(argb_show(), ARGB_PARAM_ERR);
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+    CHECK_EQ(argb_show_crossfade((const uint8_t *) rgb_buf, (const uint8_t *) rgb_buf, 128), ARGB_PARAM_ERR);
+#endif
+    CHECK_EQ(argb_started, started);
+    CHECK_EQ(argb_ready(), lock);
+
+#if ARGB_DYNAMIC_BUFFERS
+    // a layout that fits still starts the driver afterwards
+    static uint8_t big[2048] __attribute__((aligned(4)));
+    seg.length = 10;
+    CHECK(argb_buf_size(&seg, 1) <= sizeof(big));
+    CHECK_EQ(argb_init_arena(&seg, 1, big, sizeof(big)), ARGB_OK);
+    poke_all();
+    CHECK_EQ(argb_show(), ARGB_OK);
+#endif
+    return TEST_END();
+}
@@ -0,0 +1,54 @@
+/**
+ *******************************************
+ * @file    test_latch.c
+ * @brief   Frames back to back with the latch started at HT or TC
+ *******************************************
+ *
+ * Chains of 1..8 LEDs end their data in either half of the PWM
+ * buffer, so DMA is stopped part way through it every other length.
+ * Next frame must still start from the first slot with a full count.
+ */
+
+#include <stdlib.h>
+#include "ARGB.c"
+#include "test.h"
+#include "sim.h"
+
+int main(void)
+{
+    static uint8_t wire[NUM_BYTES];
+    uint16_t ndtr_left[2] = {0, 0};
+
+    srand(28);
+    argb_init();
+    argb_set_brightness(255);
+    for (uint16_t leds = 1; leds <= 8; leds++)
+    {
+        argb_segment seg = {0, leds, ARGB_ORDER_GRB, 3, ARGB_CHIP_WS2812};
+        CHECK_EQ(argb_init_segments(&seg, 1), ARGB_OK);
+
+        for (int frame = 0; frame < 3; frame++)
+        {
+            for (uint16_t i = 0; i < leds; i++)
+                argb_set_rgb(i, rand(), rand(), rand());
+
+            CHECK_EQ(argb_show(), ARGB_OK);
+            CHECK_EQ(DMA_HANDLE->stream->NDTR, PWM_BUF_LEN);
+            CHECK(DMA_HANDLE->stream->M0AR == (uintptr_t) &pwm_buf[0]);
+            sim_frame();
+
+            long zeros = sim_decode(wire);
+            CHECK(zeros >= ARGB_LATCH_ZEROS);
+            CHECK(memcmp(wire, (const uint8_t *) rgb_buf, argb_total_bytes) == 0);
+            CHECK_EQ(argb_ready(), ARGB_READY);
+            CHECK(sim_latch_periods >= 1);
+
+            // where the stream was stopped
+            ndtr_left[DMA_HANDLE->stream->NDTR == PWM_BUF_LEN / 2]++;
+        }
+    }
+    // both stop points were hit
+    CHECK(ndtr_left[0] != 0);
+    CHECK(ndtr_left[1] != 0);
+    return TEST_END();
+}
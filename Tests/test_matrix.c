@@ -0,0 +1,179 @@
+/**
+ *******************************************
+ * @file    test_matrix.c
+ * @brief   XY table, rectangles and scrolling of the matrix layer
+ *******************************************
+ *
+ * The XY table is checked against the layout walked the other way:
+ * LED by LED along the chain to its display cell, for every rotation,
+ * serpentine wiring and tiling. Rectangle fills and scrolls hand runs
+ * of LEDs to the range calls; the pixel buffer after them must be the
+ * one a cell by cell redraw leaves, whatever the runs look like (tile
+ * edges, rotated panels, serpentine rows moved across parity).
+ */
+
+#include <stdlib.h>
+#include "ARGB.c"
+#include "ARGB_matrix.c"
+#include "test.h"
+
+#define FIRST 5   ///< Chain LEDs before the matrix
+#define MAX_CELLS 200
+
+/// Tile width, height, tiles in a row, tile rows
+static const uint8_t tilings[][4] = {
+    {8, 1, 1, 1},
+    {4, 3, 1, 1},
+    {4, 3, 3, 2},
+    {3, 5, 2, 1},
+    {5, 2, 1, 3},
+};
+
+static uint16_t ref[MAX_CELLS]; ///< Expected LED of every display cell, row by row
+static rgb_t grid[MAX_CELLS];   ///< Stored colors before a scroll
+static uint8_t start[4 * NUM_LEDS], got[4 * NUM_LEDS];
+
+/**
+ * @brief Expected XY table, walking the chain
+ * @param[in] lt Layout
+ * @param[out] w Display width
+ * @param[out] h Display height
+ */
+static void reference(const argb_matrix_layout *lt, uint8_t *w, uint8_t *h)
+{
+    const uint16_t pw = lt->width * lt->tiles_x, ph = lt->height * lt->tiles_y;
+    const uint16_t tile = lt->width * lt->height;
+
+    *w = (lt->rotation & 1) ? ph : pw;
+    *h = (lt->rotation & 1) ? pw : ph;
+    for (uint16_t i = 0; i < pw * ph; i++)
+    {
+        // chain position to panel coordinates
+        uint16_t t = i / tile, k = i % tile;
+        uint16_t ly = k / lt->width, lx = k % lt->width;
+        if (lt->serpentine && (ly & 1))
+            lx = lt->width - 1 - lx;
+        uint16_t px = (t % lt->tiles_x) * lt->width + lx;
+        uint16_t py = (t / lt->tiles_x) * lt->height + ly;
+
+        // panel turned clockwise
+        uint16_t x, y;
+        switch (lt->rotation)
+        {
+            case ARGB_ROT_90:  x = ph - 1 - py; y = px;          break;
+            case ARGB_ROT_180: x = pw - 1 - px; y = ph - 1 - py; break;
+            case ARGB_ROT_270: x = py;          y = pw - 1 - px; break;
+            default:           x = px;          y = py;          break;
+        }
+        ref[y * *w + x] = lt->first + i;
+    }
+}
+
+/// Random colors on the whole chain, kept in start
+static void scramble(void)
+{
+    for (uint16_t i = 0; i < NUM_LEDS; i++)
+        argb_set_rgb(i, rand(), rand(), rand());
+    memcpy(start, (const uint8_t *) rgb_buf, argb_buf_bytes);
+}
+
+/// Keep the buffer a call left, go back to start for the redraw
+static void rewind_buf(void)
+{
+    memcpy(got, (const uint8_t *) rgb_buf, argb_buf_bytes);
+    memcpy((uint8_t *) rgb_buf, start, argb_buf_bytes);
+}
+
+static void check_xy(uint8_t w, uint8_t h)
+{
+    CHECK_EQ(argb_matrix_width(), w);
+    CHECK_EQ(argb_matrix_height(), h);
+    for (uint8_t y = 0; y < h; y++)
+        for (uint8_t x = 0; x < w; x++)
+            CHECK_EQ(argb_xy(x, y), ref[y * w + x]);
+    CHECK_EQ(argb_xy(w, 0), ARGB_XY_NONE);
+    CHECK_EQ(argb_xy(0, h), ARGB_XY_NONE);
+}
+
+/// Rectangles, some cut at the edges, against argb_set_xy()
+static void check_rects(uint8_t w, uint8_t h)
+{
+    for (int rep = 0; rep < 40; rep++)
+    {
+        uint8_t x = rand() % w, y = rand() % h;
+        uint8_t rw = 1 + rand() % (w + 2), rh = 1 + rand() % (h + 2);
+        uint8_t r = rand(), g = rand(), b = rand();
+
+        scramble();
+        argb_fill_rect(x, y, rw, rh, r, g, b);
+        rewind_buf();
+
+        for (uint16_t cy = y; (cy < y + rh) && (cy < h); cy++)
+            for (uint16_t cx = x; (cx < x + rw) && (cx < w); cx++)
+                argb_set_xy(cx, cy, r, g, b);
+        CHECK(memcmp(got, (const uint8_t *) rgb_buf, argb_buf_bytes) == 0);
+    }
+}
+
+/// Every shift, off the matrix too, against moving cell by cell
+static void check_scrolls(uint8_t w, uint8_t h)
+{
+    for (int dy = -h - 1; dy <= h + 1; dy++)
+        for (int dx = -w - 1; dx <= w + 1; dx++)
+        {
+            uint8_t r = rand(), g = rand(), b = rand();
+
+            scramble();
+            for (uint16_t k = 0; k < w * h; k++)
+                grid[k] = argb_get_rgb(ref[k]);
+            argb_matrix_scroll(dx, dy, r, g, b);
+            rewind_buf();
+
+            for (int y = 0; y < h; y++)
+                for (int x = 0; x < w; x++)
+                {
+                    int sx = x - dx, sy = y - dy;
+                    if ((sx < 0) || (sx >= w) || (sy < 0) || (sy >= h))
+                        argb_set_xy(x, y, r, g, b);
+                    else
+                        argb_write_rgb(ref[y * w + x], grid[sy * w + sx].raw, 1); // stored values as is
+                }
+            if (memcmp(got, (const uint8_t *) rgb_buf, argb_buf_bytes) != 0)
+                printf("scroll %d, %d on %ux%u\n", dx, dy, w, h);
+            CHECK(memcmp(got, (const uint8_t *) rgb_buf, argb_buf_bytes) == 0);
+        }
+}
+
+int main(void)
+{
+    argb_segment seg = {0, NUM_LEDS, ARGB_ORDER_GRB, 3, ARGB_CHIP_WS2812};
+
+    srand(33);
+    argb_init();
+    CHECK_EQ(argb_init_segments(&seg, 1), ARGB_OK);
+    argb_set_brightness(255);
+
+    for (size_t t = 0; t < sizeof(tilings) / sizeof(tilings[0]); t++)
+        for (uint8_t rot = ARGB_ROT_0; rot <= ARGB_ROT_270; rot++)
+            for (int serp = 0; serp < 2; serp++)
+            {
+                argb_matrix_layout lt = {FIRST, tilings[t][0], tilings[t][1], tilings[t][2], tilings[t][3],
+                                         serp, (argb_rotation) rot};
+                uint8_t w, h;
+
+                reference(&lt, &w, &h);
+                CHECK((uint16_t) w * h <= MAX_CELLS);
+                CHECK_EQ(argb_matrix_init(&lt), ARGB_OK);
+                check_xy(w, h);
+                check_rects(w, h);
+                check_scrolls(w, h);
+            }
+
+    // layouts that don't fit
+    argb_matrix_layout big = {NUM_LEDS - 10, 4, 3, 1, 1, false, ARGB_ROT_0};
+    CHECK_EQ(argb_matrix_init(&big), ARGB_PARAM_ERR);
+    big.first = 0;
+    big.width = 0;
+    CHECK_EQ(argb_matrix_init(&big), ARGB_PARAM_ERR);
+    return TEST_END();
+}
@@ -0,0 +1,140 @@
+/**
+ *******************************************
+ * @file    test_noise.c
+ * @brief   Noise golden values, row sampler and noise fills
+ *******************************************
+ *
+ * Point samples must keep the values ARGB_bench.c reports, so a
+ * change of the lattice hash, gradients or easing shows up here
+ * first. The row sampler reuses cell corners along x and must give
+ * the same samples as the point functions at x + k * dx. Noise fills
+ * must store what per-LED set calls with the same samples store.
+ */
+
+#include <stdlib.h>
+#include "ARGB.c"
+#include "test.h"
+
+/// x, y, z, then vnoise8 1D/2D/3D and gnoise8 1D/2D/3D
+static const uint16_t golden[][9] = {
+    {0x0000, 0x0000, 0x0000, 151,  17,  36, 128, 128, 128},
+    {0x0080, 0x0040, 0x0020, 155,  90,  72, 184,  65, 105},
+    {0x1234, 0x5678, 0x9ABC,  95, 150, 145, 192, 113, 144},
+    {0xFFFF, 0x8000, 0x0100, 151,  99,   1, 127, 128, 128},
+    {0x7F3A, 0x00C5, 0x4E21,  62, 153,  63, 117, 104, 149},
+};
+
+static const argb_segment segs[] = {
+    // start, length, order,          bpp, chip
+    {  0,     7,      ARGB_ORDER_GRB, 3,   ARGB_CHIP_WS2812},
+    {  7,     5,      ARGB_ORDER_BRG, 4,   ARGB_CHIP_SK6812},
+    { 12,     9,      ARGB_ORDER_RGB, 3,   ARGB_CHIP_WS2811F},
+};
+#define LEDS 21
+
+/// Point sample of a field
+static uint8_t point(bool grad, uint8_t dims, uint16_t x, uint16_t y, uint16_t z)
+{
+    switch (dims)
+    {
+        case 1:  return grad ? gnoise8(x) : vnoise8(x);
+        case 2:  return grad ? gnoise8_2d(x, y) : vnoise8_2d(x, y);
+        default: return grad ? gnoise8_3d(x, y, z) : vnoise8_3d(x, y, z);
+    }
+}
+
+static void check_golden(void)
+{
+    for (size_t k = 0; k < sizeof(golden) / sizeof(golden[0]); k++)
+    {
+        const uint16_t *g = golden[k];
+
+        CHECK_EQ(vnoise8(g[0]), g[3]);
+        CHECK_EQ(vnoise8_2d(g[0], g[1]), g[4]);
+        CHECK_EQ(vnoise8_3d(g[0], g[1], g[2]), g[5]);
+        CHECK_EQ(gnoise8(g[0]), g[6]);
+        CHECK_EQ(gnoise8_2d(g[0], g[1]), g[7]);
+        CHECK_EQ(gnoise8_3d(g[0], g[1], g[2]), g[8]);
+    }
+}
+
+/// Rows of random fields, steps below, at and above one cell
+static void check_rows(void)
+{
+    static const uint16_t steps[] = {0, 1, 16, 37, 64, 255, 256, 257, 700};
+
+    for (int grad = 0; grad < 2; grad++)
+        for (uint8_t dims = 1; dims <= 3; dims++)
+            for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++)
+                for (int rep = 0; rep < 20; rep++)
+                {
+                    uint16_t x = rand(), y = rand(), z = rand();
+                    noise8_row w;
+
+                    noise8_row_init(&w, grad, dims, x, steps[s], y, z);
+                    for (uint16_t k = 0; k < 300; k++)
+                        CHECK_EQ(noise8_row_next(&w), point(grad, dims, x + k * steps[s], y, z));
+                }
+}
+
+/// Pixel buffer after a fill against the one after per-LED set calls
+static void check_fills(void)
+{
+    static uint8_t filled[4 * LEDS];
+
+    for (int rep = 0; rep < 50; rep++)
+    {
+        argb_noise nz = {(argb_noise_kind) (rep & 1), 1 + rep % 3, rand(), rand() % 300, rand(), rand()};
+        hsv_t lo = {.h = rand(), .s = rand(), .v = rand()};
+        hsv_t hi = {.h = rand(), .s = rand(), .v = rand()};
+        uint16_t start = rand() % LEDS, end = start + rand() % (LEDS + 4 - start); // may run past the chain
+        noise8_row w;
+
+        // HSV between lo and hi
+        argb_set_brightness(rand());
+        argb_fill_rgb(1, 2, 3);
+        argb_fill_noise_hsv(start, end, &nz, lo, hi);
+        memcpy(filled, (const uint8_t *) rgb_buf, argb_buf_bytes);
+
+        argb_fill_rgb(1, 2, 3);
+        noise8_row_init(&w, nz.kind == ARGB_NOISE_GRADIENT, nz.dims, nz.x, nz.dx, nz.y, nz.z);
+        for (uint16_t i = start; (i <= end) && (i < LEDS); i++)
+        {
+            uint8_t n = noise8_row_next(&w);
+            uint16_t u = n + (n >> 7);
+
+            argb_set_hsv(i, lo.h + (((uint8_t) (hi.h - lo.h) * u) >> 8),
+                         lo.s + (((hi.s - lo.s) * u) >> 8), lo.v + (((hi.v - lo.v) * u) >> 8));
+        }
+        CHECK(memcmp(filled, (const uint8_t *) rgb_buf, argb_buf_bytes) == 0);
+
+#ifdef ARGB_PALETTE_SIZE
+        // palette index, scaled to the palette size
+        argb_fill_index_range(0, LEDS - 1, 1);
+        argb_fill_noise_index(start, end, &nz);
+        memcpy(filled, (const uint8_t *) rgb_buf, argb_buf_bytes);
+
+        argb_fill_index_range(0, LEDS - 1, 1);
+        noise8_row_init(&w, nz.kind == ARGB_NOISE_GRADIENT, nz.dims, nz.x, nz.dx, nz.y, nz.z);
+        for (uint16_t i = start; (i <= end) && (i < LEDS); i++)
+            argb_set_index(i, (noise8_row_next(&w) * ARGB_PALETTE_SIZE) >> 8);
+        CHECK(memcmp(filled, (const uint8_t *) rgb_buf, argb_buf_bytes) == 0);
+#endif
+    }
+}
+
+int main(void)
+{
+    srand(45);
+    argb_init();
+    CHECK_EQ(argb_init_segments(segs, 3), ARGB_OK);
+#ifdef ARGB_PALETTE_SIZE
+    for (uint16_t k = 0; k < ARGB_PALETTE_SIZE; k++)
+        argb_set_palette(k, rand(), rand(), rand(), rand());
+#endif
+
+    check_golden();
+    check_rows();
+    check_fills();
+    return TEST_END();
+}
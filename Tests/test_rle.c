@@ -0,0 +1,84 @@
+/**
+ *******************************************
+ * @file    test_rle.c
+ * @brief   Animations packed by Tools/argb_rle.py, played by the driver
+ *******************************************
+ *
+ * Raw frames from rle_frames.py are packed by the tool, the player
+ * decodes them into the middle of the chain and every frame is
+ * compared with the raw one, twice round to cover the wrap. LEDs
+ * around the animation must keep their colors.
+ *
+ *     test_rle [frames.rgb anim.bin]
+ */
+
+#include <stdlib.h>
+#include "ARGB.c"
+#include "ARGB_rle.c"
+#include "test.h"
+
+#define FIRST 40 ///< LED of the animation start
+
+static uint8_t *load(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        printf("%s: can't open\n", path);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    *len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *p = malloc(*len);
+    if (fread(p, 1, *len, f) != *len)
+        exit(1);
+    fclose(f);
+    return p;
+}
+
+int main(int argc, char **argv)
+{
+    size_t raw_len, len;
+    const uint8_t *raw = load((argc > 2) ? argv[1] : "build/rle.rgb", &raw_len);
+    const uint8_t *anim = load((argc > 2) ? argv[2] : "build/rle.bin", &len);
+    static rgb_t led[NUM_LEDS];
+    argb_rle_anim player;
+
+    argb_init();
+    for (uint16_t i = 0; i < NUM_LEDS; i++)
+        argb_write_rgb(i, (const uint8_t []) {1, 2, 3}, 1);
+
+    CHECK_EQ(argb_rle_open(&player, anim, len, FIRST), ARGB_OK);
+    CHECK(FIRST + player.leds <= NUM_LEDS);
+    CHECK_EQ(raw_len, (size_t) player.frames * player.leds * 3);
+
+    for (uint32_t f = 0; f < 2u * player.frames; f++)
+    {
+        CHECK_EQ(argb_rle_next(&player), ARGB_OK);
+        argb_get_rgb_range(0, NUM_LEDS, led);
+
+        const uint8_t *c = &raw[(f % player.frames) * player.leds * 3];
+        for (uint16_t i = 0; i < NUM_LEDS; i++)
+        {
+            if ((i >= FIRST) && (i < FIRST + player.leds))
+            {
+                CHECK_EQ(led[i].r, c[0]);
+                CHECK_EQ(led[i].g, c[1]);
+                CHECK_EQ(led[i].b, c[2]);
+                c += 3;
+            }
+            else
+                CHECK((led[i].r == 1) && (led[i].g == 2) && (led[i].b == 3));
+        }
+    }
+    CHECK_EQ(player.pos, len); // all bytes used
+
+    // cut animation fails on the last frame
+    CHECK_EQ(argb_rle_open(&player, anim, len - 1, FIRST), ARGB_OK);
+    for (uint16_t f = 0; f + 1 < player.frames; f++)
+        CHECK_EQ(argb_rle_next(&player), ARGB_OK);
+    CHECK_EQ(argb_rle_next(&player), ARGB_PARAM_ERR);
+
+    return TEST_END();
+}
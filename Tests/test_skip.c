@@ -0,0 +1,301 @@
+/**
+ *******************************************
+ * @file    test_skip.c
+ * @brief   Unchanged frames are not sent
+ *******************************************
+ *
+ * Every call that writes the pixel buffer, palette or layout must
+ * make the next argb_show() start DMA; a show with no write between
+ * must not, till the keep-alive time is up. With ARGB_FRAME_HASH a
+ * write of the values already there sends nothing too, without it
+ * the generation alone decides. Writes to #rgb_buf count only after
+ * argb_touch(), and after a cross-fade the strip no longer shows
+ * #rgb_buf, so the next show sends it.
+ */
+
+#include <stdlib.h>
+#include "ARGB.c"
+#include "test.h"
+#include "sim.h"
+
+#if !ARGB_SKIP_UNCHANGED
+#error Build with ARGB_SKIP_UNCHANGED=1
+#endif
+
+static const argb_segment segs[] = {
+    // start, length, order,          bpp, chip
+    {  0,     8,      ARGB_ORDER_GRB, 3,   ARGB_CHIP_WS2812},
+    {  8,     6,      ARGB_ORDER_RGB, 4,   ARGB_CHIP_SK6812},
+};
+#define LEDS 14
+
+#if defined(ARGB_PALETTE_SIZE)
+#define STATE_BYTES (4 * LEDS + sizeof(argb_palette))
+#else
+#define STATE_BYTES (4 * LEDS)
+#endif
+
+/**
+ * @brief Show and run the frame
+ * @return true if DMA was started
+ */
+static bool sent(void)
+{
+    CHECK_EQ(argb_show(), ARGB_OK);
+    return sim_frame() != 0;
+}
+
+/// Buffer and palette, what the hash sees
+static size_t state(uint8_t *out)
+{
+    memcpy(out, (const uint8_t *) rgb_buf, argb_buf_bytes);
+#if defined(ARGB_PALETTE_SIZE)
+    memcpy(out + argb_buf_bytes, argb_palette, sizeof(argb_palette));
+    return argb_buf_bytes + sizeof(argb_palette);
+#else
+    return argb_buf_bytes;
+#endif
+}
+
+/// Known frame, LED 0 apart from the rest
+static void prep(void)
+{
+#if defined(ARGB_PALETTE_SIZE)
+    argb_fill_index_range(0, LEDS - 1, 1);
+    argb_set_index(0, 2);
+#else
+    argb_fill_rgb(1, 2, 3);
+    argb_fill_white(1);
+    argb_set_rgb(0, 90, 80, 70);
+#endif
+}
+
+static void w_set_rgb(void) { argb_set_rgb(3, 200, 100, 50); }
+static void w_set_hsv(void) { argb_set_hsv(9, 40, 255, 255); }
+static void w_fill_rgb(void) { argb_fill_rgb(50, 60, 70); }
+static void w_fill_rgb_range(void) { argb_fill_rgb_range(6, 9, 50, 60, 70); }
+static void w_fill_hsv(void) { argb_fill_hsv(128, 255, 255); }
+static void w_fill_hsv_range(void) { argb_fill_hsv_range(2, 4, 128, 255, 255); }
+static void w_move(void) { argb_move(1, 0, 3); }
+static void w_write_rgb(void) { static const uint8_t px[] = {9, 8, 7, 6, 5, 4}; argb_write_rgb(7, px, 2); }
+static void w_clear(void) { argb_clear(); }
+static void w_layout(void) { argb_init_segments(segs, 2); }
+
+static void w_fill_noise_hsv(void)
+{
+    argb_noise nz = {ARGB_NOISE_VALUE, 1, 0, 64, 0, 0};
+    hsv_t lo = {.h = 0, .s = 255, .v = 255}, hi = {.h = 200, .s = 255, .v = 255};
+    argb_fill_noise_hsv(0, LEDS - 1, &nz, lo, hi);
+}
+
+#if defined(ARGB_PALETTE_SIZE)
+static void w_set_palette(void) { argb_set_palette(1, 11, 22, 33, 44); }
+static void w_set_index(void) { argb_set_index(5, 3); }
+static void w_fill_index_range(void) { argb_fill_index_range(4, 12, 3); }
+
+static void w_fill_noise_index(void)
+{
+    argb_noise nz = {ARGB_NOISE_GRADIENT, 2, 0, 64, 300, 0};
+    argb_fill_noise_index(0, LEDS - 1, &nz);
+}
+#else
+static void w_set_white(void) { argb_set_white(10, 99); }
+static void w_fill_white(void) { argb_fill_white(77); }
+static void w_fill_white_range(void) { argb_fill_white_range(8, 11, 77); }
+#endif
+
+#if ARGB_USE_POWER_LIMIT
+static void w_power_limit(void) { argb_set_power_limit(argb_power_limit + 100); }
+#endif
+
+/// Calls that write what the strip shows
+static const struct {
+    void (*write)(void);
+    const char *name;
+} writers[] = {
+    {w_set_rgb, "set_rgb"},
+    {w_set_hsv, "set_hsv"},
+    {w_fill_rgb, "fill_rgb"},
+    {w_fill_rgb_range, "fill_rgb_range"},
+    {w_fill_hsv, "fill_hsv"},
+    {w_fill_hsv_range, "fill_hsv_range"},
+    {w_fill_noise_hsv, "fill_noise_hsv"},
+    {w_move, "move"},
+    {w_write_rgb, "write_rgb"},
+    {w_clear, "clear"},
+    {w_layout, "init_segments"},
+#if defined(ARGB_PALETTE_SIZE)
+    {w_set_palette, "set_palette"},
+    {w_set_index, "set_index"},
+    {w_fill_index_range, "fill_index_range"},
+    {w_fill_noise_index, "fill_noise_index"},
+#else
+    // palette formats keep white in the palette
+    {w_set_white, "set_white"},
+    {w_fill_white, "fill_white"},
+    {w_fill_white_range, "fill_white_range"},
+#endif
+#if ARGB_USE_POWER_LIMIT
+    {w_power_limit, "set_power_limit"},
+#endif
+};
+
+/// Every writer bumps the generation, a show between two writes is skipped
+static void check_writers(void)
+{
+    static uint8_t before[STATE_BYTES], after[STATE_BYTES];
+
+    for (size_t k = 0; k < sizeof(writers) / sizeof(writers[0]); k++)
+    {
+        prep();
+        sent();
+        uint32_t skipped = argb_get_skipped();
+        CHECK(!sent());
+        CHECK_EQ(argb_get_skipped(), skipped + 1);
+
+        size_t n = state(before);
+        uint32_t gen = argb_gen;
+        writers[k].write();
+        bool changed = (state(after) != n) || (memcmp(before, after, n) != 0);
+#if ARGB_USE_POWER_LIMIT
+        changed = changed || (writers[k].write == w_power_limit); // hashed apart from the buffer
+#endif
+        bool went = sent();
+
+        if ((argb_gen == gen) || !changed || !went)
+            printf("%s: generation %s, frame %s, %s\n", writers[k].name, (argb_gen != gen) ? "bumped" : "kept",
+                   changed ? "changed" : "same", went ? "sent" : "skipped");
+        CHECK(argb_gen != gen);
+        CHECK(changed);
+        CHECK(went);
+        CHECK(!sent());
+    }
+}
+
+/// LED 3 apart, LEDs 5 and 6 as prep() left them
+static void rewrite(void)
+{
+#if defined(ARGB_PALETTE_SIZE)
+    argb_set_index(3, 4);
+    argb_fill_index_range(5, 6, 1);
+#else
+    argb_set_rgb(3, 200, 100, 50);
+    argb_fill_rgb_range(5, 6, 1, 2, 3);
+#endif
+}
+
+/// Same values written again
+static void check_rewrite(void)
+{
+    prep();
+    rewrite();
+    sent();
+
+    rewrite();
+#if ARGB_FRAME_HASH
+    CHECK(!sent());
+#else
+    CHECK(sent());
+#endif
+    CHECK(!sent());
+
+    // changed and changed back between two shows
+    argb_clear();
+    prep();
+    rewrite();
+#if ARGB_FRAME_HASH
+    CHECK(!sent());
+#else
+    CHECK(sent());
+#endif
+
+    // brightness applies to next set calls only
+    argb_set_brightness(100);
+    CHECK(!sent());
+    argb_set_brightness(255);
+}
+
+/// Direct buffer writes need argb_touch()
+static void check_touch(void)
+{
+    prep();
+    sent();
+
+    rgb_buf[4] ^= 0xFF;
+    CHECK(!sent());
+    argb_touch();
+    CHECK(sent());
+    CHECK(!sent());
+
+    // touch alone: generation moves, the hash holds
+    argb_touch();
+#if ARGB_FRAME_HASH
+    CHECK(!sent());
+#else
+    CHECK(sent());
+#endif
+}
+
+/// Unchanged frame goes out again once the keep-alive time is up
+static void check_keepalive(void)
+{
+    prep();
+    sent();
+    uint32_t skipped = argb_get_skipped();
+
+    host_time += ARGB_KEEPALIVE_MS - 1;
+    CHECK(!sent());
+    host_time += 1;
+    CHECK(sent());
+    CHECK(!sent());
+    host_time += ARGB_KEEPALIVE_MS / 2;
+    CHECK(!sent());
+    CHECK_EQ(argb_get_skipped(), skipped + 3);
+}
+
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+/// Strip shows the blend after a cross-fade, #rgb_buf is due again
+static void check_crossfade(void)
+{
+    static uint8_t a[ARGB_FRAME_BYTES], b[ARGB_FRAME_BYTES];
+
+    prep();
+    sent();
+    memset(a, 0x10, sizeof(a));
+    memset(b, 0x20, sizeof(b));
+
+    CHECK_EQ(argb_show_crossfade(a, b, 128), ARGB_OK);
+    CHECK(sim_frame() != 0);
+    CHECK(sent());
+    CHECK(!sent());
+}
+#endif
+
+int main(void)
+{
+    srand(37);
+    argb_init();
+    CHECK_EQ(argb_init_segments(segs, 2), ARGB_OK);
+    argb_set_brightness(255);
+#if defined(ARGB_PALETTE_SIZE)
+    for (uint16_t k = 0; k < ARGB_PALETTE_SIZE; k++)
+        argb_set_palette(k, k * 7, k * 5, k * 3, k);
+#endif
+#if ARGB_USE_POWER_LIMIT
+    argb_set_power_limit(100000); // never scales, only the setting changes
+#endif
+
+    // first frame is always sent
+    CHECK(sent());
+    CHECK(!sent());
+    CHECK_EQ(argb_get_skipped(), 1);
+
+    check_writers();
+    check_rewrite();
+    check_touch();
+    check_keepalive();
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+    check_crossfade();
+#endif
+    return TEST_END();
+}
@@ -0,0 +1,173 @@
+/**
+ *******************************************
+ * @file    test_stream.c
+ * @brief   Adalight / TPM2 frames through a serial port stand-in
+ *******************************************
+ *
+ * Streams of frames, noise and broken headers are read from a
+ * channel in random pieces, or fed in one call, and the LEDs are
+ * compared with what the frames carried. Counts past the chain end
+ * must neither wrap onto earlier LEDs nor overrun the split LED.
+ */
+
+#include <stdlib.h>
+#include "ARGB.c"
+#include "ARGB_stream.c"
+#include "test.h"
+#include "sim.h"
+
+/// Serial port stand-in, gives out up to `piece` bytes per read
+struct BaseChannel {
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+    size_t piece;
+};
+
+size_t chnReadTimeout(BaseChannel *chn, uint8_t *buf, size_t n, sysinterval_t timeout)
+{
+    size_t m = 1 + (size_t) rand() % chn->piece;
+
+    (void) timeout;
+    if (m > n)
+        m = n;
+    if (m > chn->len - chn->pos)
+        m = chn->len - chn->pos;
+    memcpy(buf, chn->data + chn->pos, m);
+    chn->pos += m;
+    return m;
+}
+
+#define STREAM_MAX (6 + 3 * 65536 + 64)
+
+static uint8_t stream[STREAM_MAX];
+static size_t stream_len;
+static uint8_t frame[3 * NUM_LEDS]; ///< LEDs the last frame carried
+
+static void put(uint8_t c)
+{
+    stream[stream_len++] = c;
+}
+
+/// Adalight frame of count LEDs, frame[] is repeated over them
+static void put_ada(uint32_t count, bool good)
+{
+    uint8_t hi = (count - 1) >> 8, lo = count - 1;
+
+    put('A'); put('d'); put('a'); put(hi); put(lo);
+    put(hi ^ lo ^ 0x55 ^ !good);
+    for (uint32_t k = 0; k < 3 * count; k++)
+        put(frame[k % sizeof(frame)]);
+}
+
+/// TPM2 frame of size payload bytes
+static void put_tpm(uint8_t type, uint16_t size)
+{
+    put(0xC9); put(type); put(size >> 8); put(size);
+    for (uint32_t k = 0; k < size; k++)
+        put(frame[k % sizeof(frame)]);
+    put(0x36);
+}
+
+static void new_frame(void)
+{
+    for (size_t k = 0; k < sizeof(frame); k++)
+        frame[k] = rand();
+}
+
+/// Read the stream in pieces, letting the strip finish every frame
+static void poll_all(size_t piece)
+{
+    BaseChannel chn = {stream, stream_len, 0, piece};
+
+    while (chn.pos < chn.len)
+    {
+        argb_stream_poll(&chn, TIME_MS2I(10));
+        if (DMA_HANDLE->stream->CR & STM32_DMA_CR_EN)
+            sim_frame();
+    }
+    stream_len = 0;
+}
+
+/// LEDs first..first + count - 1 carry frame[] from its start
+static void check_leds(uint16_t first, uint16_t count, const rgb_t *before)
+{
+    static rgb_t now[NUM_LEDS];
+
+    argb_get_rgb_range(0, NUM_LEDS, now);
+    for (uint16_t i = 0; i < NUM_LEDS; i++)
+    {
+        if ((i >= first) && (i < first + count))
+        {
+            const uint8_t *c = &frame[3 * (i - first)];
+            CHECK((now[i].r == c[0]) && (now[i].g == c[1]) && (now[i].b == c[2]));
+        }
+        else
+            CHECK(memcmp(&now[i], &before[i], sizeof(rgb_t)) == 0);
+    }
+}
+
+int main(void)
+{
+    static rgb_t before[NUM_LEDS];
+    const argb_stream_stats *stats = argb_stream_get_stats();
+
+    srand(34);
+    argb_init();
+
+    for (size_t piece = 1; piece <= ARGB_STREAM_CHUNK; piece *= 4)
+    {
+        // whole chain, noise around it
+        argb_stream_init(0);
+        argb_clear();
+        argb_get_rgb_range(0, NUM_LEDS, before);
+        new_frame();
+        put(0x00); put('A'); put('x');
+        put_ada(NUM_LEDS, true);
+        put(0x55);
+        poll_all(piece);
+        check_leds(0, NUM_LEDS, before);
+        CHECK_EQ(stats->frames, 1);
+        CHECK_EQ(stats->skipped, 2); // aborted header is not counted
+        CHECK_EQ(stats->errors, 0);
+
+        // TPM2 data with an offset, command frames and bad headers change nothing
+        argb_stream_init(10);
+        argb_get_rgb_range(0, NUM_LEDS, before);
+        new_frame();
+        put_tpm(0xC0, 5);
+        put_ada(4, false);
+        put_tpm(0xDA, 3 * 20);
+        poll_all(piece);
+        check_leds(10, 20, before);
+        CHECK_EQ(stats->frames, 1);
+        CHECK_EQ(stats->errors, 1);
+
+        // LED count past the chain end
+        argb_stream_init(NUM_LEDS - 10);
+        argb_get_rgb_range(0, NUM_LEDS, before);
+        new_frame();
+        put_ada(65536, true);
+        poll_all(piece);
+        check_leds(NUM_LEDS - 10, 10, before);
+        CHECK_EQ(stats->frames, 1);
+    }
+
+    // same in a single feed: 65536 LEDs in one chunk
+    argb_stream_init(NUM_LEDS - 10);
+    argb_get_rgb_range(0, NUM_LEDS, before);
+    new_frame();
+    put_ada(65536, true);
+    put_ada(2, true);
+    argb_stream_feed(stream, stream_len);
+    stream_len = 0;
+    sim_frame();
+    argb_stream_feed(NULL, 0); // second show was left for later
+    sim_frame();
+    check_leds(NUM_LEDS - 10, 10, before); // second frame rewrote the first two
+    CHECK_EQ(stats->frames, 2);
+    CHECK_EQ(st_part_n, 0);
+    CHECK_EQ(argb_ready(), ARGB_READY);
+
+    return TEST_END();
+}
@@ -0,0 +1,159 @@
+/**
+ *******************************************
+ * @file    test_timing.c
+ * @brief   Bit and RET code timing on the wire against the datasheets
+ *******************************************
+ *
+ * Built at several bit rates. Every slot of a simulated frame is
+ * turned back into high and low times with the timer clock and the
+ * period the driver programmed, and checked against the chip's
+ * datasheet limits. Log.1 keeps its typical high time while it fits
+ * the period with the minimal low time, above that rate it is cut to
+ * period - TL_MIN. Zero slots and latch timer periods after the data
+ * together must last the chip's reset time, or #ARGB_RESET_US if set.
+ */
+
+#include <stdlib.h>
+#include "ARGB.c"
+#include "test.h"
+#include "sim.h"
+
+#define LEDS 10
+
+/// Datasheet limits, ns, and reset time, us
+typedef struct
+{
+    uint32_t t0h_min, t0h_max, t1h_min, t1h_typ, t1h_max, tl_min, res_us;
+} chip_limits;
+
+#define LIMITS(c) {c##_T0H_MIN_NS, c##_T0H_MAX_NS, c##_T1H_MIN_NS, c##_T1H_TYP_NS, c##_T1H_MAX_NS, \
+                   c##_TL_MIN_NS, c##_RES_MIN_US}
+
+static const chip_limits limits[] = {
+    [ARGB_CHIP_WS2811S] = LIMITS(ARGB_WS2811S),
+    [ARGB_CHIP_WS2811F] = LIMITS(ARGB_WS2811F),
+    [ARGB_CHIP_WS2812]  = LIMITS(ARGB_WS2812),
+    [ARGB_CHIP_SK6812]  = LIMITS(ARGB_SK6812),
+};
+
+static uint32_t bit_period = 0;   ///< Timer period while data is sent, ticks
+static uint32_t latch_period = 0; ///< Timer period of the latch, ticks
+static bool shortened[4];         ///< Log.1 cut below typical, by chip
+
+/// Timer periods, read by the DMA simulation
+static void watch_timer(void)
+{
+    if (TIM_HANDLE.notify)
+        latch_period = TIM_HANDLE.period;
+    else
+        bit_period = TIM_HANDLE.period;
+}
+
+static double ticks_ns(uint32_t ticks)
+{
+    return ticks * 1e9 / APB_FREQ;
+}
+
+/// High time seen by the chip
+static double high_ns(uint32_t slot)
+{
+    return ticks_ns(slot) - LED_SIGNAL_RISE_DELAY_US * 1000.0;
+}
+
+/**
+ * @brief Send a random frame and check its timing
+ * @param[in] segs Segment table
+ * @param[in] count Segment quantity
+ * @param[in] reset_us Expected RET code length
+ */
+static void check_frame(const argb_segment *segs, uint8_t count, uint32_t reset_us)
+{
+    static uint8_t wire[4 * LEDS];
+
+    CHECK_EQ(argb_init_segments(segs, count), ARGB_OK);
+    for (uint16_t i = 0; i < LEDS; i++)
+        argb_set_rgb(i, rand(), rand(), rand());
+    argb_fill_white(0xA5);
+
+    latch_period = 0;
+    CHECK_EQ(argb_show(), ARGB_OK);
+    sim_frame();
+    long zeros = sim_decode(wire);
+    CHECK(zeros >= ARGB_LATCH_ZEROS);
+    CHECK(memcmp(wire, (const uint8_t *) rgb_buf, argb_total_bytes) == 0);
+
+    // every data slot against its segment's chip
+    double period = ticks_ns(bit_period);
+    size_t pos = 0;
+    for (uint8_t s = 0; s < count; s++)
+    {
+        const chip_limits *c = &limits[segs[s].chip];
+        double t1h = (c->t1h_typ + c->tl_min <= period) ? c->t1h_typ : period - c->tl_min;
+        size_t end = pos + 8u * segs[s].length * segs[s].bpp;
+
+        for (; (pos < end) && (pos < sim_nslots); pos++)
+        {
+            double hi = high_ns(sim_slots[pos]);
+            bool one = (sim_slots[pos] == argb_segs[s].hi);
+
+            if (one)
+            {
+                CHECK((hi >= c->t1h_min) && (hi <= c->t1h_max));
+                CHECK((hi <= t1h) && (hi > t1h - ticks_ns(1))); // typical or cut, down to a tick
+            }
+            else
+            {
+                CHECK((hi >= c->t0h_min) && (hi <= c->t0h_max));
+            }
+            CHECK(period - hi >= c->tl_min);
+        }
+        if (t1h < c->t1h_typ)
+            shortened[segs[s].chip] = true;
+    }
+
+    // RET code: low slots still sent by DMA, then the latch timer
+    double ret = zeros * period + sim_latch_periods * ticks_ns(latch_period);
+    CHECK(ret >= reset_us * 1000.0);
+    CHECK(ret <= reset_us * 1000.0 + PWM_BUF_LEN * period); // at most a buffer past it
+    CHECK_EQ(argb_ready(), ARGB_READY);
+}
+
+int main(void)
+{
+    srand(27);
+    argb_init();
+    argb_set_brightness(255);
+    sim_slot_hook = watch_timer;
+
+    // every chip alone, if its tolerances are met at this bit rate
+    for (uint8_t chip = ARGB_CHIP_WS2811S; chip <= ARGB_CHIP_SK6812; chip++)
+    {
+        argb_segment seg = {0, LEDS, ARGB_ORDER_GRB, (chip == ARGB_CHIP_SK6812) ? 4 : 3, (argb_chip) chip};
+
+        if (!argb_chip_ok[chip])
+        {
+            CHECK_EQ(argb_init_segments(&seg, 1), ARGB_PARAM_ERR);
+            continue;
+        }
+        check_frame(&seg, 1, ARGB_RESET_US ? ARGB_RESET_US : limits[chip].res_us);
+    }
+    CHECK(argb_chip_ok[ARGB_CHIP]);
+
+    // mixed chain waits for the slowest chip to latch
+    if (argb_chip_ok[ARGB_CHIP_WS2811F] && argb_chip_ok[ARGB_CHIP_WS2812])
+    {
+        static const argb_segment mixed[] = {
+            {0, 4, ARGB_ORDER_RGB, 3, ARGB_CHIP_WS2811F},
+            {4, 6, ARGB_ORDER_GRB, 3, ARGB_CHIP_WS2812},
+        };
+        check_frame(mixed, 2, ARGB_RESET_US ? ARGB_RESET_US : ARGB_WS2812_RES_MIN_US);
+    }
+
+    // 700 ns typical high plus 300 ns low fill the period at 1 MHz
+#if ARGB_BIT_RATE_HZ > 1000000
+    CHECK(shortened[ARGB_CHIP_WS2812]);
+#elif ARGB_BIT_RATE_HZ <= 800000
+    CHECK(!shortened[ARGB_CHIP_WS2812]);
+#endif
+    return TEST_END();
+}
@@ -0,0 +1,106 @@
+/**
+ *******************************************
+ * @file    test_trace.c
+ * @brief   Trace of simulated frames, dumped for Tools/argb_trace.py
+ *******************************************
+ *
+ * Two frames go through the DMA simulation with a show while busy in
+ * each. Half events must carry what the DMA mode gives them: HT/TC
+ * halves in turn and halves filled so far, buffers in turn in
+ * double-buffer mode, the ring depth with the encode thread. The dump goes to stdout through
+ * ARGB_trace.c, trace_check.py decodes it with the tool.
+ */
+
+#include <stdlib.h>
+#include "ARGB.c"
+#include "ARGB_trace.c"
+#include "test.h"
+#include "sim.h"
+
+#define LEDS 20
+#define FRAMES 2
+
+#if ARGB_USE_ENCODE_THREAD
+/// Worker run by the DMA simulation, always on time
+static void worker(void)
+{
+    while (enc_sem.cnt > 0)
+        argb_enc_step();
+}
+#endif
+
+/// Records of the ring against the frames sent
+static void check_records(void)
+{
+    argb_trace_rec rec;
+    uint16_t shows = 0, busy = 0, ready = 0, halves = 0;
+    uint8_t next = 0;
+#if !ARGB_USE_ENCODE_THREAD
+    uint16_t filled = 0;
+#endif
+
+    for (uint16_t k = 0; argb_trace_get(k, &rec); k++)
+    {
+        switch (rec.ev)
+        {
+            case ARGB_TR_SHOW:
+                shows++;
+                busy += rec.arg16;
+                break;
+            case ARGB_TR_DMA_START:
+                next = 0;   // first half or buffer 0
+#if !ARGB_USE_ENCODE_THREAD
+                filled = 2; // both filled before DMA starts
+#endif
+                break;
+            case ARGB_TR_HALF:
+                halves++;
+                CHECK_EQ(rec.arg8, next);
+                next ^= 1;
+#if ARGB_USE_ENCODE_THREAD
+                CHECK_EQ(rec.arg16, ARGB_CHUNKS); // worker on time, ring full
+#else
+                CHECK_EQ(rec.arg16, filled++);
+#endif
+                break;
+            case ARGB_TR_READY:
+                ready++;
+                break;
+            default:
+                break;
+        }
+    }
+    CHECK_EQ(shows, 2 * FRAMES);
+    CHECK_EQ(busy, FRAMES);
+    CHECK_EQ(ready, FRAMES);
+    CHECK(halves >= FRAMES * 3 * LEDS * 8 / (PWM_BUF_LEN / 2)); // data, then latch zeros
+}
+
+int main(void)
+{
+    argb_segment seg = {0, LEDS, ARGB_ORDER_GRB, 3, ARGB_CHIP_WS2812};
+
+    srand(43);
+    argb_init();
+    argb_set_brightness(255);
+    CHECK_EQ(argb_init_segments(&seg, 1), ARGB_OK);
+#if ARGB_USE_ENCODE_THREAD
+    sim_slot_hook = worker;
+#endif
+
+    argb_trace_clear();
+    for (int f = 0; f < FRAMES; f++)
+    {
+        for (uint16_t i = 0; i < LEDS; i++)
+            argb_set_rgb(i, rand(), rand(), rand());
+        CHECK_EQ(argb_show(), ARGB_OK);
+        CHECK_EQ(argb_show(), ARGB_BUSY);
+        sim_frame();
+        CHECK_EQ(argb_ready(), ARGB_READY);
+    }
+    CHECK(argb_trace_count() < ARGB_TRACE_LEN); // nothing overwritten
+    check_records();
+
+    argb_trace_dump(NULL);
+    return TEST_END();
+}
@@ -0,0 +1,254 @@
+/**
+ *******************************************
+ * @file    test_white.c
+ * @brief   White extraction values on a chain of RGB and RGBW LEDs
+ *******************************************
+ *
+ * The split is checked against the ideal one computed in floating
+ * point: W is the largest amount of the tint all three channels can
+ * give, min(c * 255 / tint), and R, G, B keep what W doesn't light.
+ * The 8.8 reciprocal is off by at most half a unit of 1/256, so over
+ * 255 steps W may land one step either side of the ideal. W's share
+ * (w + 1) * tint / 256 is at most one unit above w * tint / 255 and
+ * rounds down, so R, G, B plus W's light stay less than one step off
+ * the color written. With the default white tint both are exact:
+ * W = min(R, G, B) and the rest is subtracted.
+ *
+ * Raw buffers must hold the split after every set, fill and write
+ * call, compact ones plain RGB, split on the way out: their wire
+ * bytes are decoded from the simulated frame. RGB segments keep the
+ * color as written in both.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "ARGB.c"
+#include "test.h"
+#include "sim.h"
+
+#if !ARGB_WHITE_EXTRACT
+#error Build with ARGB_WHITE_EXTRACT=1
+#endif
+
+static const argb_segment segs[] = {
+    // start, length, order,          bpp, chip
+    {  0,     5,      ARGB_ORDER_GRB, 3,   ARGB_CHIP_WS2812},
+    {  5,     6,      ARGB_ORDER_RGB, 4,   ARGB_CHIP_SK6812},
+    { 11,     4,      ARGB_ORDER_BRG, 3,   ARGB_CHIP_WS2811F},
+    { 15,     5,      ARGB_ORDER_GRB, 4,   ARGB_CHIP_SK6812},
+};
+#define LEDS 20
+
+static const uint8_t tint[3] = {ARGB_WHITE_R, ARGB_WHITE_G, ARGB_WHITE_B};
+
+/// Split of one color against the ideal
+static void check_split(const uint8_t *rgb, const uint8_t *rgbw)
+{
+    double ideal = 255;
+
+    for (uint8_t k = 0; k < 3; k++)
+        ideal = fmin(ideal, floor(rgb[k] * 255.0 / tint[k]));
+
+#if (ARGB_WHITE_R == 255) && (ARGB_WHITE_G == 255) && (ARGB_WHITE_B == 255)
+    CHECK_EQ(rgbw[3], ideal);
+    for (uint8_t k = 0; k < 3; k++)
+        CHECK_EQ(rgbw[k], rgb[k] - rgbw[3]);
+#else
+    CHECK(fabs(rgbw[3] - ideal) <= 1);
+    for (uint8_t k = 0; k < 3; k++)
+        CHECK(fabs(rgbw[k] + rgbw[3] * tint[k] / 255.0 - rgb[k]) < 1);
+#endif
+}
+
+/// Batch split over a grid of colors, greys and primaries included
+static void check_batch(void)
+{
+    static uint8_t rgb[3 * 256], rgbw[4 * 256];
+
+    for (uint16_t r = 0; r < 256; r += 5)
+        for (uint16_t g = 0; g < 256; g += 3)
+        {
+            for (uint16_t b = 0; b < 256; b++)
+            {
+                rgb[3 * b] = r;
+                rgb[3 * b + 1] = g;
+                rgb[3 * b + 2] = b;
+            }
+            argb_rgb_to_rgbw(rgb, rgbw, 256);
+            for (uint16_t b = 0; b < 256; b++)
+                check_split(&rgb[3 * b], &rgbw[4 * b]);
+        }
+}
+
+/// Stored color of a set call: brightness 255, gamma on G and B
+static void stored(const uint8_t *rgb, uint8_t *c)
+{
+    c[0] = rgb[0];
+    c[1] = rgb[1];
+    c[2] = rgb[2];
+#if USE_GAMMA_CORRECTION
+    c[1] = scale8(c[1], 0xB0);
+    c[2] = scale8(c[2], 0xF0);
+#endif
+}
+
+/// Random colors, greys every third LED
+static void random_colors(uint8_t *rgb)
+{
+    for (uint16_t i = 0; i < LEDS; i++)
+    {
+        rgb[3 * i] = rand();
+        rgb[3 * i + 1] = (i % 3) ? rand() : rgb[3 * i];
+        rgb[3 * i + 2] = (i % 3) ? rand() : rgb[3 * i];
+    }
+}
+
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+/**
+ * @brief Pixel buffer against the colors written
+ * @param[in] c Stored colors, 3 bytes per LED
+ */
+static void check_buffer(const uint8_t *c)
+{
+    static uint8_t wire[4 * LEDS];
+
+    for (uint8_t s = 0; s < argb_seg_count; s++)
+    {
+        const argb_seg *seg = &argb_segs[s];
+        for (uint16_t i = seg->start; i < seg->end; i++)
+        {
+            uint8_t px[4], want[4];
+
+            argb_read_px(seg, i, px);
+            if (seg->bpp == 4)
+            {
+                argb_rgb_to_rgbw(&c[3 * i], want, 1);
+                CHECK(memcmp(px, want, 4) == 0);
+            }
+            else
+            {
+                CHECK(memcmp(px, &c[3 * i], 3) == 0);
+                CHECK_EQ(px[3], 0);
+            }
+        }
+    }
+
+    // and goes out as is
+    CHECK(sim_show(wire) >= ARGB_LATCH_ZEROS);
+    CHECK(memcmp(wire, (const uint8_t *) rgb_buf, argb_total_bytes) == 0);
+}
+
+/// Set, fill and write calls split on write
+static void check_raw(void)
+{
+    static uint8_t rgb[3 * LEDS], c[3 * LEDS];
+
+    for (int rep = 0; rep < 20; rep++)
+    {
+        random_colors(rgb);
+
+        // one LED at a time
+        for (uint16_t i = 0; i < LEDS; i++)
+        {
+            argb_set_rgb(i, rgb[3 * i], rgb[3 * i + 1], rgb[3 * i + 2]);
+            stored(&rgb[3 * i], &c[3 * i]);
+        }
+        check_buffer(c);
+
+        // range across both kinds of segments, split once
+        uint16_t start = rand() % LEDS, end = start + rand() % (LEDS - start);
+        argb_fill_rgb_range(start, end, rgb[0], rgb[1], rgb[2]);
+        for (uint16_t i = start; i <= end; i++)
+            stored(rgb, &c[3 * i]);
+        check_buffer(c);
+
+        // values as they are, no brightness or gamma
+        argb_write_rgb(0, rgb, LEDS);
+        check_buffer(rgb);
+
+        // W written alone lasts till the next RGB write
+        argb_set_white(6, 0x5A);
+        CHECK_EQ(argb_get_white(6), 0x5A);
+        argb_set_rgb(6, rgb[18], rgb[19], rgb[20]);
+        memcpy(c, rgb, sizeof(c));
+        stored(&rgb[18], &c[18]);
+        check_buffer(c);
+    }
+}
+#else
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RGB565
+#define QUANT 7 ///< Largest 5-bit rounding step
+#else
+#define QUANT 0
+#endif
+
+/// Compact buffers keep plain RGB, the encoder splits
+static void check_compact(void)
+{
+    static uint8_t rgb[3 * LEDS], w[LEDS], wire[4 * LEDS], want[4 * LEDS];
+
+    for (int rep = 0; rep < 20; rep++)
+    {
+        random_colors(rgb);
+        for (uint16_t i = 0; i < LEDS; i++)
+        {
+#if defined(ARGB_PALETTE_SIZE)
+            // one entry per LED, W of the entry on top of the split
+            w[i] = (i & 1) ? rand() : 0;
+            argb_set_palette(i, rgb[3 * i], rgb[3 * i + 1], rgb[3 * i + 2], w[i]);
+            argb_set_index(i, i);
+#else
+            argb_set_rgb(i, rgb[3 * i], rgb[3 * i + 1], rgb[3 * i + 2]);
+#endif
+        }
+
+        for (uint8_t s = 0; s < argb_seg_count; s++)
+        {
+            const argb_seg *seg = &argb_segs[s];
+            for (uint16_t i = seg->start; i < seg->end; i++)
+            {
+                uint8_t c[4], set[3], *px = &want[seg->offset + (i - seg->start) * seg->bpp];
+
+                // buffer holds the color as set, not split
+                argb_read_px(seg, i, c);
+                stored(&rgb[3 * i], set);
+                for (uint8_t k = 0; k < 3; k++)
+                    CHECK(abs(c[k] - set[k]) <= QUANT);
+                CHECK_EQ(c[3], w[i]);
+
+                if (seg->bpp == 4)
+                {
+                    uint8_t split[4];
+
+                    argb_rgb_to_rgbw(c, split, 1);
+                    memcpy(c, split, 3);
+                    px[3] = qadd8(c[3], split[3]);
+                }
+                px[seg->map[0]] = c[0];
+                px[seg->map[1]] = c[1];
+                px[seg->map[2]] = c[2];
+            }
+        }
+
+        CHECK(sim_show(wire) >= ARGB_LATCH_ZEROS);
+        CHECK_EQ(argb_total_bytes, 3 * 9 + 4 * 11);
+        CHECK(memcmp(wire, want, argb_total_bytes) == 0);
+    }
+}
+#endif
+
+int main(void)
+{
+    srand(42);
+    argb_init();
+    argb_set_brightness(255);
+    CHECK_EQ(argb_init_segments(segs, 4), ARGB_OK);
+
+    check_batch();
+#if ARGB_PIXEL_FORMAT == ARGB_FMT_RAW
+    check_raw();
+#else
+    check_compact();
+#endif
+    return TEST_END();
+}
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""
+Decode a test_trace.c dump with Tools/argb_trace.py and check the
+output: DMA mode on top, every half event labelled for that mode and
+in turn, frames and busy shows counted.
+
+    trace_check.py circ|dbm|thread trace.log
+"""
+
+import os
+import re
+import subprocess
+import sys
+
+TOOL = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "Tools", "argb_trace.py")
+
+# mode: header name, half label, label sequence the halves go through
+MODES = {
+    "circ": ("circular buffer", r"(HT|TC) filled=\d+", ["HT", "TC"]),
+    "dbm": ("double-buffer", r"buffer ([01]) filled=\d+", ["0", "1"]),
+    "thread": ("encode thread", r"(HT|TC) ready=\d+", ["HT", "TC"]),
+}
+FRAMES = 2
+
+
+def main():
+    mode, log = sys.argv[1], sys.argv[2]
+    name, label, turns = MODES[mode]
+    out = subprocess.run([sys.executable, TOOL, log], check=True, stdout=subprocess.PIPE,
+                         universal_newlines=True).stdout.splitlines()
+    fails = []
+
+    if out[0] != "DMA mode: " + name:
+        fails.append("header: %r" % out[0])
+
+    # timeline: time, delta, event, description, up to a blank line
+    timeline = out[2:out.index("")]
+    turn = 0
+    halves = 0
+    for line in timeline:
+        f = line.split(None, 3)
+        if len(f) < 3 or f[2] not in ("half", "dma-start"):
+            continue
+        if f[2] == "dma-start":
+            turn = 0
+            continue
+        m = re.fullmatch(label, f[3] if len(f) > 3 else "")
+        if not m:
+            fails.append("half label: %r" % line)
+        elif m.group(1) != turns[turn]:
+            fails.append("half out of turn: %r" % line)
+        turn ^= 1
+        halves += 1
+    if halves == 0:
+        fails.append("no half events")
+
+    stats = {l[:22].strip(): l[22:].strip() for l in out if len(l) > 22}
+    if not stats.get("show -> ready", "").startswith("n=%d " % FRAMES):
+        fails.append("show -> ready: %r" % stats.get("show -> ready"))
+    if stats.get("show while busy") != str(FRAMES):
+        fails.append("show while busy: %r" % stats.get("show while busy"))
+
+    for f in fails:
+        print("%s: %s" % (log, f))
+    sys.exit(1 if fails else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""
+Pack raw RGB frames into ARGB_rle.h animations.
+
+Input is a file of frames, LEDs * 3 bytes (R, G, B) each, back to back.
+Frame 0 is a keyframe, every next one is stored as runs, literals and
+skips against the previous one. Output is checked by decoding it back.
+
+    argb_rle.py --leds 60 frames.rgb anim.bin
+    argb_rle.py --leds 60 --gamma --c-array anim frames.rgb anim.h
+"""
+
+import argparse
+import struct
+import sys
+
+RUN, LITERAL, SKIP, END = 0x00, 0x40, 0x80, 0xFF
+MAX_LEN = 64
+
+
+def gamma(frame):
+    """Apply driver's USE_GAMMA_CORRECTION to G and B."""
+    out = []
+    for r, g, b in frame:
+        out.append((r, (g * 0xB0) >> 8, (b * 0xF0) >> 8))
+    return out
+
+
+def encode_frame(frame, prev):
+    """Encode frame (list of (r, g, b)) against prev (None for keyframe)."""
+    out = bytearray()
+    literal = []
+    i, n = 0, len(frame)
+
+    def flush():
+        while literal:
+            chunk = literal[:MAX_LEN]
+            del literal[:MAX_LEN]
+            out.append(LITERAL | (len(chunk) - 1))
+            for px in chunk:
+                out.extend(px)
+
+    while i < n:
+        # unchanged LEDs
+        k = i
+        while prev is not None and k < n and k - i < MAX_LEN and frame[k] == prev[k]:
+            k += 1
+        if k > i:
+            flush()
+            out.append(SKIP | (k - i - 1))
+            i = k
+            continue
+        # same color
+        k = i
+        while k < n and k - i < MAX_LEN and frame[k] == frame[i]:
+            k += 1
+        if k - i >= 2:
+            flush()
+            out.append(RUN | (k - i - 1))
+            out.extend(frame[i])
+            i = k
+            continue
+        literal.append(frame[i])
+        i += 1
+    flush()
+    out.append(END)
+    return bytes(out)
+
+
+def encode(frames, leds):
+    out = bytearray(b"ARL1" + struct.pack("<HH", leds, len(frames)))
+    prev = None
+    for frame in frames:
+        out += encode_frame(frame, prev)
+        prev = frame
+    return bytes(out)
+
+
+def decode(data):
+    """Reference decoder, same rules as argb_rle_decode()."""
+    if data[:4] != b"ARL1":
+        raise ValueError("bad magic")
+    leds, count = struct.unpack_from("<HH", data, 4)
+    pos, cur, frames = 8, [(0, 0, 0)] * leds, []
+    for _ in range(count):
+        cur, led = list(cur), 0
+        while True:
+            op = data[pos]
+            pos += 1
+            if op == END:
+                break
+            n = (op & 0x3F) + 1
+            if op >= 0xC0 or led + n > leds:
+                raise ValueError("bad op at %d" % (pos - 1))
+            if op & 0xC0 == RUN:
+                cur[led:led + n] = [tuple(data[pos:pos + 3])] * n
+                pos += 3
+            elif op & 0xC0 == LITERAL:
+                cur[led:led + n] = [tuple(data[pos + 3 * k:pos + 3 * k + 3]) for k in range(n)]
+                pos += 3 * n
+            led += n
+        frames.append(cur)
+    return frames
+
+
+def c_array(name, data):
+    lines = ["// Generated by argb_rle.py", "#include <stdint.h>", "",
+             "const uint8_t %s[%d] = {" % (name, len(data))]
+    for i in range(0, len(data), 16):
+        lines.append("    " + ", ".join("0x%02X" % b for b in data[i:i + 16]) + ",")
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--leds", type=int, required=True, help="LEDs in a frame")
+    ap.add_argument("--gamma", action="store_true", help="apply driver's gamma correction")
+    ap.add_argument("--c-array", metavar="NAME", help="write C source with array NAME")
+    ap.add_argument("input", help="raw RGB frames")
+    ap.add_argument("output", help="animation file")
+    args = ap.parse_args()
+
+    raw = open(args.input, "rb").read()
+    size = args.leds * 3
+    if args.leds <= 0 or len(raw) % size:
+        sys.exit("input is not a whole number of %d-byte frames" % size)
+    frames = []
+    for f in range(len(raw) // size):
+        px = raw[f * size:(f + 1) * size]
+        frame = [tuple(px[k:k + 3]) for k in range(0, size, 3)]
+        frames.append(gamma(frame) if args.gamma else frame)
+
+    data = encode(frames, args.leds)
+    if decode(data) != frames:
+        sys.exit("round trip mismatch")
+
+    if args.c_array:
+        open(args.output, "w").write(c_array(args.c_array, data))
+    else:
+        open(args.output, "wb").write(data)
+    print("%d frames, %d -> %d bytes" % (len(frames), len(raw), len(data)))
+
+
+if __name__ == "__main__":
+    main()
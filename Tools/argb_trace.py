@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""
+Decode ARGB_trace.c dumps: timeline and per-phase latencies.
+
+Input is a console log with one or more dumps in it, the last one is
+taken. Counter wraps are handled, times are printed in microseconds.
+Half events are labelled by the driver's DMA mode from the dump
+header: HT/TC halves of the circular buffer, buffers of double-buffer
+mode, or the ring depth of the encode thread.
+
+    argb_trace.py console.log
+    argb_trace.py --no-timeline < console.log
+"""
+
+import argparse
+import re
+import sys
+
+SHOW, DMA_START, HALF, RESET, READY, SKIP = range(6)
+NAMES = {SHOW: "show", DMA_START: "dma-start", HALF: "half", RESET: "reset",
+         READY: "ready", SKIP: "skipped"}
+
+HEADER = re.compile(r"argb-trace hz=(\d+) n=(\d+)(?: mode=(\w+))?")
+MODES = {"circ": "circular buffer", "dbm": "double-buffer", "thread": "encode thread"}
+RECORD = re.compile(r"^\s*([0-9a-fA-F]{1,8}) (\d+) (\d+) (\d+)\s*$")
+
+
+def parse(lines):
+    """Return (hz, mode, [(t, ev, arg8, arg16)]) of the last complete dump."""
+    dump, cur, hz, mode = None, None, 0, "circ"
+    for line in lines:
+        m = HEADER.search(line)
+        if m:
+            # dumps without a mode come from circular buffer builds
+            hz, mode, cur = int(m.group(1)), m.group(3) or "circ", []
+            continue
+        if cur is None:
+            continue
+        if "argb-trace end" in line:
+            dump, cur = (hz, mode, cur), None
+            continue
+        m = RECORD.match(line)
+        if m:
+            cur.append((int(m.group(1), 16), int(m.group(2)), int(m.group(3)), int(m.group(4))))
+    if dump is None:
+        sys.exit("no complete argb-trace dump found")
+    return dump
+
+
+def unwrap(recs):
+    """Make counter monotonic across 32-bit wraps."""
+    out, base, last = [], 0, None
+    for t, ev, a8, a16 in recs:
+        if last is not None and t < last:
+            base += 1 << 32
+        last = t
+        out.append((t + base, ev, a8, a16))
+    return out
+
+
+def describe(ev, a8, a16, mode):
+    if ev == SHOW:
+        return ("cross-fade" if a8 else "") + (" BUSY" if a16 else "")
+    if ev == HALF:
+        if mode == "dbm":
+            return "buffer %d filled=%d" % (a8, a16)
+        if mode == "thread":
+            return "%s ready=%d" % ("TC" if a8 else "HT", a16)
+        return "%s filled=%d" % ("TC" if a8 else "HT", a16)
+    if ev == RESET:
+        return "zeros=%d" % a16
+    return ""
+
+
+class Stat:
+    def __init__(self, name):
+        self.name, self.v = name, []
+
+    def add(self, us):
+        self.v.append(us)
+
+    def line(self):
+        if not self.v:
+            return "%-22s     -" % self.name
+        return "%-22s n=%-5d min=%9.2f avg=%9.2f max=%9.2f" % (
+            self.name, len(self.v), min(self.v), sum(self.v) / len(self.v), max(self.v))
+
+
+def phases(recs, us):
+    """Split records into frames and collect latencies."""
+    st = {k: Stat(k) for k in ("show -> dma-start", "dma-start -> 1st half", "half -> half",
+                               "last half -> reset", "reset -> ready", "show -> ready")}
+    busy = sum(1 for r in recs if r[1] == SHOW and r[3])
+    skipped = sum(1 for r in recs if r[1] == SKIP)
+    show = start = half = reset = None
+    for t, ev, a8, a16 in recs:
+        if ev == SHOW and not a16:
+            show, start, half, reset = t, None, None, None
+        elif ev == DMA_START:
+            start = t
+            if show is not None:
+                st["show -> dma-start"].add(us(t - show))
+        elif ev == HALF:
+            if half is not None:
+                st["half -> half"].add(us(t - half))
+            elif start is not None:
+                st["dma-start -> 1st half"].add(us(t - start))
+            half = t
+        elif ev == RESET:
+            reset = t
+            if half is not None:
+                st["last half -> reset"].add(us(t - half))
+        elif ev == READY:
+            if reset is not None:
+                st["reset -> ready"].add(us(t - reset))
+            if show is not None and start is not None:
+                st["show -> ready"].add(us(t - show))
+            show = start = half = reset = None
+    return st, busy, skipped
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("log", nargs="?", help="console log, stdin if missing")
+    ap.add_argument("--no-timeline", action="store_true", help="print latencies only")
+    args = ap.parse_args()
+
+    lines = open(args.log, errors="replace") if args.log else sys.stdin
+    hz, mode, recs = parse(lines)
+    if not recs:
+        sys.exit("dump is empty")
+    recs = unwrap(recs)
+
+    def us(ticks):
+        return ticks * 1e6 / hz
+
+    print("DMA mode: %s" % MODES.get(mode, mode))
+    if not args.no_timeline:
+        t0, prev = recs[0][0], recs[0][0]
+        print("%12s %10s  %-10s" % ("time, us", "delta", "event"))
+        for t, ev, a8, a16 in recs:
+            print("%12.2f %+10.2f  %-10s %s" % (us(t - t0), us(t - prev), NAMES.get(ev, "ev%d" % ev),
+                                                describe(ev, a8, a16, mode)))
+            prev = t
+        print()
+
+    st, busy, skipped = phases(recs, us)
+    print("%d records, %.2f us, counter %d Hz" % (len(recs), us(recs[-1][0] - recs[0][0]), hz))
+    for s in st.values():
+        print(s.line())
+    print("%-22s %d" % ("show while busy", busy))
+    print("%-22s %d" % ("frames skipped", skipped))
+
+
+if __name__ == "__main__":
+    main()